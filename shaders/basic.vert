@@ -1,36 +1,117 @@
 #version 450
 
+#ifdef DRAW_PARAMETERS
+#extension GL_ARB_shader_draw_parameters : require
+#endif
+
 #include "utils.glsl"
 
+#ifdef COMPACT_VERTEX
+layout(location = 0) in vec4 in_pos_bitangent_sign;
+layout(location = 1) in vec2 in_oct_normal;
+layout(location = 2) in vec2 in_uv;
+layout(location = 3) in vec2 in_oct_tangent;
+// Constant white, meshes with colors read them from VertexColors
+layout(location = 4) in vec3 in_color;
+#else
 layout(location = 0) in vec3 in_pos;
 layout(location = 1) in vec3 in_normal;
 layout(location = 2) in vec2 in_uv;
 layout(location = 3) in vec4 in_tangent_bitangent_sign;
 layout(location = 4) in vec3 in_color;
+#endif
+
+// The depth prepass (DEPTH_ONLY) only needs what alpha testing reads.
+// Positions must match exactly between both variants for the main pass to test depth for equality
+invariant gl_Position;
 
-layout(location = 0) out vec3 out_normal;
 layout(location = 1) out vec2 out_uv;
+#ifndef DEPTH_ONLY
+layout(location = 0) out vec3 out_normal;
 layout(location = 2) out vec3 out_color;
 layout(location = 3) out vec3 out_position;
 layout(location = 4) out vec3 out_tangent;
 layout(location = 5) out vec3 out_bitangent;
+#endif
+#if defined(BINDLESS) || defined(TEXTURE_ARRAYS)
+layout(location = 6) flat out uint out_material;
+#endif
+#ifdef VISIBILITY
+// Instance slot, with the culling phase in the top bit
+layout(location = 7) flat out uint out_instance;
+#endif
 
 layout(binding = 0) uniform Data {
     FrameData frame;
 };
 
-uniform mat4 model;
+// Transforms of every drawn object, instances of a draw are contiguous
+layout(binding = 2, std430) readonly buffer Instances {
+    mat4 instance_models[];
+};
+
+layout(binding = 3, std430) readonly buffer Draws {
+    DrawData draws[];
+};
+
+#if defined(COMPACT_VERTEX) && !defined(DEPTH_ONLY)
+layout(binding = 10, std430) readonly buffer VertexColors {
+    uint vertex_colors[];
+};
+#endif
+
+uniform uint first_draw;
+
+#ifdef VISIBILITY
+uniform uint instance_phase;
+#endif
+
+#ifdef DRAW_PARAMETERS
+#define draw_id gl_DrawIDARB
+#else
+// Draws are submitted one by one without the extension
+uniform uint draw_id;
+#endif
 
 void main() {
-    const vec4 position = model * vec4(in_pos, 1.0);
+    const DrawData draw = draws[first_draw + draw_id];
 
-    out_normal = normalize(mat3(model) * in_normal);
-    out_tangent = normalize(mat3(model) * in_tangent_bitangent_sign.xyz);
-    out_bitangent = cross(out_tangent, out_normal) * (in_tangent_bitangent_sign.w > 0.0 ? 1.0 : -1.0);
+#ifdef COMPACT_VERTEX
+    const vec3 local_pos = draw.position_min + in_pos_bitangent_sign.xyz * draw.position_extent;
+    const vec3 normal = oct_decode(in_oct_normal);
+    const vec3 tangent = oct_decode(in_oct_tangent);
+    const float bitangent_sign = in_pos_bitangent_sign.w;
+#else
+    const vec3 local_pos = in_pos;
+    const vec3 normal = in_normal;
+    const vec3 tangent = in_tangent_bitangent_sign.xyz;
+    const float bitangent_sign = in_tangent_bitangent_sign.w;
+#endif
 
-    out_uv = in_uv;
+    const mat4 model = instance_models[draw.first_instance + gl_InstanceID];
+    const vec4 position = model * vec4(local_pos, 1.0);
+
+#ifndef DEPTH_ONLY
+    out_normal = normalize(mat3(model) * normal);
+    out_tangent = normalize(mat3(model) * tangent);
+    out_bitangent = cross(out_tangent, out_normal) * (bitangent_sign > 0.0 ? 1.0 : -1.0);
+#ifdef COMPACT_VERTEX
+    out_color = draw.has_colors != 0 ? unpackUnorm4x8(vertex_colors[gl_VertexID + draw.color_offset]).rgb : in_color;
+#else
     out_color = in_color;
+#endif
     out_position = position.xyz;
+#endif
+
+#if defined(BINDLESS) || defined(TEXTURE_ARRAYS)
+    out_material = draw.material_index;
+#endif
+
+    out_uv = in_uv;
+
+#ifdef VISIBILITY
+    out_instance = (draw.first_instance + gl_InstanceID) | (instance_phase << 31);
+#endif
 
     gl_Position = frame.camera.view_proj * position;
 }
@@ -0,0 +1,38 @@
+#version 450
+
+#include "utils.glsl"
+#include "lighting.glsl"
+
+// fragment shader of the deferred lighting pass, shades every pixel covered by the G-buffer once.
+// Blended on top of the emissive written by gbuffer.frag
+
+layout(location = 0) out vec4 out_color;
+
+layout(location = 0) in vec2 in_uv;
+
+layout(binding = 0) uniform sampler2D in_albedo_metal;
+layout(binding = 1) uniform sampler2D in_normal_rough;
+layout(binding = 2) uniform sampler2D in_depth;
+
+#include "shading.glsl"
+
+void main() {
+    const ivec2 coord = ivec2(gl_FragCoord.xy);
+
+    // Nothing was drawn over the sky, depth is still cleared to 0 (reverse-Z)
+    const float depth = texelFetch(in_depth, coord, 0).r;
+    if(depth == 0.0) {
+        discard;
+    }
+
+    const vec4 albedo_metal = texelFetch(in_albedo_metal, coord, 0);
+    const vec4 normal_rough = texelFetch(in_normal_rough, coord, 0);
+
+    const vec3 position = unproject(in_uv, depth, frame.camera.inv_view_proj);
+    const vec3 normal = oct_decode(normal_rough.xy * 2.0 - 1.0);
+
+    uint light_count = 0;
+    const vec3 acc = shade(position, normal, albedo_metal.rgb, albedo_metal.a, normal_rough.z, light_count);
+
+    out_color = vec4(light_heatmap(acc, light_count), 1.0);
+}
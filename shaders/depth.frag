@@ -0,0 +1,39 @@
+#version 450
+
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#ifdef NONUNIFORM_HANDLES
+#extension GL_NV_gpu_shader5 : require
+#else
+#extension GL_KHR_shader_subgroup_ballot : require
+#endif
+#endif
+
+#include "utils.glsl"
+
+// fragment shader of the depth prepass, which only has to discard alpha tested fragments.
+// With VISIBILITY, it also writes the instance slot and triangle covering the pixel, for visibility.frag
+
+#ifdef VISIBILITY
+layout(location = 0) out uvec2 out_visibility;
+
+layout(location = 7) flat in uint in_instance;
+#endif
+
+#ifdef ALPHA_TEST
+layout(location = 1) in vec2 in_uv;
+
+#include "material.glsl"
+#endif
+
+void main() {
+#ifdef ALPHA_TEST
+    if(material_texture(0).a <= material_params().alpha_cutoff) {
+        discard;
+    }
+#endif
+
+#ifdef VISIBILITY
+    out_visibility = uvec2(in_instance, gl_PrimitiveID);
+#endif
+}
@@ -0,0 +1,42 @@
+#version 450
+
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#ifdef NONUNIFORM_HANDLES
+#extension GL_NV_gpu_shader5 : require
+#else
+#extension GL_KHR_shader_subgroup_ballot : require
+#endif
+#endif
+
+#include "utils.glsl"
+
+// fragment shader of the deferred geometry pass, lighting is evaluated later by deferred.frag.
+// Emissive goes straight to the lit HDR target, which the lighting pass adds to
+
+layout(location = 0) out vec4 out_emissive;
+layout(location = 1) out vec4 out_albedo_metal;
+layout(location = 2) out vec4 out_normal_rough;
+
+layout(location = 0) in vec3 in_normal;
+layout(location = 1) in vec2 in_uv;
+layout(location = 2) in vec3 in_color;
+layout(location = 3) in vec3 in_position;
+layout(location = 4) in vec3 in_tangent;
+layout(location = 5) in vec3 in_bitangent;
+
+#include "material.glsl"
+
+void main() {
+    const Surface surface = eval_material(in_normal, in_tangent, in_bitangent, in_color);
+
+#ifdef ALPHA_TEST
+    if(surface.alpha <= material_params().alpha_cutoff) {
+        discard;
+    }
+#endif
+
+    out_emissive = vec4(surface.emissive, 1.0);
+    out_albedo_metal = vec4(surface.base_color, surface.metallic);
+    out_normal_rough = vec4(oct_encode(surface.normal) * 0.5 + 0.5, surface.roughness, 0.0);
+}
@@ -1,5 +1,14 @@
 #version 450
 
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#ifdef NONUNIFORM_HANDLES
+#extension GL_NV_gpu_shader5 : require
+#else
+#extension GL_KHR_shader_subgroup_ballot : require
+#endif
+#endif
+
 #include "utils.glsl"
 #include "lighting.glsl"
 
@@ -19,74 +28,27 @@ layout(location = 3) in vec3 in_position;
 layout(location = 4) in vec3 in_tangent;
 layout(location = 5) in vec3 in_bitangent;
 
-layout(binding = 0) uniform sampler2D in_texture;
-layout(binding = 1) uniform sampler2D in_normal_texture;
-layout(binding = 2) uniform sampler2D in_metal_rough;
-layout(binding = 3) uniform sampler2D in_emissive;
-
-uniform vec3 base_color_factor;
-uniform vec2 metal_rough_factor;
-uniform vec3 emissive_factor;
-uniform float alpha_cutoff;
+#include "material.glsl"
 
-layout(binding = 4) uniform samplerCube in_envmap;
-layout(binding = 5) uniform sampler2D brdf_lut;
-
-layout(binding = 0) uniform Data {
-    FrameData frame;
-};
-
-layout(binding = 1) buffer PointLights {
-    PointLight point_lights[];
-};
+#include "shading.glsl"
 
 void main() {
-    const vec3 normal_map = unpack_normal_map(texture(in_normal_texture, in_uv).xy);
-    const vec3 normal = normal_map.x * in_tangent +
-                        normal_map.y * in_bitangent +
-                        normal_map.z * in_normal;
-
-    const vec4 albedo_tex = texture(in_texture, in_uv);
-    const vec3 base_color = in_color.rgb * albedo_tex.rgb * base_color_factor;
-    const float alpha = albedo_tex.a;
+    const Surface surface = eval_material(in_normal, in_tangent, in_bitangent, in_color);
 
 #ifdef ALPHA_TEST
-    if(alpha <= alpha_cutoff) {
+    if(surface.alpha <= material_params().alpha_cutoff) {
         discard;
     }
 #endif
 
-    const vec4 metal_rough_tex = texture(in_metal_rough, in_uv);
-    const float roughness = metal_rough_tex.g * metal_rough_factor.y; // as per glTF spec
-    const float metallic = metal_rough_tex.b * metal_rough_factor.x; // as per glTF spec
-
-
-    const vec3 to_view = (frame.camera.position - in_position);
-    const vec3 view_dir = normalize(to_view);
-
-    vec3 acc = texture(in_emissive, in_uv).rgb * emissive_factor;
-    acc += eval_ibl(in_envmap, brdf_lut, normal, view_dir, base_color, metallic, roughness) * frame.ibl_intensity;
-    {
-        acc += frame.sun_color * eval_brdf(normal, view_dir, frame.sun_dir, base_color, metallic, roughness);
-
-        for(uint i = 0; i != frame.point_light_count; ++i) {
-            PointLight light = point_lights[i];
-            const vec3 to_light = (light.position - in_position);
-            const float dist = length(to_light);
-            const vec3 light_vec = to_light / dist;
-
-            const float att = attenuation(dist, light.radius);
-            if(att <= 0.0f) {
-                continue;
-            }
-
-            acc += eval_brdf(normal, view_dir, light_vec, base_color, metallic, roughness) * att * light.color;
-        }
-    }
-
+    const vec3 normal = surface.normal;
+    const float metallic = surface.metallic;
+    const float roughness = surface.roughness;
 
-    out_color = vec4(acc, alpha);
+    uint light_count = 0;
+    const vec3 acc = surface.emissive + shade(in_position, normal, surface.base_color, metallic, roughness, light_count);
 
+    out_color = vec4(light_heatmap(acc, light_count), frame.light_heatmap != 0 ? 1.0 : surface.alpha);
 
 #ifdef DEBUG_NORMAL
     out_color = vec4(normal * 0.5 + 0.5, 1.0);
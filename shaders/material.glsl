@@ -0,0 +1,115 @@
+// Material parameters and textures, shared by the fragment shaders drawing scene objects which must declare in_uv first.
+// With MATERIAL_GRADIENTS (full screen passes, without derivatives), in_uv, in_uv_dx, in_uv_dy and in_material are globals set by the shader
+
+#if defined(BINDLESS) || defined(TEXTURE_ARRAYS)
+#ifndef MATERIAL_GRADIENTS
+layout(location = 6) flat in uint in_material;
+#endif
+
+// Indexed by the per draw material id, so materials sharing a program can be drawn together
+layout(binding = 4, std430) readonly buffer Materials {
+    MaterialParams materials[];
+};
+#endif
+
+#ifdef MATERIAL_GRADIENTS
+#define sample_material(tex, uv) textureGrad(tex, uv, in_uv_dx, in_uv_dy)
+#else
+#define sample_material(tex, uv) texture(tex, uv)
+#endif
+
+// Material textures: 0 is albedo, 1 normal, 2 metal rough and 3 emissive
+#if defined(BINDLESS)
+#if defined(NONUNIFORM_HANDLES)
+// Handles may differ between invocations with GL_NV_gpu_shader5
+vec4 material_texture(uint slot) {
+    return sample_material(sampler2D(materials[in_material].textures[slot]), in_uv);
+}
+#else
+// GL_ARB_bindless_texture needs dynamically uniform handles, which neither the per pixel material of full screen passes
+// nor the flat in_material of batched multi draws are (only gl_DrawIDARB is, in vertex shaders).
+// Each iteration samples the material of the first active invocation of the subgroup, uniform per GL_KHR_shader_subgroup_ballot
+vec4 material_texture(uint slot) {
+#ifndef MATERIAL_GRADIENTS
+    // Implicit derivatives are undefined in the divergent loop
+    const vec2 in_uv_dx = dFdx(in_uv);
+    const vec2 in_uv_dy = dFdy(in_uv);
+#endif
+    vec4 color = vec4(0.0);
+    for(;;) {
+        const uint material = subgroupBroadcastFirst(in_material);
+        if(material == in_material) {
+            color = textureGrad(sampler2D(materials[material].textures[slot]), in_uv, in_uv_dx, in_uv_dy);
+            break;
+        }
+    }
+    return color;
+}
+#endif
+#elif defined(TEXTURE_ARRAYS)
+// Batched draws share these arrays, the layers come from the material table
+layout(binding = 0) uniform sampler2DArray in_texture_arrays[4];
+
+vec4 material_texture(uint slot) {
+    return sample_material(in_texture_arrays[slot], vec3(in_uv, float(materials[in_material].textures[slot].x)));
+}
+#else
+layout(binding = 0) uniform sampler2D in_textures[4];
+
+vec4 material_texture(uint slot) {
+    return sample_material(in_textures[slot], in_uv);
+}
+#endif
+
+#if !defined(BINDLESS) && !defined(TEXTURE_ARRAYS)
+uniform vec3 base_color_factor;
+uniform vec2 metal_rough_factor;
+uniform vec3 emissive_factor;
+uniform float alpha_cutoff;
+
+MaterialParams material_params() {
+    MaterialParams params;
+    params.base_color_factor = base_color_factor;
+    params.metal_rough_factor = metal_rough_factor;
+    params.emissive_factor = emissive_factor;
+    params.alpha_cutoff = alpha_cutoff;
+    return params;
+}
+#else
+MaterialParams material_params() {
+    return materials[in_material];
+}
+#endif
+
+struct Surface {
+    vec3 normal;
+    vec3 base_color;
+    float alpha;
+    float metallic;
+    float roughness;
+    vec3 emissive;
+};
+
+// Alpha testing is left to the caller, against material_params().alpha_cutoff
+Surface eval_material(vec3 vertex_normal, vec3 tangent, vec3 bitangent, vec3 vertex_color) {
+    const MaterialParams params = material_params();
+
+    Surface surface;
+
+    const vec3 normal_map = unpack_normal_map(material_texture(1).xy);
+    surface.normal = normal_map.x * tangent +
+                     normal_map.y * bitangent +
+                     normal_map.z * vertex_normal;
+
+    const vec4 albedo_tex = material_texture(0);
+    surface.base_color = vertex_color * albedo_tex.rgb * params.base_color_factor;
+    surface.alpha = albedo_tex.a;
+
+    const vec4 metal_rough_tex = material_texture(2);
+    surface.roughness = metal_rough_tex.g * params.metal_rough_factor.y; // as per glTF spec
+    surface.metallic = metal_rough_tex.b * params.metal_rough_factor.x; // as per glTF spec
+
+    surface.emissive = material_texture(3).rgb * params.emissive_factor;
+
+    return surface;
+}
@@ -0,0 +1,67 @@
+// Lighting of a surface by the sun, the environment and point lights, shared by the forward and deferred lighting passes
+
+layout(binding = 4) uniform samplerCube in_envmap;
+layout(binding = 5) uniform sampler2D brdf_lut;
+
+layout(binding = 0) uniform Data {
+    FrameData frame;
+};
+
+layout(binding = 1) buffer PointLights {
+    PointLight point_lights[];
+};
+
+layout(binding = 5, std430) readonly buffer ClusterLightCounts {
+    uint cluster_light_counts[];
+};
+
+layout(binding = 6, std430) readonly buffer ClusterLightIndices {
+    uint cluster_light_indices[];
+};
+
+// light_count is the number of point lights evaluated for the fragment
+vec3 shade(vec3 position, vec3 normal, vec3 base_color, float metallic, float roughness, out uint light_count) {
+    const vec3 to_view = (frame.camera.position - position);
+    const vec3 view_dir = normalize(to_view);
+
+    light_count = frame.point_light_count;
+
+    vec3 acc = eval_ibl(in_envmap, brdf_lut, normal, view_dir, base_color, metallic, roughness) * frame.ibl_intensity;
+    {
+        acc += frame.sun_color * eval_brdf(normal, view_dir, frame.sun_dir, base_color, metallic, roughness);
+
+        // With clustered lighting, only the lights binned in the fragment's cluster can reach it
+        const bool clustered = frame.cluster_grid.z != 0;
+        uint cluster = 0;
+        if(clustered) {
+            const uvec2 tile = min(uvec2(gl_FragCoord.xy) / frame.cluster_tile_size, frame.cluster_grid.xy - 1);
+            const uint slice = cluster_slice(frame, dot(position - frame.camera.position, frame.camera.frustum.near_normal));
+            cluster = (slice * frame.cluster_grid.y + tile.y) * frame.cluster_grid.x + tile.x;
+            light_count = slice < frame.cluster_grid.z ? cluster_light_counts[cluster] : 0;
+        }
+
+        for(uint i = 0; i != light_count; ++i) {
+            PointLight light = point_lights[clustered ? cluster_light_indices[cluster * frame.max_lights_per_cluster + i] : i];
+            const vec3 to_light = (light.position - position);
+            const float dist = length(to_light);
+            const vec3 light_vec = to_light / dist;
+
+            const float att = attenuation(dist, light.radius);
+            if(att <= 0.0f) {
+                continue;
+            }
+
+            acc += eval_brdf(normal, view_dir, light_vec, base_color, metallic, roughness) * att * light.color;
+        }
+    }
+
+    return acc;
+}
+
+// Replaces the shading by the number of lights evaluated, when enabled
+vec3 light_heatmap(vec3 color, uint light_count) {
+    if(frame.light_heatmap != 0) {
+        return heatmap(log2(float(light_count) + 1.0) / log2(float(frame.max_lights_per_cluster) + 1.0));
+    }
+    return color;
+}
@@ -1,8 +1,23 @@
+// Inward facing plane normals, every plane but the near one goes through the camera
+struct FrustumData {
+    vec3 near_normal;
+    float padding_0;
+    vec3 top_normal;
+    float padding_1;
+    vec3 bottom_normal;
+    float padding_2;
+    vec3 right_normal;
+    float padding_3;
+    vec3 left_normal;
+    float padding_4;
+};
+
 struct CameraData {
     mat4 view_proj;
     mat4 inv_view_proj;
     vec3 position;
     float padding;
+    FrustumData frustum;
 };
 
 struct FrameData {
@@ -13,6 +28,15 @@ struct FrameData {
 
     vec3 sun_color;
     float ibl_intensity;
+
+    // Tiles along x and y, then depth slices. Slice 0 ends at cluster_depth_min, the others are exponentially distributed.
+    // A z of 0 disables clustered lighting
+    uvec3 cluster_grid;
+    uint cluster_tile_size; // In pixels
+    float cluster_depth_min;
+    float cluster_depth_scale; // Slices past the first one per log of view depth
+    uint max_lights_per_cluster;
+    uint light_heatmap;
 };
 
 struct PointLight {
@@ -22,3 +46,85 @@ struct PointLight {
     float padding;
 };
 
+// Cluster of triangles, stored contiguously in the mesh index buffer
+struct Meshlet {
+    vec3 center;
+    float radius;
+    vec3 cone_axis;
+    float cone_cutoff; // Backfacing if dot(center - eye, cone_axis) >= cone_cutoff * length(center - eye) + radius
+    uint first_index;
+    uint triangle_count;
+    uint padding_0;
+    uint padding_1;
+};
+
+struct MeshletCullingStats {
+    uint frustum_culled;
+    uint backface_culled;
+    uint visible_meshlets;
+    uint visible_triangles;
+};
+
+struct ObjectCullingStats {
+    uint frustum_culled;
+    uint small_culled;
+    uint visible;
+    uint occluded;
+};
+
+// Instance tested by object culling
+struct CullItem {
+    uint object;
+    uint draw;
+    uint occlusion_culling; // 0 for instances that must not be occluded (transparent or meshlet culled)
+    uint meshlet_culled; // Drawn with the meshlet culler's command regardless of the instance count, its transform is always written
+};
+
+// Indirect dispatch arguments of the occlusion re-test, followed by the indices of the instances to test again
+struct OcclusionRetest {
+    uint dispatch_x;
+    uint dispatch_y;
+    uint dispatch_z;
+    uint count;
+};
+
+// Per draw data of multi draws, for the draw_id-th draw after first_draw
+struct DrawData {
+    vec3 position_min;
+    uint first_instance;
+    vec3 position_extent;
+    uint material_index;
+    // Compact vertex colors of the draw are at gl_VertexID + color_offset, see GeometryPool::bind_vertex_attribs
+    int color_offset;
+    uint has_colors;
+    uint padding_0;
+    uint padding_1;
+};
+
+// Entry of the material table, textures are bindless handles (low, high) or texture array layers (layer, 0)
+struct MaterialParams {
+    vec3 base_color_factor;
+    float alpha_cutoff;
+    vec3 emissive_factor;
+    uint padding_0;
+    vec2 metal_rough_factor;
+    vec2 padding_1;
+    uvec2 textures[4]; // Albedo, normal, metal rough and emissive
+};
+
+struct DrawElementsIndirectCommand {
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+
+// Draw and index range of every instance slot, so the visibility buffer only has to store slots and triangles.
+// Slots keep their draw with GPU culling, visible instances are compacted from the draw's first instance
+struct VisibilityInstance {
+    uint draw;
+    uint first_index;
+    int base_vertex;
+    uint short_indices;
+};
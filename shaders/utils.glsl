@@ -30,6 +30,36 @@ float luminance(vec3 rgb) {
     return dot(rgb, vec3(0.2126, 0.7152, 0.0722));
 }
 
+bool is_in_frustum(CameraData camera, vec3 center, float radius) {
+    const vec3 v = center - camera.position;
+    return dot(v, camera.frustum.near_normal) > -radius &&
+           dot(v, camera.frustum.top_normal) > -radius &&
+           dot(v, camera.frustum.bottom_normal) > -radius &&
+           dot(v, camera.frustum.right_normal) > -radius &&
+           dot(v, camera.frustum.left_normal) > -radius;
+}
+
+// Depth slice of the light cluster grid containing a view depth, frame.cluster_grid.z if it is past the last one
+uint cluster_slice(FrameData frame, float view_depth) {
+    if(view_depth < frame.cluster_depth_min) {
+        return 0;
+    }
+    return min(1 + uint(log(view_depth / frame.cluster_depth_min) * frame.cluster_depth_scale), frame.cluster_grid.z);
+}
+
+// View depths covered by a slice of the light cluster grid
+vec2 cluster_slice_depths(FrameData frame, uint slice) {
+    if(slice == 0) {
+        return vec2(0.0, frame.cluster_depth_min);
+    }
+    return frame.cluster_depth_min * exp(vec2(float(slice - 1), float(slice)) / frame.cluster_depth_scale);
+}
+
+// Blue to green to red, for t in [0; 1]
+vec3 heatmap(float t) {
+    return saturate(vec3(2.0 * t - 1.0, 1.0 - abs(2.0 * t - 1.0), 1.0 - 2.0 * t));
+}
+
 float attenuation(float distance, float radius) {
     const float x = min(distance, radius);
     return sqr(1.0 - sqr(sqr(x / radius))) / (sqr(x) + 1.0);
@@ -66,6 +96,22 @@ vec3 unpack_normal_map(vec2 normal) {
     return vec3(normal, 1.0 - sqrt(dot(normal, normal)));
 }
 
+vec2 oct_encode(vec3 v) {
+    const vec3 n = v / (abs(v.x) + abs(v.y) + abs(v.z));
+    if(n.z >= 0.0) {
+        return n.xy;
+    }
+    return (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 oct_decode(vec2 e) {
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if(v.z < 0.0) {
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(v);
+}
+
 vec2 to_equirec(vec3 v) {
     return -vec2(atan(-v.y, v.x), asin(v.z)) * vec2(0.1591, 0.3183) + 0.5;
 }
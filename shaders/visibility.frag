@@ -0,0 +1,189 @@
+#version 450
+
+#extension GL_ARB_bindless_texture : require
+#ifdef NONUNIFORM_HANDLES
+#extension GL_NV_gpu_shader5 : require
+#else
+#extension GL_KHR_shader_subgroup_ballot : require
+#endif
+
+#include "utils.glsl"
+#include "lighting.glsl"
+
+// fragment shader of the visibility buffer shading pass: fetches the triangle covering the pixel from the geometry pool,
+// rebuilds its attributes and shades it like lit.frag, once per pixel. Only used with bindless materials
+
+layout(location = 0) out vec4 out_color;
+
+layout(binding = 0) uniform usampler2D in_visibility;
+layout(binding = 1) uniform sampler2D in_depth;
+
+// Transforms of both culling phases, see basic.vert
+layout(binding = 2, std430) readonly buffer Instances {
+    mat4 instance_models[];
+};
+
+layout(binding = 7, std430) readonly buffer RetestedInstances {
+    mat4 retested_instance_models[];
+};
+
+layout(binding = 3, std430) readonly buffer Draws {
+    DrawData draws[];
+};
+
+layout(binding = 8, std430) readonly buffer VisibilityInstances {
+    VisibilityInstance visibility_instances[];
+};
+
+layout(binding = 9, std430) readonly buffer Vertices {
+    uint vertex_data[];
+};
+
+#ifdef COMPACT_VERTEX
+layout(binding = 10, std430) readonly buffer VertexColors {
+    uint vertex_colors[];
+};
+#endif
+
+layout(binding = 11, std430) readonly buffer ShortIndices {
+    uint short_indices[];
+};
+
+layout(binding = 12, std430) readonly buffer Indices {
+    uint indices[];
+};
+
+// Set before evaluating the material, see material.glsl
+#define MATERIAL_GRADIENTS
+vec2 in_uv;
+vec2 in_uv_dx;
+vec2 in_uv_dy;
+uint in_material;
+
+#include "material.glsl"
+#include "shading.glsl"
+
+struct MeshVertex {
+    vec3 position;
+    vec3 normal;
+    vec3 tangent;
+    float bitangent_sign;
+    vec2 uv;
+    vec3 color;
+};
+
+// Same layouts as GeometryPool::bind_vertex_attribs
+MeshVertex fetch_vertex(uint index, DrawData draw) {
+    MeshVertex vertex;
+#ifdef COMPACT_VERTEX
+    const uint base = index * 5;
+    const vec4 pos_bitangent_sign = vec4(unpackUnorm2x16(vertex_data[base]), unpackUnorm2x16(vertex_data[base + 1]));
+    vertex.position = draw.position_min + pos_bitangent_sign.xyz * draw.position_extent;
+    vertex.bitangent_sign = pos_bitangent_sign.w;
+    vertex.normal = oct_decode(unpackSnorm2x16(vertex_data[base + 2]));
+    vertex.tangent = oct_decode(unpackSnorm2x16(vertex_data[base + 3]));
+    vertex.uv = unpackHalf2x16(vertex_data[base + 4]);
+    vertex.color = draw.has_colors != 0 ? unpackUnorm4x8(vertex_colors[int(index) + draw.color_offset]).rgb : vec3(1.0);
+#else
+    const uint base = index * 15;
+    vec3 v[5];
+    for(uint i = 0; i != 5; ++i) {
+        v[i] = uintBitsToFloat(uvec3(vertex_data[base + i * 3], vertex_data[base + i * 3 + 1], vertex_data[base + i * 3 + 2]));
+    }
+    vertex.position = v[0];
+    vertex.normal = v[1];
+    vertex.uv = v[2].xy;
+    vertex.tangent = vec3(v[2].z, v[3].xy);
+    vertex.bitangent_sign = v[3].z;
+    vertex.color = v[4];
+#endif
+    return vertex;
+}
+
+uint fetch_index(VisibilityInstance instance, uint i) {
+    if(instance.short_indices != 0) {
+        const uint word = short_indices[i >> 1];
+        return (i & 1) != 0 ? word >> 16 : word & 0xFFFF;
+    }
+    return indices[i];
+}
+
+// Perspective correct barycentrics of the triangle at ndc, and how they change from one pixel to the next
+struct Barycentrics {
+    vec3 b;
+    vec3 ddx;
+    vec3 ddy;
+};
+
+Barycentrics barycentrics(vec4 c0, vec4 c1, vec4 c2, vec2 ndc, vec2 pixel_size) {
+    const vec3 inv_w = 1.0 / vec3(c0.w, c1.w, c2.w);
+    const vec2 n0 = c0.xy * inv_w.x;
+    const vec2 n1 = c1.xy * inv_w.y;
+    const vec2 n2 = c2.xy * inv_w.z;
+
+    // Screen space barycentrics are linear in ndc, divided by w they can be interpolated linearly too
+    const float inv_det = 1.0 / determinant(mat2(n2 - n1, n0 - n1));
+    vec3 ddx = vec3(n1.y - n2.y, n2.y - n0.y, n0.y - n1.y) * inv_det * inv_w;
+    vec3 ddy = vec3(n2.x - n1.x, n0.x - n2.x, n1.x - n0.x) * inv_det * inv_w;
+
+    const vec2 delta = ndc - n0;
+    const vec3 b_over_w = vec3(inv_w.x, 0.0, 0.0) + delta.x * ddx + delta.y * ddy;
+    const float interp_inv_w = b_over_w.x + b_over_w.y + b_over_w.z;
+
+    Barycentrics result;
+    result.b = b_over_w / interp_inv_w;
+
+    ddx *= pixel_size.x;
+    ddy *= pixel_size.y;
+    result.ddx = (b_over_w + ddx) / (interp_inv_w + ddx.x + ddx.y + ddx.z) - result.b;
+    result.ddy = (b_over_w + ddy) / (interp_inv_w + ddy.x + ddy.y + ddy.z) - result.b;
+    return result;
+}
+
+void main() {
+    const ivec2 coord = ivec2(gl_FragCoord.xy);
+
+    // Nothing was drawn over the sky, depth is still cleared to 0 (reverse-Z)
+    if(texelFetch(in_depth, coord, 0).r == 0.0) {
+        discard;
+    }
+
+    const uvec2 visibility = texelFetch(in_visibility, coord, 0).xy;
+    const bool retested = (visibility.x >> 31) != 0;
+    const uint slot = visibility.x & 0x7FFFFFFF;
+
+    const VisibilityInstance instance = visibility_instances[slot];
+    const DrawData draw = draws[instance.draw];
+    const mat4 model = retested ? retested_instance_models[slot] : instance_models[slot];
+
+    MeshVertex vertices[3];
+    vec4 clip[3];
+    for(uint i = 0; i != 3; ++i) {
+        const uint index = fetch_index(instance, instance.first_index + visibility.y * 3 + i);
+        vertices[i] = fetch_vertex(uint(int(index) + instance.base_vertex), draw);
+        clip[i] = frame.camera.view_proj * (model * vec4(vertices[i].position, 1.0));
+    }
+
+    const vec2 size = vec2(textureSize(in_visibility, 0));
+    const vec2 ndc = gl_FragCoord.xy / size * 2.0 - 1.0;
+    const Barycentrics bary = barycentrics(clip[0], clip[1], clip[2], ndc, 2.0 / size);
+
+    #define INTERPOLATE(attrib) (vertices[0].attrib * bary.b.x + vertices[1].attrib * bary.b.y + vertices[2].attrib * bary.b.z)
+
+    const vec3 position = (model * vec4(INTERPOLATE(position), 1.0)).xyz;
+    const vec3 normal = normalize(mat3(model) * INTERPOLATE(normal));
+    const vec3 tangent = normalize(mat3(model) * INTERPOLATE(tangent));
+    const vec3 bitangent = cross(tangent, normal) * (vertices[0].bitangent_sign > 0.0 ? 1.0 : -1.0);
+
+    in_material = draw.material_index;
+    in_uv = INTERPOLATE(uv);
+    in_uv_dx = vertices[0].uv * bary.ddx.x + vertices[1].uv * bary.ddx.y + vertices[2].uv * bary.ddx.z;
+    in_uv_dy = vertices[0].uv * bary.ddy.x + vertices[1].uv * bary.ddy.y + vertices[2].uv * bary.ddy.z;
+
+    const Surface surface = eval_material(normal, tangent, bitangent, INTERPOLATE(color));
+
+    uint light_count = 0;
+    const vec3 acc = surface.emissive + shade(position, surface.normal, surface.base_color, surface.metallic, surface.roughness, light_count);
+
+    out_color = vec4(light_heatmap(acc, light_count), 1.0);
+}
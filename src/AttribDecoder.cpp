@@ -0,0 +1,292 @@
+#include "AttribDecoder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OM3D_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace OM3D {
+
+bool simd_attrib_decoding = true;
+
+u32 component_byte_size(ComponentType type) {
+    switch(type) {
+        case ComponentType::Byte:
+        case ComponentType::UnsignedByte:
+            return 1;
+
+        case ComponentType::Short:
+        case ComponentType::UnsignedShort:
+            return 2;
+
+        case ComponentType::Int:
+        case ComponentType::UnsignedInt:
+        case ComponentType::Float:
+            return 4;
+    }
+
+    return 0;
+}
+
+
+template<typename T>
+static T load(const u8* data) {
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+template<typename T>
+static constexpr float normalization_factor() {
+    return 1.0f / float(std::numeric_limits<T>::max());
+}
+
+// As per glTF spec: c / MAX for unsigned types and max(c / MAX, -1) for signed ones
+template<typename T, bool Normalized>
+static float convert_component(T c) {
+    if constexpr(!Normalized || std::is_floating_point_v<T>) {
+        return float(c);
+    } else if constexpr(std::is_signed_v<T>) {
+        return std::max(float(c) * normalization_factor<T>(), -1.0f);
+    } else {
+        return float(c) * normalization_factor<T>();
+    }
+}
+
+
+#ifdef OM3D_SSE2
+template<typename T, u32 N>
+static constexpr size_t simd_load_size() {
+    constexpr size_t bytes = N * sizeof(T);
+    return bytes <= 4 ? 4 : (bytes <= 8 ? 8 : 16);
+}
+
+// Loads N components into the first lanes of a float4, the remaining lanes hold garbage
+template<typename T, u32 N, bool Normalized>
+static __m128 load_simd(const u8* data) {
+    constexpr size_t load_size = simd_load_size<T, N>();
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i raw;
+    if constexpr(load_size == 4) {
+        raw = _mm_cvtsi32_si128(load<int>(data));
+    } else if constexpr(load_size == 8) {
+        raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+    } else {
+        raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    }
+
+    __m128 v;
+    if constexpr(std::is_same_v<T, float>) {
+        return _mm_castsi128_ps(raw);
+    } else if constexpr(std::is_same_v<T, u8>) {
+        v = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(raw, zero), zero));
+    } else if constexpr(std::is_same_v<T, i8>) {
+        const __m128i x = _mm_unpacklo_epi8(raw, raw);
+        v = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 24));
+    } else if constexpr(std::is_same_v<T, u16>) {
+        v = _mm_cvtepi32_ps(_mm_unpacklo_epi16(raw, zero));
+    } else {
+        static_assert(std::is_same_v<T, i16>);
+        v = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16));
+    }
+
+    if constexpr(Normalized) {
+        v = _mm_mul_ps(v, _mm_set1_ps(normalization_factor<T>()));
+        if constexpr(std::is_signed_v<T>) {
+            v = _mm_max_ps(v, _mm_set1_ps(-1.0f));
+        }
+    }
+
+    return v;
+}
+
+// om3d_decode_bench only shows a consistent win for packed float3 and float4 inputs,
+// the other formats are memory bound and the SIMD kernels are neutral or slower (u16x4 with stride 8)
+template<typename T, u32 N, bool Packed>
+static constexpr bool use_simd_kernel() {
+    return Packed && std::is_same_v<T, float> && N >= 3;
+}
+
+template<u32 N>
+static void store_simd(float* out, __m128 v) {
+    if constexpr(N == 4) {
+        _mm_storeu_ps(out, v);
+    } else if constexpr(N == 3) {
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), v);
+        _mm_store_ss(out + 2, _mm_movehl_ps(v, v));
+    } else if constexpr(N == 2) {
+        _mm_storel_pi(reinterpret_cast<__m64*>(out), v);
+    } else {
+        _mm_store_ss(out, v);
+    }
+}
+#endif
+
+
+using DecodeKernel = void (*)(const u8* in, size_t in_stride, size_t count, float* out, size_t out_stride);
+
+// Packed kernels use a compile time input stride
+template<typename T, u32 N, bool Normalized, bool Packed>
+static void decode_kernel(const u8* in, size_t in_stride, size_t count, float* out, size_t out_stride) {
+    const size_t stride = Packed ? N * sizeof(T) : in_stride;
+    u8* out_bytes = reinterpret_cast<u8*>(out);
+
+    size_t i = 0;
+
+#ifdef OM3D_SSE2
+    if(use_simd_kernel<T, N, Packed>() && simd_attrib_decoding) {
+        // Loads can read past the last component of an element, make sure they never read past the end of the data
+        constexpr size_t load_size = simd_load_size<T, N>();
+        const size_t data_size = (count - 1) * stride + N * sizeof(T);
+        const size_t simd_count = data_size >= load_size ? (data_size - load_size) / stride + 1 : 0;
+
+        for(; i != simd_count; ++i) {
+            store_simd<N>(reinterpret_cast<float*>(out_bytes + i * out_stride), load_simd<T, N, Normalized>(in + i * stride));
+        }
+    }
+#endif
+
+    for(; i != count; ++i) {
+        const u8* elem = in + i * stride;
+        float* out_elem = reinterpret_cast<float*>(out_bytes + i * out_stride);
+        for(u32 c = 0; c != N; ++c) {
+            out_elem[c] = convert_component<T, Normalized>(load<T>(elem + c * sizeof(T)));
+        }
+    }
+}
+
+template<typename T, u32 N>
+static DecodeKernel select_kernel(bool normalized, bool packed) {
+    if(normalized && !std::is_floating_point_v<T>) {
+        return packed ? decode_kernel<T, N, true, true> : decode_kernel<T, N, true, false>;
+    }
+    return packed ? decode_kernel<T, N, false, true> : decode_kernel<T, N, false, false>;
+}
+
+template<typename T>
+static DecodeKernel select_kernel(u32 components, bool normalized, bool packed) {
+    switch(components) {
+        case 1: return select_kernel<T, 1>(normalized, packed);
+        case 2: return select_kernel<T, 2>(normalized, packed);
+        case 3: return select_kernel<T, 3>(normalized, packed);
+        case 4: return select_kernel<T, 4>(normalized, packed);
+        default:
+            return nullptr;
+    }
+}
+
+bool decode_attribs(const u8* in, size_t in_stride, size_t count, ComponentType type, u32 in_components, bool normalized, float* out, size_t out_stride, u32 out_components) {
+    const u32 components = std::min(in_components, out_components);
+    const size_t elem_size = in_components * component_byte_size(type);
+    const size_t stride = in_stride ? in_stride : elem_size;
+    const bool packed = stride == elem_size && components == in_components;
+
+    DecodeKernel kernel = nullptr;
+    switch(type) {
+        case ComponentType::Byte:
+            kernel = select_kernel<i8>(components, normalized, packed);
+        break;
+
+        case ComponentType::UnsignedByte:
+            kernel = select_kernel<u8>(components, normalized, packed);
+        break;
+
+        case ComponentType::Short:
+            kernel = select_kernel<i16>(components, normalized, packed);
+        break;
+
+        case ComponentType::UnsignedShort:
+            kernel = select_kernel<u16>(components, normalized, packed);
+        break;
+
+        case ComponentType::Float:
+            kernel = select_kernel<float>(components, normalized, packed);
+        break;
+
+        default:
+        break;
+    }
+
+    if(!kernel) {
+        return false;
+    }
+
+    if(count) {
+        kernel(in, stride, count, out, out_stride);
+    }
+    return true;
+}
+
+
+template<typename T>
+static void widen_indices(const u8* in, size_t stride, size_t count, u32* out) {
+    size_t i = 0;
+
+    if constexpr(sizeof(T) == sizeof(u32)) {
+        if(stride == sizeof(u32)) {
+            std::memcpy(out, in, count * sizeof(u32));
+            return;
+        }
+    }
+
+#ifdef OM3D_SSE2
+    if(simd_attrib_decoding && stride == sizeof(T)) {
+        const __m128i zero = _mm_setzero_si128();
+        if constexpr(sizeof(T) == 1) {
+            for(; i + 16 <= count; i += 16) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                const __m128i lo = _mm_unpacklo_epi8(v, zero);
+                const __m128i hi = _mm_unpackhi_epi8(v, zero);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 0), _mm_unpacklo_epi16(lo, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), _mm_unpackhi_epi16(lo, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8), _mm_unpacklo_epi16(hi, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 12), _mm_unpackhi_epi16(hi, zero));
+            }
+        } else if constexpr(sizeof(T) == 2) {
+            for(; i + 8 <= count; i += 8) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 0), _mm_unpacklo_epi16(v, zero));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 4), _mm_unpackhi_epi16(v, zero));
+            }
+        }
+    }
+#endif
+
+    for(; i != count; ++i) {
+        out[i] = load<T>(in + i * stride);
+    }
+}
+
+bool decode_indices(const u8* in, size_t in_stride, size_t count, ComponentType type, u32* out) {
+    const size_t stride = in_stride ? in_stride : component_byte_size(type);
+
+    switch(type) {
+        case ComponentType::Byte:
+        case ComponentType::UnsignedByte:
+            widen_indices<u8>(in, stride, count, out);
+        break;
+
+        case ComponentType::Short:
+        case ComponentType::UnsignedShort:
+            widen_indices<u16>(in, stride, count, out);
+        break;
+
+        case ComponentType::Int:
+        case ComponentType::UnsignedInt:
+            widen_indices<u32>(in, stride, count, out);
+        break;
+
+        default:
+            return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,34 @@
+#ifndef ATTRIBDECODER_H
+#define ATTRIBDECODER_H
+
+#include <utils.h>
+
+namespace OM3D {
+
+// Values match the glTF componentType enum
+enum class ComponentType : u32 {
+    Byte = 5120,
+    UnsignedByte = 5121,
+    Short = 5122,
+    UnsignedShort = 5123,
+    Int = 5124,
+    UnsignedInt = 5125,
+    Float = 5126,
+};
+
+u32 component_byte_size(ComponentType type);
+
+// Decodes count elements of in_components components into floats written every out_stride bytes.
+// in_stride of 0 means tightly packed. Integer components are converted to [0; 1] or [-1; 1] if normalized (KHR_mesh_quantization).
+// Only min(in_components, out_components) components are written. Returns false for unsupported formats.
+bool decode_attribs(const u8* in, size_t in_stride, size_t count, ComponentType type, u32 in_components, bool normalized, float* out, size_t out_stride, u32 out_components);
+
+// Widens 8 and 16 bits indices (or copies 32 bits ones) into out. in_stride of 0 means tightly packed
+bool decode_indices(const u8* in, size_t in_stride, size_t count, ComponentType type, u32* out);
+
+// Disables the SIMD kernels, for benchmarking. They are only used for packed float3 and float4 attributes and index widening
+extern bool simd_attrib_decoding;
+
+}
+
+#endif // ATTRIBDECODER_H
@@ -0,0 +1,397 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace OM3D {
+
+static constexpr u32 bin_count = 16;
+// Cost of visiting a node relative to testing an object
+static constexpr float traversal_cost = 1.0f;
+static constexpr u32 invalid_node = u32(-1);
+
+AABB AABB::from_sphere(const glm::vec3& center, float radius) {
+    return AABB{center - radius, center + radius};
+}
+
+void AABB::extend(const AABB& other) {
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+}
+
+bool AABB::is_empty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+glm::vec3 AABB::center() const {
+    return (min + max) * 0.5f;
+}
+
+glm::vec3 AABB::extent() const {
+    return (max - min) * 0.5f;
+}
+
+float AABB::surface_area() const {
+    if(is_empty()) {
+        return 0.0f;
+    }
+    const glm::vec3 size = max - min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static bool operator==(const AABB& a, const AABB& b) {
+    return a.min == b.min && a.max == b.max;
+}
+
+// Distance to the entry point of the ray in the box (0 if it starts inside), or infinity if it misses it
+static float ray_entry(const AABB& box, const glm::vec3& origin, const glm::vec3& inv_dir, float max_distance) {
+    const glm::vec3 t0 = (box.min - origin) * inv_dir;
+    const glm::vec3 t1 = (box.max - origin) * inv_dir;
+    const glm::vec3 near = glm::min(t0, t1);
+    const glm::vec3 far = glm::max(t0, t1);
+    const float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+    const float exit = std::min(std::min(far.x, far.y), std::min(far.z, max_distance));
+    return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+static bool overlaps_sphere(const AABB& box, const glm::vec3& center, float radius) {
+    const glm::vec3 closest = glm::clamp(center, box.min, box.max);
+    const glm::vec3 v = closest - center;
+    return glm::dot(v, v) <= radius * radius;
+}
+
+void BVH::build(Span<const AABB> bounds) {
+    _bounds.assign(bounds.begin(), bounds.end());
+    _objects.resize(_bounds.size());
+    std::iota(_objects.begin(), _objects.end(), 0u);
+    _object_leaves.assign(_bounds.size(), 0);
+
+    _nodes.clear();
+    _parents.clear();
+    if(_bounds.empty()) {
+        return;
+    }
+
+    // A binary tree with at least one object per leaf never has more nodes than this, so references to nodes stay valid
+    _nodes.reserve(2 * _bounds.size());
+    _parents.reserve(2 * _bounds.size());
+
+    _nodes.push_back({{}, 0, u32(_bounds.size())});
+    _parents.push_back(invalid_node);
+
+    _centroids.resize(_bounds.size());
+    for(size_t i = 0; i != _bounds.size(); ++i) {
+        _centroids[i] = _bounds[i].center();
+    }
+
+    std::vector<u32> stack = {0};
+    while(!stack.empty()) {
+        const u32 node_index = stack.back();
+        stack.pop_back();
+        subdivide(node_index, stack);
+    }
+
+    _centroids = {};
+}
+
+void BVH::subdivide(u32 node_index, std::vector<u32>& stack) {
+    Node& node = _nodes[node_index];
+    const u32 first = node.first;
+    const u32 count = node.count;
+    const u32 end = first + count;
+
+    AABB centroids;
+    for(u32 i = first; i != end; ++i) {
+        node.bounds.extend(_bounds[_objects[i]]);
+        const glm::vec3& center = _centroids[_objects[i]];
+        centroids.extend({center, center});
+    }
+
+    auto bin_index = [&](u32 object, u32 axis, float scale) {
+        const float offset = (_centroids[object][axis] - centroids.min[axis]) * scale;
+        return std::min(u32(offset), bin_count - 1);
+    };
+
+    // Binned SAH: the cost of a split is the surface area of each side times its object count
+    float best_cost = std::numeric_limits<float>::infinity();
+    u32 best_axis = 0;
+    u32 best_split = 0;
+    if(count > 2) {
+        for(u32 axis = 0; axis != 3; ++axis) {
+            const float centroid_extent = centroids.max[axis] - centroids.min[axis];
+            if(centroid_extent <= 0.0f) {
+                continue;
+            }
+
+            struct Bin {
+                AABB bounds;
+                u32 count = 0;
+            };
+
+            const float scale = float(bin_count) / centroid_extent;
+            std::array<Bin, bin_count> bins;
+            for(u32 i = first; i != end; ++i) {
+                Bin& bin = bins[bin_index(_objects[i], axis, scale)];
+                bin.bounds.extend(_bounds[_objects[i]]);
+                ++bin.count;
+            }
+
+            // Area and count of everything right of each split
+            std::array<float, bin_count> right_areas = {};
+            std::array<u32, bin_count> right_counts = {};
+            {
+                AABB right;
+                u32 right_count = 0;
+                for(u32 b = bin_count - 1; b != 0; --b) {
+                    right.extend(bins[b].bounds);
+                    right_count += bins[b].count;
+                    right_areas[b] = right.surface_area();
+                    right_counts[b] = right_count;
+                }
+            }
+
+            AABB left;
+            u32 left_count = 0;
+            for(u32 b = 0; b + 1 != bin_count; ++b) {
+                left.extend(bins[b].bounds);
+                left_count += bins[b].count;
+                if(!left_count || !right_counts[b + 1]) {
+                    continue;
+                }
+
+                const float cost = float(left_count) * left.surface_area() + float(right_counts[b + 1]) * right_areas[b + 1];
+                if(cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = b;
+                }
+            }
+        }
+    }
+
+    const float area = node.bounds.surface_area();
+    const bool has_split = best_cost != std::numeric_limits<float>::infinity();
+
+    u32 middle = 0;
+    if(has_split && (traversal_cost * area + best_cost < float(count) * area || count > max_leaf_size)) {
+        const float scale = float(bin_count) / (centroids.max[best_axis] - centroids.min[best_axis]);
+        middle = u32(std::partition(_objects.begin() + first, _objects.begin() + end, [&](u32 object) {
+            return bin_index(object, best_axis, scale) <= best_split;
+        }) - _objects.begin());
+    } else if(count > max_leaf_size) {
+        // Every centroid is in the same place
+        middle = first + count / 2;
+    } else {
+        for(u32 i = first; i != end; ++i) {
+            _object_leaves[_objects[i]] = node_index;
+        }
+        return;
+    }
+
+    const u32 left = u32(_nodes.size());
+    node.first = left;
+    node.count = 0;
+
+    _nodes.push_back({{}, first, middle - first});
+    _nodes.push_back({{}, middle, end - middle});
+    _parents.push_back(node_index);
+    _parents.push_back(node_index);
+
+    stack.push_back(left);
+    stack.push_back(left + 1);
+}
+
+void BVH::refit_node(Node& node) const {
+    node.bounds = {};
+    if(node.count) {
+        for(u32 i = node.first; i != node.first + node.count; ++i) {
+            node.bounds.extend(_bounds[_objects[i]]);
+        }
+    } else {
+        node.bounds.extend(_nodes[node.first].bounds);
+        node.bounds.extend(_nodes[node.first + 1].bounds);
+    }
+}
+
+void BVH::update(u32 object, const AABB& bounds) {
+    DEBUG_ASSERT(object < _bounds.size());
+    _bounds[object] = bounds;
+
+    for(u32 node_index = _object_leaves[object]; node_index != invalid_node; node_index = _parents[node_index]) {
+        Node& node = _nodes[node_index];
+        const AABB previous = node.bounds;
+        refit_node(node);
+        if(node.bounds == previous) {
+            break;
+        }
+    }
+}
+
+void BVH::refit() {
+    // Children are always after their parent
+    for(size_t i = _nodes.size(); i != 0; --i) {
+        refit_node(_nodes[i - 1]);
+    }
+}
+
+size_t BVH::object_count() const {
+    return _bounds.size();
+}
+
+size_t BVH::node_count() const {
+    return _nodes.size();
+}
+
+const AABB& BVH::object_bounds(u32 object) const {
+    DEBUG_ASSERT(object < _bounds.size());
+    return _bounds[object];
+}
+
+void BVH::query_frustum(const Frustum& frustum, const glm::vec3& position, std::vector<u32>& objects) const {
+    if(_nodes.empty()) {
+        return;
+    }
+
+    const std::array<glm::vec3, 5> normals = {
+        frustum._near_normal,
+        frustum._top_normal,
+        frustum._bottom_normal,
+        frustum._right_normal,
+        frustum._left_normal,
+    };
+
+    // Planes a node is entirely inside of are not tested again for its children
+    struct Entry {
+        u32 node;
+        u32 planes;
+    };
+
+    std::vector<Entry> stack = {{0, (1u << normals.size()) - 1}};
+    while(!stack.empty()) {
+        const Entry entry = stack.back();
+        stack.pop_back();
+
+        const Node& node = _nodes[entry.node];
+        const glm::vec3 center = node.bounds.center() - position;
+        const glm::vec3 extent = node.bounds.extent();
+
+        u32 planes = entry.planes;
+        bool outside = false;
+        for(u32 i = 0; i != normals.size() && !outside; ++i) {
+            if(!(planes & (1u << i))) {
+                continue;
+            }
+
+            const float dist = glm::dot(center, normals[i]);
+            const float radius = glm::dot(extent, glm::abs(normals[i]));
+            outside = dist <= -radius;
+            if(dist > radius) {
+                planes &= ~(1u << i);
+            }
+        }
+
+        if(outside) {
+            continue;
+        }
+
+        if(node.count) {
+            objects.insert(objects.end(), _objects.begin() + node.first, _objects.begin() + node.first + node.count);
+        } else {
+            stack.push_back({node.first, planes});
+            stack.push_back({node.first + 1, planes});
+        }
+    }
+}
+
+void BVH::query_sphere(const glm::vec3& center, float radius, std::vector<u32>& objects) const {
+    if(_nodes.empty()) {
+        return;
+    }
+
+    std::vector<u32> stack = {0};
+    while(!stack.empty()) {
+        const Node& node = _nodes[stack.back()];
+        stack.pop_back();
+
+        if(!overlaps_sphere(node.bounds, center, radius)) {
+            continue;
+        }
+
+        if(node.count) {
+            for(u32 i = node.first; i != node.first + node.count; ++i) {
+                if(overlaps_sphere(_bounds[_objects[i]], center, radius)) {
+                    objects.push_back(_objects[i]);
+                }
+            }
+        } else {
+            stack.push_back(node.first);
+            stack.push_back(node.first + 1);
+        }
+    }
+}
+
+bool BVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, RayHit& hit) const {
+    if(_nodes.empty()) {
+        return false;
+    }
+
+    const glm::vec3 inv_dir = 1.0f / direction;
+    float closest = max_distance;
+    u32 closest_object = u32(-1);
+
+    // Nodes are pushed with their entry distance, so those further than the closest hit so far are skipped
+    struct Entry {
+        u32 node;
+        float distance;
+    };
+
+    std::vector<Entry> stack;
+    {
+        const float entry = ray_entry(_nodes[0].bounds, origin, inv_dir, closest);
+        if(entry != std::numeric_limits<float>::infinity()) {
+            stack.push_back({0, entry});
+        }
+    }
+
+    while(!stack.empty()) {
+        const Entry entry = stack.back();
+        stack.pop_back();
+        if(entry.distance > closest) {
+            continue;
+        }
+
+        const Node& node = _nodes[entry.node];
+        if(node.count) {
+            for(u32 i = node.first; i != node.first + node.count; ++i) {
+                const float distance = ray_entry(_bounds[_objects[i]], origin, inv_dir, closest);
+                if(distance != std::numeric_limits<float>::infinity() && (distance < closest || closest_object == u32(-1))) {
+                    closest = distance;
+                    closest_object = _objects[i];
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearest child first
+        Entry left = {node.first, ray_entry(_nodes[node.first].bounds, origin, inv_dir, closest)};
+        Entry right = {node.first + 1, ray_entry(_nodes[node.first + 1].bounds, origin, inv_dir, closest)};
+        if(left.distance < right.distance) {
+            std::swap(left, right);
+        }
+        for(const Entry& child : {left, right}) {
+            if(child.distance != std::numeric_limits<float>::infinity()) {
+                stack.push_back(child);
+            }
+        }
+    }
+
+    if(closest_object == u32(-1)) {
+        return false;
+    }
+
+    hit = {closest_object, closest};
+    return true;
+}
+
+}
@@ -0,0 +1,83 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <Camera.h>
+
+#include <glm/vec3.hpp>
+
+#include <limits>
+#include <vector>
+
+namespace OM3D {
+
+struct AABB {
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+    static AABB from_sphere(const glm::vec3& center, float radius);
+
+    void extend(const AABB& other);
+    bool is_empty() const;
+
+    glm::vec3 center() const;
+    glm::vec3 extent() const; // Half size
+    float surface_area() const;
+};
+
+struct RayHit {
+    u32 object = u32(-1);
+    float distance = 0.0f;
+};
+
+// Bounding volume hierarchy over object bounds, built top-down with binned SAH.
+// Moving objects refit their leaf and its ancestors, which keeps queries correct but degrades the tree as objects
+// drift from where it was built: build it again after large changes.
+class BVH {
+    public:
+        static constexpr u32 max_leaf_size = 8;
+
+        // Object indices are indices in bounds
+        void build(Span<const AABB> bounds);
+
+        // Refits only the nodes above the object, up to the first one whose bounds don't change
+        void update(u32 object, const AABB& bounds);
+        // Refits every node, for when most objects moved
+        void refit();
+
+        size_t object_count() const;
+        size_t node_count() const;
+        const AABB& object_bounds(u32 object) const;
+
+        // Appends the objects of every leaf that isn't entirely outside of the frustum, whose planes go through position
+        void query_frustum(const Frustum& frustum, const glm::vec3& position, std::vector<u32>& objects) const;
+
+        // Appends every object whose bounds overlap the sphere
+        void query_sphere(const glm::vec3& center, float radius, std::vector<u32>& objects) const;
+
+        // Closest object whose bounds the ray hits within max_distance, direction must be normalized
+        bool raycast(const glm::vec3& origin, const glm::vec3& direction, float max_distance, RayHit& hit) const;
+
+    private:
+        struct Node {
+            AABB bounds;
+            u32 first = 0; // First object for leaves, left child otherwise (the right child is first + 1)
+            u32 count = 0; // 0 for inner nodes
+        };
+
+        void subdivide(u32 node_index, std::vector<u32>& stack);
+        void refit_node(Node& node) const;
+
+        std::vector<Node> _nodes;
+        std::vector<u32> _parents;
+
+        std::vector<AABB> _bounds;
+        std::vector<u32> _objects; // Leaves reference contiguous ranges of this
+        std::vector<u32> _object_leaves;
+
+        // Only used while building
+        std::vector<glm::vec3> _centroids;
+};
+
+}
+
+#endif // BVH_H
@@ -0,0 +1,341 @@
+#include "BakedScene.h"
+
+#include <cstdio>
+#include <iostream>
+#include <type_traits>
+
+namespace OM3D {
+
+// Every offset is in bytes from the start of the file, every table and payload is aligned on baked_alignment.
+// Everything is stored in native byte order.
+
+struct BakedScene::Header {
+    u32 magic;
+    u32 version;
+
+    u32 mesh_count;
+    u32 texture_count;
+    u32 material_count;
+    u32 object_count;
+    u32 light_count;
+    u32 padding;
+
+    u64 meshes;
+    u64 textures;
+    u64 materials;
+    u64 objects;
+    u64 lights;
+};
+
+struct BakedScene::Mesh {
+    u64 vertex_offset;
+    u64 vertex_count;
+    u64 index_offset;
+    u64 index_count;
+    u64 meshlet_offset;
+    u64 meshlet_count;
+    u64 lod_offset;
+    u64 lod_count;
+};
+
+struct BakedScene::TextureInfo {
+    u64 offset;
+    u64 byte_size;
+    u32 width;
+    u32 height;
+    u32 format;
+    u32 padding;
+};
+
+// MaterialData with explicit flags, so no padding byte ends up in the file
+struct BakedScene::Material {
+    std::array<i32, 4> textures;
+    glm::vec3 base_color_factor;
+    float alpha_cutoff;
+    glm::vec3 emissive_factor;
+    glm::vec2 metal_rough_factor;
+    u8 alpha_test;
+    u8 blended;
+    u8 double_sided;
+    u8 padding;
+};
+
+static constexpr u32 baked_magic = 0x44334D4F; // "OM3D"
+static constexpr u64 baked_alignment = 16;
+
+static_assert(std::is_trivially_copyable_v<Vertex>);
+static_assert(std::is_trivially_copyable_v<shader::Meshlet>);
+static_assert(std::is_trivially_copyable_v<MeshLod>);
+static_assert(std::is_trivially_copyable_v<ObjectData>);
+static_assert(std::is_trivially_copyable_v<PointLight>);
+
+static u64 align_offset(u64 offset) {
+    return (offset + baked_alignment - 1) / baked_alignment * baked_alignment;
+}
+
+static u64 texel_byte_size(const TextureData& data) {
+    return u64(data.size.x) * u64(data.size.y) * bytes_per_pixel(data.format);
+}
+
+
+Result<void> BakedScene::write(const std::string& file_name, const SceneData& scene) {
+    static_assert(sizeof(Material) == 56, "Material should not have implicit padding");
+
+    u64 end = align_offset(sizeof(Header));
+    auto allocate = [&](u64 byte_size) {
+        const u64 offset = end;
+        end = align_offset(end + byte_size);
+        return offset;
+    };
+
+    Header header = {};
+    header.magic = baked_magic;
+    header.version = version;
+    header.mesh_count = u32(scene.meshes.size());
+    header.texture_count = u32(scene.textures.size());
+    header.material_count = u32(scene.materials.size());
+    header.object_count = u32(scene.objects.size());
+    header.light_count = u32(scene.point_lights.size());
+
+    header.meshes = allocate(sizeof(Mesh) * scene.meshes.size());
+    header.textures = allocate(sizeof(TextureInfo) * scene.textures.size());
+    header.materials = allocate(sizeof(Material) * scene.materials.size());
+    header.objects = allocate(sizeof(ObjectData) * scene.objects.size());
+    header.lights = allocate(sizeof(PointLight) * scene.point_lights.size());
+
+    std::vector<Mesh> meshes;
+    for(const MeshData& data : scene.meshes) {
+        Mesh& mesh = meshes.emplace_back();
+        mesh.vertex_count = data.vertices.size();
+        mesh.vertex_offset = allocate(sizeof(Vertex) * data.vertices.size());
+        mesh.index_count = data.indices.size();
+        mesh.index_offset = allocate(sizeof(u32) * data.indices.size());
+        mesh.meshlet_count = data.meshlets.size();
+        mesh.meshlet_offset = allocate(sizeof(shader::Meshlet) * data.meshlets.size());
+        mesh.lod_count = data.lods.size();
+        mesh.lod_offset = allocate(sizeof(MeshLod) * data.lods.size());
+    }
+
+    std::vector<TextureInfo> textures;
+    for(const TextureData& data : scene.textures) {
+        TextureInfo& texture = textures.emplace_back();
+        texture.width = data.size.x;
+        texture.height = data.size.y;
+        texture.format = u32(data.format);
+        texture.byte_size = texel_byte_size(data);
+        texture.offset = allocate(texture.byte_size);
+    }
+
+    std::vector<Material> materials;
+    for(const MaterialData& data : scene.materials) {
+        Material& material = materials.emplace_back();
+        material.textures = data.textures;
+        material.base_color_factor = data.base_color_factor;
+        material.alpha_cutoff = data.alpha_cutoff;
+        material.emissive_factor = data.emissive_factor;
+        material.metal_rough_factor = data.metal_rough_factor;
+        material.alpha_test = u8(data.alpha_test);
+        material.blended = u8(data.blended);
+        material.double_sided = u8(data.double_sided);
+    }
+
+    FILE* file = std::fopen(file_name.c_str(), "wb");
+    if(!file) {
+        std::cerr << "Unable to open \"" << file_name << "\" for writing" << std::endl;
+        return {false};
+    }
+    DEFER(std::fclose(file));
+
+    // Blocks are written in the same order they were allocated in
+    u64 written = 0;
+    bool ok = true;
+    auto write_block = [&](u64 offset, const void* data, u64 byte_size) {
+        DEBUG_ASSERT(offset == align_offset(written));
+        const char zeros[baked_alignment] = {};
+        ok = ok && std::fwrite(zeros, 1, size_t(offset - written), file) == offset - written;
+        ok = ok && (!byte_size || std::fwrite(data, 1, size_t(byte_size), file) == byte_size);
+        written = offset + byte_size;
+    };
+
+    write_block(0, &header, sizeof(header));
+    write_block(header.meshes, meshes.data(), sizeof(Mesh) * meshes.size());
+    write_block(header.textures, textures.data(), sizeof(TextureInfo) * textures.size());
+    write_block(header.materials, materials.data(), sizeof(Material) * materials.size());
+    write_block(header.objects, scene.objects.data(), sizeof(ObjectData) * scene.objects.size());
+    write_block(header.lights, scene.point_lights.data(), sizeof(PointLight) * scene.point_lights.size());
+
+    for(size_t i = 0; i != meshes.size(); ++i) {
+        write_block(meshes[i].vertex_offset, scene.meshes[i].vertices.data(), sizeof(Vertex) * meshes[i].vertex_count);
+        write_block(meshes[i].index_offset, scene.meshes[i].indices.data(), sizeof(u32) * meshes[i].index_count);
+        write_block(meshes[i].meshlet_offset, scene.meshes[i].meshlets.data(), sizeof(shader::Meshlet) * meshes[i].meshlet_count);
+        write_block(meshes[i].lod_offset, scene.meshes[i].lods.data(), sizeof(MeshLod) * meshes[i].lod_count);
+    }
+
+    for(size_t i = 0; i != textures.size(); ++i) {
+        write_block(textures[i].offset, scene.textures[i].data.get(), textures[i].byte_size);
+    }
+
+    if(!ok) {
+        std::cerr << "Error while writing \"" << file_name << "\"" << std::endl;
+    }
+
+    return {ok};
+}
+
+Result<BakedScene> BakedScene::open(const std::string& file_name) {
+    BakedScene scene;
+
+    {
+        auto file = MappedFile::open(file_name);
+        if(!file.is_ok) {
+            std::cerr << "Unable to map \"" << file_name << "\"" << std::endl;
+            return {false, {}};
+        }
+        scene._file = std::move(file.value);
+    }
+
+    const u64 file_size = scene._file.size();
+    auto in_file = [&](u64 offset, u64 count, u64 elem_size) {
+        return offset <= file_size && count <= (file_size - offset) / elem_size;
+    };
+
+    if(!in_file(0, 1, sizeof(Header)) || scene.header().magic != baked_magic) {
+        std::cerr << "\"" << file_name << "\" is not a baked scene" << std::endl;
+        return {false, {}};
+    }
+
+    const Header& header = scene.header();
+    if(header.version != version) {
+        std::cerr << "\"" << file_name << "\" was baked with version " << header.version << " (expected " << version << "), it needs to be re-cooked" << std::endl;
+        return {false, {}};
+    }
+
+    bool valid = in_file(header.meshes, header.mesh_count, sizeof(Mesh)) &&
+                 in_file(header.textures, header.texture_count, sizeof(TextureInfo)) &&
+                 in_file(header.materials, header.material_count, sizeof(Material)) &&
+                 in_file(header.objects, header.object_count, sizeof(ObjectData)) &&
+                 in_file(header.lights, header.light_count, sizeof(PointLight));
+
+    for(u32 i = 0; valid && i != header.mesh_count; ++i) {
+        const Mesh& mesh = scene.mesh(i);
+        valid = in_file(mesh.vertex_offset, mesh.vertex_count, sizeof(Vertex)) &&
+                in_file(mesh.index_offset, mesh.index_count, sizeof(u32)) &&
+                in_file(mesh.meshlet_offset, mesh.meshlet_count, sizeof(shader::Meshlet)) &&
+                in_file(mesh.lod_offset, mesh.lod_count, sizeof(MeshLod)) &&
+                mesh.lod_count <= max_lod_count;
+
+        for(const shader::Meshlet& meshlet : valid ? scene.meshlets(i) : Span<const shader::Meshlet>()) {
+            valid = valid && u64(meshlet.first_index) + u64(meshlet.triangle_count) * 3 <= mesh.index_count;
+        }
+        for(const MeshLod& lod : valid ? scene.lods(i) : Span<const MeshLod>()) {
+            valid = valid && u64(lod.first_index) + u64(lod.index_count) <= mesh.index_count;
+        }
+        for(const u32 index : valid ? scene.indices(i) : Span<const u32>()) {
+            valid = valid && index < mesh.vertex_count;
+        }
+    }
+
+    for(u32 i = 0; valid && i != header.texture_count; ++i) {
+        const TextureInfo& texture = scene.texture(i);
+        valid = in_file(texture.offset, texture.byte_size, 1) && texture.format <= u32(ImageFormat::Depth32_FLOAT);
+        valid = valid && texture.byte_size == u64(texture.width) * u64(texture.height) * bytes_per_pixel(ImageFormat(texture.format));
+    }
+
+    for(const Material& material : valid ? scene.table<Material>(header.materials, header.material_count) : Span<const Material>()) {
+        for(const i32 texture : material.textures) {
+            valid = valid && texture < i32(header.texture_count);
+        }
+        valid = valid && material.alpha_test <= 1 && material.blended <= 1 && material.double_sided <= 1 && !material.padding;
+    }
+
+    for(u32 i = 0; valid && i != header.object_count; ++i) {
+        valid = scene.objects()[i].mesh < header.mesh_count && scene.objects()[i].material < i32(header.material_count);
+    }
+
+    if(!valid) {
+        std::cerr << "\"" << file_name << "\" is truncated or corrupted" << std::endl;
+        return {false, {}};
+    }
+
+    return {true, std::move(scene)};
+}
+
+
+template<typename T>
+Span<const T> BakedScene::table(u64 offset, u64 count) const {
+    return Span<const T>(reinterpret_cast<const T*>(_file.data() + offset), size_t(count));
+}
+
+const BakedScene::Header& BakedScene::header() const {
+    return *reinterpret_cast<const Header*>(_file.data());
+}
+
+const BakedScene::Mesh& BakedScene::mesh(u32 index) const {
+    return table<Mesh>(header().meshes, header().mesh_count)[index];
+}
+
+const BakedScene::TextureInfo& BakedScene::texture(u32 index) const {
+    return table<TextureInfo>(header().textures, header().texture_count)[index];
+}
+
+u32 BakedScene::mesh_count() const {
+    return header().mesh_count;
+}
+
+Span<const Vertex> BakedScene::vertices(u32 mesh_index) const {
+    return table<Vertex>(mesh(mesh_index).vertex_offset, mesh(mesh_index).vertex_count);
+}
+
+Span<const u32> BakedScene::indices(u32 mesh_index) const {
+    return table<u32>(mesh(mesh_index).index_offset, mesh(mesh_index).index_count);
+}
+
+Span<const shader::Meshlet> BakedScene::meshlets(u32 mesh_index) const {
+    return table<shader::Meshlet>(mesh(mesh_index).meshlet_offset, mesh(mesh_index).meshlet_count);
+}
+
+Span<const MeshLod> BakedScene::lods(u32 mesh_index) const {
+    return table<MeshLod>(mesh(mesh_index).lod_offset, mesh(mesh_index).lod_count);
+}
+
+u32 BakedScene::texture_count() const {
+    return header().texture_count;
+}
+
+Span<const u8> BakedScene::texels(u32 texture_index) const {
+    return table<u8>(texture(texture_index).offset, texture(texture_index).byte_size);
+}
+
+glm::uvec2 BakedScene::texture_size(u32 texture_index) const {
+    return glm::uvec2(texture(texture_index).width, texture(texture_index).height);
+}
+
+ImageFormat BakedScene::texture_format(u32 texture_index) const {
+    return ImageFormat(texture(texture_index).format);
+}
+
+std::vector<MaterialData> BakedScene::materials() const {
+    std::vector<MaterialData> materials;
+    for(const Material& material : table<Material>(header().materials, header().material_count)) {
+        MaterialData& data = materials.emplace_back();
+        data.textures = material.textures;
+        data.base_color_factor = material.base_color_factor;
+        data.alpha_cutoff = material.alpha_cutoff;
+        data.emissive_factor = material.emissive_factor;
+        data.metal_rough_factor = material.metal_rough_factor;
+        data.alpha_test = material.alpha_test != 0;
+        data.blended = material.blended != 0;
+        data.double_sided = material.double_sided != 0;
+    }
+    return materials;
+}
+
+Span<const ObjectData> BakedScene::objects() const {
+    return table<ObjectData>(header().objects, header().object_count);
+}
+
+Span<const PointLight> BakedScene::point_lights() const {
+    return table<PointLight>(header().lights, header().light_count);
+}
+
+}
@@ -0,0 +1,57 @@
+#ifndef BAKEDSCENE_H
+#define BAKEDSCENE_H
+
+#include <SceneData.h>
+#include <MappedFile.h>
+
+namespace OM3D {
+
+// Memory mapped view of a scene baked by om3d_cook (.om3d files).
+// Vertex, index and texel payloads are stored in their final layout so they can be uploaded directly.
+class BakedScene : NonCopyable {
+    public:
+        // Bump whenever the layout of the file or of any stored struct changes
+        static constexpr u32 version = 4;
+
+        BakedScene() = default;
+        BakedScene(BakedScene&&) = default;
+        BakedScene& operator=(BakedScene&&) = default;
+
+        static Result<BakedScene> open(const std::string& file_name);
+        static Result<void> write(const std::string& file_name, const SceneData& scene);
+
+        u32 mesh_count() const;
+        Span<const Vertex> vertices(u32 mesh) const;
+        Span<const u32> indices(u32 mesh) const;
+        Span<const shader::Meshlet> meshlets(u32 mesh) const;
+        Span<const MeshLod> lods(u32 mesh) const;
+
+        u32 texture_count() const;
+        Span<const u8> texels(u32 texture) const;
+        glm::uvec2 texture_size(u32 texture) const;
+        ImageFormat texture_format(u32 texture) const;
+
+        // Materials are stored with explicit flags, and decoded on every call
+        std::vector<MaterialData> materials() const;
+        Span<const ObjectData> objects() const;
+        Span<const PointLight> point_lights() const;
+
+    private:
+        struct Header;
+        struct Mesh;
+        struct TextureInfo;
+        struct Material;
+
+        const Header& header() const;
+        const Mesh& mesh(u32 index) const;
+        const TextureInfo& texture(u32 index) const;
+
+        template<typename T>
+        Span<const T> table(u64 offset, u64 count) const;
+
+        MappedFile _file;
+};
+
+}
+
+#endif // BAKEDSCENE_H
@@ -1,4 +1,5 @@
 #include "ByteBuffer.h"
+#include "GLState.h"
 
 #include <glad/gl.h>
 
@@ -19,17 +20,18 @@ ByteBuffer::ByteBuffer(const void* data, size_t size) : _handle(create_buffer_ha
 
 ByteBuffer::~ByteBuffer() {
     if(auto handle = _handle.get()) {
+        gl_state().forget_buffer(handle);
         glDeleteBuffers(1, &handle);
     }
 }
 
 void ByteBuffer::bind(BufferUsage usage) const {
-    glBindBuffer(buffer_usage_to_gl(usage), _handle.get());
+    gl_state().bind_buffer(buffer_usage_to_gl(usage), _handle.get());
 }
 
 void ByteBuffer::bind(BufferUsage usage, u32 index) const {
     ALWAYS_ASSERT(usage == BufferUsage::Uniform || usage == BufferUsage::Storage, "Index bind is only available for uniform and storage buffers");
-    glBindBufferBase(buffer_usage_to_gl(usage), index, _handle.get());
+    gl_state().bind_buffer_range(buffer_usage_to_gl(usage), index, _handle.get());
 }
 
 size_t ByteBuffer::byte_size() const {
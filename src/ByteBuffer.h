@@ -24,6 +24,9 @@ class ByteBuffer : NonCopyable {
         BufferMapping<byte> map_bytes(AccessType access = AccessType::ReadWrite);
 
     protected:
+        friend struct FrameAllocation;
+        friend class GeometryPool;
+
         void* map_internal(AccessType access);
         const GLHandle& handle() const;
 
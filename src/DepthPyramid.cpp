@@ -0,0 +1,56 @@
+#include "DepthPyramid.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+
+namespace OM3D {
+
+DepthPyramid::DepthPyramid() : _program(Program::from_file("depth_pyramid.comp")) {
+}
+
+void DepthPyramid::build(const Texture& depth, const glm::mat4& view_proj) {
+    if(depth.size() != _depth_size) {
+        _depth_size = depth.size();
+        const glm::uvec2 size = glm::max(_depth_size / 2u, glm::uvec2(1));
+        _pyramid = Texture::empty(size, ImageFormat::R32_FLOAT);
+        _levels = Texture::mip_levels(size);
+    }
+
+    _program->bind();
+
+    // Each level reads the previous one, which has to be written before it can be fetched
+    for(u32 level = 0; level != _levels; ++level) {
+        if(level) {
+            _pyramid.bind(6);
+        } else {
+            depth.bind(6);
+        }
+        _program->set_uniform(HASH("source_level"), level ? level - 1 : 0u);
+        _pyramid.bind_as_image(0, AccessType::WriteOnly, level);
+
+        const glm::uvec2 size = glm::max(_pyramid.size() >> level, glm::uvec2(1));
+        glDispatchCompute((size.x + 7) / 8, (size.y + 7) / 8, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+
+    _view_proj = view_proj;
+}
+
+bool DepthPyramid::is_valid() const {
+    return _levels != 0;
+}
+
+const Texture& DepthPyramid::texture() const {
+    return _pyramid;
+}
+
+const glm::mat4& DepthPyramid::view_proj() const {
+    return _view_proj;
+}
+
+const glm::uvec2& DepthPyramid::depth_size() const {
+    return _depth_size;
+}
+
+}
@@ -0,0 +1,42 @@
+#ifndef DEPTHPYRAMID_H
+#define DEPTHPYRAMID_H
+
+#include <Texture.h>
+#include <Program.h>
+
+#include <glm/matrix.hpp>
+
+#include <memory>
+
+namespace OM3D {
+
+// Mip chain of the farthest depth (the minimum with reverse-Z) over the footprint of every texel, for occlusion culling.
+// Level 0 is half the resolution of the depth buffer, texel x of level l covers depth pixels [x * 2^(l+1); (x + 1) * 2^(l+1)),
+// the last texel of each row and column also covering what is left when sizes are odd
+class DepthPyramid : NonMovable {
+    public:
+        DepthPyramid();
+
+        // depth must not be bound to the current framebuffer, view_proj is the matrix it was rendered with.
+        // The pyramid is recreated when the size of depth changes, and is invalid until built again
+        void build(const Texture& depth, const glm::mat4& view_proj);
+
+        bool is_valid() const;
+
+        const Texture& texture() const;
+        const glm::mat4& view_proj() const;
+        const glm::uvec2& depth_size() const;
+
+    private:
+        std::shared_ptr<Program> _program;
+
+        Texture _pyramid;
+        u32 _levels = 0;
+
+        glm::uvec2 _depth_size = {};
+        glm::mat4 _view_proj = glm::mat4(1.0f);
+};
+
+}
+
+#endif // DEPTHPYRAMID_H
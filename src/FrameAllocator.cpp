@@ -0,0 +1,128 @@
+#include "FrameAllocator.h"
+
+#include <ByteBuffer.h>
+#include <GLState.h>
+
+#include <glad/gl.h>
+
+#include <algorithm>
+
+namespace OM3D {
+
+static GLuint create_buffer_handle() {
+    GLuint handle = 0;
+    glCreateBuffers(1, &handle);
+    return handle;
+}
+
+void FrameAllocation::bind(BufferUsage usage) const {
+    gl_state().bind_buffer(buffer_usage_to_gl(usage), buffer);
+}
+
+void FrameAllocation::bind(BufferUsage usage, u32 index) const {
+    ALWAYS_ASSERT(usage == BufferUsage::Uniform || usage == BufferUsage::Storage, "Index bind is only available for uniform and storage buffers");
+    gl_state().bind_buffer_range(buffer_usage_to_gl(usage), index, buffer, offset, byte_size);
+}
+
+void FrameAllocation::copy_to(ByteBuffer& dst, size_t dst_offset) const {
+    DEBUG_ASSERT(dst_offset + byte_size <= dst.byte_size());
+    glCopyNamedBufferSubData(buffer, dst.handle().get(), GLintptr(offset), GLintptr(dst_offset), GLsizeiptr(byte_size));
+}
+
+
+FrameAllocator::FrameAllocator(size_t frame_capacity) {
+    GLint uniform_alignment = 0;
+    GLint storage_alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_alignment);
+    _alignment = std::max({size_t(uniform_alignment), size_t(storage_alignment), size_t(16)});
+
+    create_storage(frame_capacity);
+}
+
+FrameAllocator::~FrameAllocator() {
+    for(void* fence : _fences) {
+        glDeleteSync(static_cast<GLsync>(fence));
+    }
+
+    destroy_storage(_storage);
+    for(Storage& storage : _retired) {
+        destroy_storage(storage);
+    }
+}
+
+void FrameAllocator::create_storage(size_t frame_capacity) {
+    _frame_capacity = (frame_capacity + _alignment - 1) / _alignment * _alignment;
+    const size_t byte_size = _frame_capacity * frames_in_flight;
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    _storage.buffer = GLHandle(create_buffer_handle());
+    glNamedBufferStorage(_storage.buffer.get(), byte_size, nullptr, flags);
+    _storage.mapping = static_cast<u8*>(glMapNamedBufferRange(_storage.buffer.get(), 0, byte_size, flags));
+    ALWAYS_ASSERT(_storage.mapping, "Unable to map frame buffer");
+}
+
+void FrameAllocator::destroy_storage(Storage& storage) {
+    if(auto handle = storage.buffer.get()) {
+        gl_state().forget_buffer(handle);
+        glUnmapNamedBuffer(handle);
+        glDeleteBuffers(1, &handle);
+    }
+}
+
+FrameAllocation FrameAllocator::allocate_bytes(size_t byte_size) {
+    // Empty ranges can't be bound
+    const size_t aligned_size = (std::max(byte_size, size_t(1)) + _alignment - 1) / _alignment * _alignment;
+
+    if(_frame_offset + aligned_size > _frame_capacity) {
+        // Commands recorded this frame may still reference the old buffer, so it's only released at the end of the frame.
+        // Fences of the previous frames only guarded the old buffer and can be dropped
+        _retired.emplace_back(std::move(_storage));
+        for(void*& fence : _fences) {
+            glDeleteSync(static_cast<GLsync>(fence));
+            fence = nullptr;
+        }
+
+        create_storage(std::max(_frame_capacity * 2, aligned_size));
+        _frame = 0;
+        _frame_offset = 0;
+    }
+
+    FrameAllocation alloc;
+    alloc.offset = _frame * _frame_capacity + _frame_offset;
+    alloc.data = _storage.mapping + alloc.offset;
+    alloc.buffer = _storage.buffer.get();
+    alloc.byte_size = byte_size;
+
+    _frame_offset += aligned_size;
+    return alloc;
+}
+
+void FrameAllocator::end_frame() {
+    _fences[_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // Deletion is deferred by the driver until the GPU is done with them
+    for(Storage& storage : _retired) {
+        destroy_storage(storage);
+    }
+    _retired.clear();
+
+    _frame = (_frame + 1) % frames_in_flight;
+    _frame_offset = 0;
+
+    if(void* fence = _fences[_frame]) {
+        const GLsync sync = static_cast<GLsync>(fence);
+        GLenum status = GL_TIMEOUT_EXPIRED;
+        for(GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT; status == GL_TIMEOUT_EXPIRED; flags = 0) {
+            status = glClientWaitSync(sync, flags, 1000000000);
+        }
+        glDeleteSync(sync);
+        _fences[_frame] = nullptr;
+    }
+}
+
+size_t FrameAllocator::frame_capacity() const {
+    return _frame_capacity;
+}
+
+}
@@ -0,0 +1,88 @@
+#ifndef FRAMEALLOCATOR_H
+#define FRAMEALLOCATOR_H
+
+#include <graphics.h>
+
+#include <array>
+#include <vector>
+
+namespace OM3D {
+
+class ByteBuffer;
+
+// Sub-range of the frame allocator's buffer, only valid until the end of the frame it was allocated in
+struct FrameAllocation {
+    void* data = nullptr;
+    u32 buffer = 0;
+    size_t offset = 0;
+    size_t byte_size = 0;
+
+    // Binds the whole buffer, data starts at offset
+    void bind(BufferUsage usage) const;
+    // Binds only the allocated range
+    void bind(BufferUsage usage, u32 index) const;
+
+    // For data the GPU writes to, which is better kept in a device local buffer
+    void copy_to(ByteBuffer& dst, size_t dst_offset = 0) const;
+};
+
+template<typename T>
+struct TypedFrameAllocation : FrameAllocation {
+    size_t element_count() const {
+        return byte_size / sizeof(T);
+    }
+
+    T& operator[](size_t index) const {
+        DEBUG_ASSERT(index < element_count());
+        return static_cast<T*>(data)[index];
+    }
+};
+
+// Hands out transient data (frame constants, lights, GUI geometry...) from a persistently mapped buffer split in one region per frame in flight.
+// A region is only reused once the fence of the frame that last wrote into it has been signaled,
+// so the CPU can record up to frames_in_flight - 1 frames ahead of the GPU without any per-frame buffer creation.
+class FrameAllocator : NonMovable {
+    public:
+        static constexpr u32 frames_in_flight = 3;
+
+        FrameAllocator(size_t frame_capacity);
+        ~FrameAllocator();
+
+        // Memory is write only, aligned for both uniform and storage buffer bindings
+        FrameAllocation allocate_bytes(size_t byte_size);
+
+        template<typename T>
+        TypedFrameAllocation<T> allocate(size_t count = 1) {
+            TypedFrameAllocation<T> alloc;
+            static_cast<FrameAllocation&>(alloc) = allocate_bytes(count * sizeof(T));
+            return alloc;
+        }
+
+        // Fences everything allocated since the last call, then waits for the GPU to be done with the next region
+        void end_frame();
+
+        size_t frame_capacity() const;
+
+    private:
+        struct Storage {
+            GLHandle buffer;
+            u8* mapping = nullptr;
+        };
+
+        void create_storage(size_t frame_capacity);
+        static void destroy_storage(Storage& storage);
+
+        Storage _storage;
+        std::vector<Storage> _retired;
+
+        std::array<void*, frames_in_flight> _fences = {};
+        size_t _frame_capacity = 0;
+        size_t _alignment = 0;
+
+        u32 _frame = 0;
+        size_t _frame_offset = 0;
+};
+
+}
+
+#endif // FRAMEALLOCATOR_H
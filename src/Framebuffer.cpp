@@ -1,4 +1,5 @@
 #include "Framebuffer.h"
+#include "GLState.h"
 
 #include <glm/vec4.hpp>
 
@@ -6,28 +7,6 @@
 
 namespace OM3D {
 
-struct WriteMask {
-    GLboolean color[4] = {};
-    GLboolean depth = {};
-
-    static WriteMask get() {
-        WriteMask mask = {};
-        glGetBooleanv(GL_DEPTH_WRITEMASK, &mask.depth);
-        glGetBooleanv(GL_COLOR_WRITEMASK, mask.color);
-        return mask;
-    }
-
-    static void set(WriteMask mask) {
-        glColorMask(mask.color[0], mask.color[1], mask.color[2], mask.color[3]);
-        glDepthMask(mask.depth);
-    }
-
-    static void set_all() {
-        glColorMask(true, true, true, true);
-        glDepthMask(true);
-    }
-};
-
 static GLuint create_framebuffer_handle() {
     GLuint handle = 0;
     glCreateFramebuffers(1, &handle);
@@ -73,14 +52,16 @@ Framebuffer::Framebuffer(Texture* depth, Texture** colors, size_t count) : _hand
 
 Framebuffer::~Framebuffer() {
     if(u32 handle = _handle.get()) {
+        gl_state().forget_framebuffer(handle);
         glDeleteFramebuffers(1, &handle);
     }
 }
 
 
 void Framebuffer::bind(bool clear_depth, bool clear_color) const {
-    glBindFramebuffer(GL_FRAMEBUFFER, _handle.get());
-    glViewport(0, 0, _size.x, _size.y);
+    GLState& state = gl_state();
+    state.bind_framebuffer(_handle.get());
+    state.set_viewport(_size);
 
     GLenum clear_mask = 0;
     if(clear_color) {
@@ -91,9 +72,15 @@ void Framebuffer::bind(bool clear_depth, bool clear_color) const {
     }
 
     if(clear_mask) {
-        const WriteMask mask = WriteMask::get();
-        DEFER(WriteMask::set(mask));
-        WriteMask::set_all();
+        // Clears are affected by the write masks
+        const bool color_write = state.color_write();
+        const bool depth_write = state.depth_write();
+        DEFER({
+            state.set_color_write(color_write);
+            state.set_depth_write(depth_write);
+        });
+        state.set_color_write(true);
+        state.set_depth_write(true);
 
         glClear(clear_mask);
     }
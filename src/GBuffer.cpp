@@ -0,0 +1,32 @@
+#include "GBuffer.h"
+
+namespace OM3D {
+
+GBuffer::GBuffer() {
+}
+
+GBuffer::GBuffer(Texture* depth, Texture* lit_hdr) :
+        _albedo_metal(depth->size(), ImageFormat::RGBA8_sRGB, WrapMode::Clamp),
+        _normal_rough(depth->size(), ImageFormat::RGB10_A2_UNORM, WrapMode::Clamp),
+        _geometry_framebuffer(depth, std::array{lit_hdr, &_albedo_metal, &_normal_rough}),
+        _lighting_framebuffer(nullptr, std::array{lit_hdr}),
+        _forward_framebuffer(depth, std::array{lit_hdr}) {
+}
+
+void GBuffer::bind_geometry() const {
+    _geometry_framebuffer.bind(false, false);
+}
+
+void GBuffer::bind_lighting(const Texture& depth) const {
+    // Depth is sampled, it can't be attached
+    _lighting_framebuffer.bind(false, false);
+    _albedo_metal.bind(0);
+    _normal_rough.bind(1);
+    depth.bind(2);
+}
+
+void GBuffer::bind_forward() const {
+    _forward_framebuffer.bind(false, false);
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <Framebuffer.h>
+
+namespace OM3D {
+
+// Compact G-buffer for deferred shading: base color and metalness (RGBA8 sRGB), octahedral normal and roughness (RGB10A2).
+// Emissive is written straight into the lit HDR target, which the lighting pass then adds to
+class GBuffer : NonCopyable {
+    public:
+        GBuffer();
+        // Textures are only attached, they must outlive the G-buffer but can be moved
+        GBuffer(Texture* depth, Texture* lit_hdr);
+
+        GBuffer(GBuffer&&) = default;
+        GBuffer& operator=(GBuffer&&) = default;
+
+        // Lit HDR (emissive), G-buffer and depth targets, for the geometry pass
+        void bind_geometry() const;
+        // Lit HDR target only, with the G-buffer at texture units 0 and 1 and depth at 2, for the lighting pass
+        void bind_lighting(const Texture& depth) const;
+        // Lit HDR and depth targets, for objects drawn after the lighting pass
+        void bind_forward() const;
+
+    private:
+        Texture _albedo_metal;
+        Texture _normal_rough;
+
+        Framebuffer _geometry_framebuffer;
+        Framebuffer _lighting_framebuffer;
+        Framebuffer _forward_framebuffer;
+};
+
+}
+
+#endif // GBUFFER_H
@@ -0,0 +1,368 @@
+#include "GLState.h"
+
+#include <glad/gl.h>
+
+#include <type_traits>
+
+namespace OM3D {
+
+static_assert(std::is_trivially_destructible_v<GLState>, "GLState must stay usable during static destruction");
+
+bool GLState::BufferRange::operator==(const BufferRange& other) const {
+    return buffer == other.buffer && offset == other.offset && size == other.size;
+}
+
+bool GLState::BufferRange::operator!=(const BufferRange& other) const {
+    return !operator==(other);
+}
+
+bool GLState::AttribPointer::operator==(const AttribPointer& other) const {
+    return buffer == other.buffer && components == other.components && type == other.type &&
+           normalized == other.normalized && stride == other.stride && offset == other.offset;
+}
+
+bool GLState::AttribPointer::operator!=(const AttribPointer& other) const {
+    return !operator==(other);
+}
+
+// Defaults of a freshly created context
+GLState::GLState() :
+    _viewport(u32(-1)),
+    _blend_func({GL_ONE, GL_ZERO}),
+    _depth_func(GL_LESS) {
+
+    for(glm::vec4& value : _attrib_values) {
+        value = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+}
+
+template<typename T>
+bool GLState::update(T& shadow, const T& value) {
+    if(shadow == value) {
+        ++_stats.skipped;
+        return false;
+    }
+    shadow = value;
+    ++_stats.calls;
+    return true;
+}
+
+u32* GLState::buffer_binding(u32 target) {
+    switch(target) {
+        case GL_ARRAY_BUFFER:
+            return &_array_buffer;
+
+        case GL_ELEMENT_ARRAY_BUFFER:
+            return &_index_buffer;
+
+        case GL_DRAW_INDIRECT_BUFFER:
+            return &_indirect_buffer;
+
+        case GL_PIXEL_UNPACK_BUFFER:
+            return &_unpack_buffer;
+
+        default:
+            return nullptr;
+    }
+}
+
+GLState::BufferRange* GLState::indexed_binding(u32 target, u32 index) {
+    if(index >= max_buffer_bindings) {
+        return nullptr;
+    }
+
+    switch(target) {
+        case GL_UNIFORM_BUFFER:
+            return &_uniform_buffers[index];
+
+        case GL_SHADER_STORAGE_BUFFER:
+            return &_storage_buffers[index];
+
+        default:
+            return nullptr;
+    }
+}
+
+
+void GLState::use_program(u32 program) {
+    if(update(_program, program)) {
+        glUseProgram(program);
+    }
+}
+
+void GLState::bind_texture(u32 unit, u32 texture) {
+    if(unit >= max_texture_units || update(_textures[unit], texture)) {
+        glBindTextureUnit(unit, texture);
+    }
+}
+
+void GLState::bind_buffer(u32 target, u32 buffer) {
+    u32* binding = buffer_binding(target);
+    if(!binding || update(*binding, buffer)) {
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLState::bind_buffer_range(u32 target, u32 index, u32 buffer, size_t offset, size_t size) {
+    BufferRange* binding = indexed_binding(target, index);
+    if(!binding || update(*binding, BufferRange{buffer, offset, size})) {
+        if(size) {
+            glBindBufferRange(target, index, buffer, GLintptr(offset), GLsizeiptr(size));
+        } else {
+            DEBUG_ASSERT(!offset);
+            glBindBufferBase(target, index, buffer);
+        }
+    }
+}
+
+void GLState::bind_framebuffer(u32 framebuffer) {
+    if(update(_framebuffer, framebuffer)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    }
+}
+
+void GLState::set_viewport(const glm::uvec2& size) {
+    if(update(_viewport, size)) {
+        glViewport(0, 0, GLsizei(size.x), GLsizei(size.y));
+    }
+}
+
+const glm::uvec2& GLState::viewport() const {
+    return _viewport;
+}
+
+static void set_capability(GLenum cap, bool enabled) {
+    if(enabled) {
+        glEnable(cap);
+    } else {
+        glDisable(cap);
+    }
+}
+
+void GLState::set_blending(bool enabled) {
+    if(update(_blending, enabled)) {
+        set_capability(GL_BLEND, enabled);
+    }
+}
+
+void GLState::set_blend_func(u32 src, u32 dst) {
+    if(update(_blend_func, std::array<u32, 2>{src, dst})) {
+        glBlendFunc(src, dst);
+    }
+}
+
+void GLState::set_depth_test(bool enabled) {
+    if(update(_depth_test, enabled)) {
+        set_capability(GL_DEPTH_TEST, enabled);
+    }
+}
+
+void GLState::set_depth_func(u32 func) {
+    if(update(_depth_func, func)) {
+        glDepthFunc(func);
+    }
+}
+
+void GLState::set_face_culling(bool enabled) {
+    if(update(_face_culling, enabled)) {
+        set_capability(GL_CULL_FACE, enabled);
+    }
+}
+
+void GLState::set_scissor_test(bool enabled) {
+    if(update(_scissor_test, enabled)) {
+        set_capability(GL_SCISSOR_TEST, enabled);
+    }
+}
+
+void GLState::set_color_write(bool enabled) {
+    if(update(_color_write, enabled)) {
+        glColorMask(enabled, enabled, enabled, enabled);
+    }
+}
+
+void GLState::set_depth_write(bool enabled) {
+    if(update(_depth_write, enabled)) {
+        glDepthMask(enabled);
+    }
+}
+
+bool GLState::color_write() const {
+    return _color_write;
+}
+
+bool GLState::depth_write() const {
+    return _depth_write;
+}
+
+void GLState::enable_vertex_attrib(u32 index, bool enabled) {
+    if(index >= max_vertex_attribs || update(_attribs_enabled[index], enabled)) {
+        if(enabled) {
+            glEnableVertexAttribArray(index);
+        } else {
+            glDisableVertexAttribArray(index);
+        }
+    }
+}
+
+void GLState::vertex_attrib_pointer(u32 index, u32 buffer, u32 components, u32 type, bool normalized, u32 stride, size_t offset) {
+    const AttribPointer pointer = {buffer, components, type, normalized, stride, offset};
+    if(index >= max_vertex_attribs || update(_attrib_pointers[index], pointer)) {
+        bind_buffer(GL_ARRAY_BUFFER, buffer);
+        glVertexAttribPointer(index, GLint(components), type, normalized, GLsizei(stride), reinterpret_cast<const void*>(offset));
+    }
+}
+
+void GLState::vertex_attrib_value(u32 index, const glm::vec4& value) {
+    if(index >= max_vertex_attribs || update(_attrib_values[index], value)) {
+        glVertexAttrib4f(index, value.x, value.y, value.z, value.w);
+    }
+}
+
+
+void GLState::forget_program(u32 program) {
+    // Programs in use are only deleted once unbound, clear it to never compare against a recycled name
+    if(_program == program) {
+        _program = u32(-1);
+    }
+}
+
+void GLState::forget_texture(u32 texture) {
+    for(u32& binding : _textures) {
+        if(binding == texture) {
+            binding = 0;
+        }
+    }
+}
+
+void GLState::forget_buffer(u32 buffer) {
+    for(u32* binding : {&_array_buffer, &_index_buffer, &_indirect_buffer, &_unpack_buffer}) {
+        if(*binding == buffer) {
+            *binding = 0;
+        }
+    }
+
+    for(auto* bindings : {&_uniform_buffers, &_storage_buffers}) {
+        for(BufferRange& binding : *bindings) {
+            if(binding.buffer == buffer) {
+                binding = {};
+            }
+        }
+    }
+
+    for(AttribPointer& pointer : _attrib_pointers) {
+        if(pointer.buffer == buffer) {
+            pointer = {};
+        }
+    }
+}
+
+void GLState::forget_framebuffer(u32 framebuffer) {
+    if(_framebuffer == framebuffer) {
+        _framebuffer = 0;
+    }
+}
+
+
+void GLState::validate() const {
+    auto get = [](GLenum e) {
+        GLint v = 0;
+        glGetIntegerv(e, &v);
+        return u32(v);
+    };
+
+    auto get_at = [](GLenum e, u32 index) {
+        GLint64 v = 0;
+        glGetInteger64i_v(e, index, &v);
+        return u64(v);
+    };
+
+    ALWAYS_ASSERT(_program == u32(-1) || get(GL_CURRENT_PROGRAM) == _program, "Shadowed program doesn't match");
+
+    for(u32 unit = 0; unit != max_texture_units; ++unit) {
+        if(!_textures[unit]) {
+            continue;
+        }
+
+        GLint target = 0;
+        glGetTextureParameteriv(_textures[unit], GL_TEXTURE_TARGET, &target);
+        const GLenum binding = target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_BINDING_CUBE_MAP : target == GL_TEXTURE_2D_ARRAY ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D;
+        ALWAYS_ASSERT(get_at(binding, unit) == _textures[unit], "Shadowed texture binding doesn't match");
+    }
+
+    ALWAYS_ASSERT(get(GL_ARRAY_BUFFER_BINDING) == _array_buffer, "Shadowed array buffer doesn't match");
+    ALWAYS_ASSERT(get(GL_ELEMENT_ARRAY_BUFFER_BINDING) == _index_buffer, "Shadowed index buffer doesn't match");
+    ALWAYS_ASSERT(get(GL_DRAW_INDIRECT_BUFFER_BINDING) == _indirect_buffer, "Shadowed indirect buffer doesn't match");
+    ALWAYS_ASSERT(get(GL_PIXEL_UNPACK_BUFFER_BINDING) == _unpack_buffer, "Shadowed pixel unpack buffer doesn't match");
+
+    for(u32 i = 0; i != max_buffer_bindings; ++i) {
+        const BufferRange uniform = {u32(get_at(GL_UNIFORM_BUFFER_BINDING, i)), get_at(GL_UNIFORM_BUFFER_START, i), get_at(GL_UNIFORM_BUFFER_SIZE, i)};
+        ALWAYS_ASSERT(uniform == _uniform_buffers[i], "Shadowed uniform buffer binding doesn't match");
+
+        const BufferRange storage = {u32(get_at(GL_SHADER_STORAGE_BUFFER_BINDING, i)), get_at(GL_SHADER_STORAGE_BUFFER_START, i), get_at(GL_SHADER_STORAGE_BUFFER_SIZE, i)};
+        ALWAYS_ASSERT(storage == _storage_buffers[i], "Shadowed storage buffer binding doesn't match");
+    }
+
+    ALWAYS_ASSERT(get(GL_DRAW_FRAMEBUFFER_BINDING) == _framebuffer, "Shadowed framebuffer doesn't match");
+    if(_viewport != glm::uvec2(u32(-1))) {
+        GLint viewport[4] = {};
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        ALWAYS_ASSERT(!viewport[0] && !viewport[1] && u32(viewport[2]) == _viewport.x && u32(viewport[3]) == _viewport.y, "Shadowed viewport doesn't match");
+    }
+
+    ALWAYS_ASSERT(bool(glIsEnabled(GL_BLEND)) == _blending, "Shadowed blending doesn't match");
+    ALWAYS_ASSERT(get(GL_BLEND_SRC_RGB) == _blend_func[0] && get(GL_BLEND_DST_RGB) == _blend_func[1], "Shadowed blend function doesn't match");
+    ALWAYS_ASSERT(bool(glIsEnabled(GL_DEPTH_TEST)) == _depth_test, "Shadowed depth test doesn't match");
+    ALWAYS_ASSERT(get(GL_DEPTH_FUNC) == _depth_func, "Shadowed depth function doesn't match");
+    ALWAYS_ASSERT(bool(glIsEnabled(GL_CULL_FACE)) == _face_culling, "Shadowed face culling doesn't match");
+    ALWAYS_ASSERT(bool(glIsEnabled(GL_SCISSOR_TEST)) == _scissor_test, "Shadowed scissor test doesn't match");
+
+    {
+        GLboolean color[4] = {};
+        GLboolean depth = false;
+        glGetBooleanv(GL_COLOR_WRITEMASK, color);
+        glGetBooleanv(GL_DEPTH_WRITEMASK, &depth);
+        for(const GLboolean c : color) {
+            ALWAYS_ASSERT(bool(c) == _color_write, "Shadowed color write mask doesn't match");
+        }
+        ALWAYS_ASSERT(bool(depth) == _depth_write, "Shadowed depth write mask doesn't match");
+    }
+
+    for(u32 i = 0; i != max_vertex_attribs; ++i) {
+        GLint enabled = 0;
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+        ALWAYS_ASSERT(bool(enabled) == _attribs_enabled[i], "Shadowed vertex attribute state doesn't match");
+
+        const AttribPointer& pointer = _attrib_pointers[i];
+        if(!pointer.components) {
+            continue;
+        }
+
+        GLint buffer = 0;
+        GLint components = 0;
+        GLint type = 0;
+        GLint normalized = 0;
+        GLint stride = 0;
+        void* offset = nullptr;
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &components);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &normalized);
+        glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &stride);
+        glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &offset);
+
+        const AttribPointer actual = {u32(buffer), u32(components), u32(type), u32(normalized), u32(stride), u64(reinterpret_cast<uintptr_t>(offset))};
+        ALWAYS_ASSERT(actual == pointer, "Shadowed vertex attribute pointer doesn't match");
+    }
+}
+
+const GLState::Stats& GLState::frame_stats() const {
+    return _frame_stats;
+}
+
+void GLState::end_frame() {
+    _frame_stats = _stats;
+    _stats = {};
+}
+
+}
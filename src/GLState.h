@@ -0,0 +1,133 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <graphics.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+
+namespace OM3D {
+
+// Shadow of the GL state the renderer touches. Every bind and render state change goes through it,
+// so redundant calls are dropped and nothing on the hot path needs to query the driver.
+// It only holds plain values: it stays valid while other globals release their GL objects at exit.
+class GLState : NonMovable {
+    public:
+        static constexpr u32 max_texture_units = 32;
+        static constexpr u32 max_buffer_bindings = 16;
+        static constexpr u32 max_vertex_attribs = 8;
+
+        struct Stats {
+            u32 calls = 0;
+            u32 skipped = 0;
+        };
+
+        GLState();
+
+        void use_program(u32 program);
+        void bind_texture(u32 unit, u32 texture);
+
+        // Non indexed targets: GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_DRAW_INDIRECT_BUFFER and GL_PIXEL_UNPACK_BUFFER
+        void bind_buffer(u32 target, u32 buffer);
+        // Indexed GL_UNIFORM_BUFFER and GL_SHADER_STORAGE_BUFFER bindings, a size of 0 binds the whole buffer
+        void bind_buffer_range(u32 target, u32 index, u32 buffer, size_t offset = 0, size_t size = 0);
+
+        void bind_framebuffer(u32 framebuffer);
+        void set_viewport(const glm::uvec2& size);
+        const glm::uvec2& viewport() const;
+
+        void set_blending(bool enabled);
+        void set_blend_func(u32 src, u32 dst);
+        void set_depth_test(bool enabled);
+        void set_depth_func(u32 func);
+        void set_face_culling(bool enabled);
+        void set_scissor_test(bool enabled);
+        void set_color_write(bool enabled);
+        void set_depth_write(bool enabled);
+
+        bool color_write() const;
+        bool depth_write() const;
+
+        void enable_vertex_attrib(u32 index, bool enabled);
+        // Binds buffer to GL_ARRAY_BUFFER when the attribute has to be respecified
+        void vertex_attrib_pointer(u32 index, u32 buffer, u32 components, u32 type, bool normalized, u32 stride, size_t offset);
+        // Value of disabled attributes
+        void vertex_attrib_value(u32 index, const glm::vec4& value);
+
+        // GL unbinds objects when they are deleted
+        void forget_program(u32 program);
+        void forget_texture(u32 texture);
+        void forget_buffer(u32 buffer);
+        void forget_framebuffer(u32 framebuffer);
+
+        // Checks the shadow against the actual driver state. Very slow
+        void validate() const;
+
+        // Counters of the last complete frame
+        const Stats& frame_stats() const;
+        void end_frame();
+
+    private:
+        struct BufferRange {
+            u32 buffer = 0;
+            u64 offset = 0;
+            u64 size = 0;
+
+            bool operator==(const BufferRange& other) const;
+            bool operator!=(const BufferRange& other) const;
+        };
+
+        // A component count of 0 means the attribute is in an unknown state
+        struct AttribPointer {
+            u32 buffer = 0;
+            u32 components = 0;
+            u32 type = 0;
+            u32 normalized = 0;
+            u32 stride = 0;
+            u64 offset = 0;
+
+            bool operator==(const AttribPointer& other) const;
+            bool operator!=(const AttribPointer& other) const;
+        };
+
+        template<typename T>
+        bool update(T& shadow, const T& value);
+
+        BufferRange* indexed_binding(u32 target, u32 index);
+        u32* buffer_binding(u32 target);
+
+        u32 _program = 0;
+        std::array<u32, max_texture_units> _textures = {};
+
+        u32 _array_buffer = 0;
+        u32 _index_buffer = 0;
+        u32 _indirect_buffer = 0;
+        u32 _unpack_buffer = 0;
+        std::array<BufferRange, max_buffer_bindings> _uniform_buffers = {};
+        std::array<BufferRange, max_buffer_bindings> _storage_buffers = {};
+
+        u32 _framebuffer = 0;
+        glm::uvec2 _viewport = {};
+
+        bool _blending = false;
+        std::array<u32, 2> _blend_func = {};
+        bool _depth_test = false;
+        u32 _depth_func = 0;
+        bool _face_culling = false;
+        bool _scissor_test = false;
+        bool _color_write = true;
+        bool _depth_write = true;
+
+        std::array<bool, max_vertex_attribs> _attribs_enabled = {};
+        std::array<AttribPointer, max_vertex_attribs> _attrib_pointers = {};
+        std::array<glm::vec4, max_vertex_attribs> _attrib_values = {};
+
+        Stats _stats;
+        Stats _frame_stats;
+};
+
+}
+
+#endif // GLSTATE_H
@@ -0,0 +1,240 @@
+#include "GeometryPool.h"
+
+#include <GLState.h>
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace OM3D {
+
+GeometryAllocation::GeometryAllocation(PoolRange vertices, PoolRange colors, PoolRange indices, bool short_indices) :
+    _vertices(vertices),
+    _colors(colors),
+    _indices(indices),
+    _short_indices(short_indices) {
+}
+
+GeometryAllocation::GeometryAllocation(GeometryAllocation&& other) {
+    swap(other);
+}
+
+GeometryAllocation& GeometryAllocation::operator=(GeometryAllocation&& other) {
+    swap(other);
+    return *this;
+}
+
+GeometryAllocation::~GeometryAllocation() {
+    if(_vertices.count || _indices.count) {
+        geometry_pool().release(*this);
+    }
+}
+
+void GeometryAllocation::swap(GeometryAllocation& other) {
+    std::swap(_vertices, other._vertices);
+    std::swap(_colors, other._colors);
+    std::swap(_indices, other._indices);
+    std::swap(_short_indices, other._short_indices);
+}
+
+const PoolRange& GeometryAllocation::vertices() const {
+    return _vertices;
+}
+
+const PoolRange& GeometryAllocation::colors() const {
+    return _colors;
+}
+
+const PoolRange& GeometryAllocation::indices() const {
+    return _indices;
+}
+
+bool GeometryAllocation::has_short_indices() const {
+    return _short_indices;
+}
+
+
+PoolRange GeometryPool::RangeAllocator::allocate(u32 count) {
+    for(auto it = _free_ranges.begin(); it != _free_ranges.end(); ++it) {
+        const auto [first, free_count] = *it;
+        if(free_count < count) {
+            continue;
+        }
+
+        _free_ranges.erase(it);
+        if(free_count > count) {
+            _free_ranges[first + count] = free_count - count;
+        }
+        return {first, count};
+    }
+
+    const PoolRange range = {_end, count};
+    _end += count;
+    return range;
+}
+
+void GeometryPool::RangeAllocator::release(PoolRange range) {
+    if(!range.count) {
+        return;
+    }
+
+    auto next = _free_ranges.lower_bound(range.first);
+
+    // Merge with the following range
+    if(next != _free_ranges.end() && range.first + range.count == next->first) {
+        range.count += next->second;
+        next = _free_ranges.erase(next);
+    }
+
+    // Merge with the preceding range
+    if(next != _free_ranges.begin()) {
+        const auto prev = std::prev(next);
+        if(prev->first + prev->second == range.first) {
+            range.first = prev->first;
+            range.count += prev->second;
+            _free_ranges.erase(prev);
+        }
+    }
+
+    if(range.first + range.count == _end) {
+        _end = range.first;
+    } else {
+        _free_ranges[range.first] = range.count;
+    }
+}
+
+u32 GeometryPool::RangeAllocator::end() const {
+    return _end;
+}
+
+
+GeometryPool::GeometryPool(bool compact_vertices) : _compact(compact_vertices) {
+}
+
+bool GeometryPool::has_compact_vertices() const {
+    return _compact;
+}
+
+size_t GeometryPool::vertex_byte_size() const {
+    return _compact ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+// Buffers grow geometrically and keep their content, meshes are only created while loading
+void GeometryPool::reserve(ByteBuffer& buffer, size_t byte_size) {
+    if(buffer.byte_size() >= byte_size) {
+        return;
+    }
+
+    ByteBuffer grown(nullptr, std::max({byte_size, buffer.byte_size() * 2, size_t(1024 * 1024)}));
+    if(buffer.byte_size()) {
+        glCopyNamedBufferSubData(buffer.handle().get(), grown.handle().get(), 0, 0, GLsizeiptr(buffer.byte_size()));
+    }
+    buffer = std::move(grown);
+}
+
+GeometryAllocation GeometryPool::allocate(const void* vertices, const u32* colors, u32 vertex_count, Span<const u32> indices) {
+    const size_t vertex_size = vertex_byte_size();
+    const PoolRange vertex_range = _vertices.allocate(vertex_count);
+    reserve(_vertex_buffer, _vertices.end() * vertex_size);
+    glNamedBufferSubData(_vertex_buffer.handle().get(), GLintptr(vertex_range.first * vertex_size), GLsizeiptr(vertex_count * vertex_size), vertices);
+
+    PoolRange color_range;
+    if(_compact && colors) {
+        color_range = _colors.allocate(vertex_count);
+        reserve(_color_buffer, _colors.end() * sizeof(u32));
+        glNamedBufferSubData(_color_buffer.handle().get(), GLintptr(color_range.first * sizeof(u32)), GLsizeiptr(vertex_count * sizeof(u32)), colors);
+    }
+
+    const u32 index_count = u32(indices.size());
+    if(vertex_count <= std::numeric_limits<u16>::max() + u32(1)) {
+        // Ranges are kept 4 bytes aligned so the culling shader can read them as uints
+        const PoolRange range = _short_indices.allocate((index_count + 1) / 2 * 2);
+        reserve(_short_index_buffer, _short_indices.end() * sizeof(u16));
+
+        std::vector<u16> short_indices(indices.begin(), indices.end());
+        short_indices.resize(range.count, u16(0));
+        glNamedBufferSubData(_short_index_buffer.handle().get(), GLintptr(range.first * sizeof(u16)), GLsizeiptr(range.count * sizeof(u16)), short_indices.data());
+
+        return GeometryAllocation(vertex_range, color_range, range, true);
+    }
+
+    const PoolRange range = _indices.allocate(index_count);
+    reserve(_index_buffer, _indices.end() * sizeof(u32));
+    glNamedBufferSubData(_index_buffer.handle().get(), GLintptr(range.first * sizeof(u32)), GLsizeiptr(range.count * sizeof(u32)), indices.data());
+
+    return GeometryAllocation(vertex_range, color_range, range, false);
+}
+
+void GeometryPool::release(const GeometryAllocation& allocation) {
+    _vertices.release(allocation.vertices());
+    _colors.release(allocation.colors());
+    if(allocation.has_short_indices()) {
+        _short_indices.release(allocation.indices());
+    } else {
+        _indices.release(allocation.indices());
+    }
+}
+
+void GeometryPool::bind_vertex_attribs() const {
+    GLState& state = gl_state();
+    const u32 vertices = _vertex_buffer.handle().get();
+
+    if(_compact) {
+        // Vertex position + bitangent sign
+        state.vertex_attrib_pointer(0, vertices, 4, GL_UNSIGNED_SHORT, true, sizeof(CompactVertex), 0);
+        // Octahedral normal
+        state.vertex_attrib_pointer(1, vertices, 2, GL_SHORT, true, sizeof(CompactVertex), 4 * sizeof(u16));
+        // Vertex uv
+        state.vertex_attrib_pointer(2, vertices, 2, GL_HALF_FLOAT, false, sizeof(CompactVertex), 8 * sizeof(u16));
+        // Octahedral tangent
+        state.vertex_attrib_pointer(3, vertices, 2, GL_SHORT, true, sizeof(CompactVertex), 6 * sizeof(u16));
+        // Vertex colors are only stored for the meshes that have some, and fetched by the vertex shader
+        state.vertex_attrib_value(4, glm::vec4(1.0f));
+        (_color_buffer.byte_size() ? _color_buffer : _vertex_buffer).bind(BufferUsage::Storage, 10);
+    } else {
+        // Vertex position
+        state.vertex_attrib_pointer(0, vertices, 3, GL_FLOAT, false, sizeof(Vertex), 0);
+        // Vertex normal
+        state.vertex_attrib_pointer(1, vertices, 3, GL_FLOAT, false, sizeof(Vertex), 3 * sizeof(float));
+        // Vertex uv
+        state.vertex_attrib_pointer(2, vertices, 2, GL_FLOAT, false, sizeof(Vertex), 6 * sizeof(float));
+        // Tangent / bitangent sign
+        state.vertex_attrib_pointer(3, vertices, 4, GL_FLOAT, false, sizeof(Vertex), 8 * sizeof(float));
+        // Vertex color
+        state.vertex_attrib_pointer(4, vertices, 3, GL_FLOAT, false, sizeof(Vertex), 12 * sizeof(float));
+    }
+
+    for(u32 i = 0; i != 5; ++i) {
+        state.enable_vertex_attrib(i, i != 4 || !_compact);
+    }
+}
+
+void GeometryPool::bind_index_buffer(bool short_indices) const {
+    (short_indices ? _short_index_buffer : _index_buffer).bind(BufferUsage::Index);
+}
+
+void GeometryPool::bind_index_storage(bool short_indices, u32 index) const {
+    (short_indices ? _short_index_buffer : _index_buffer).bind(BufferUsage::Storage, index);
+}
+
+void GeometryPool::bind_geometry_storage(u32 first_index) const {
+    const ByteBuffer* buffers[] = {
+        &_vertex_buffer,
+        _compact ? &_color_buffer : nullptr,
+        &_short_index_buffer,
+        &_index_buffer,
+    };
+
+    for(u32 i = 0; i != 4; ++i) {
+        const ByteBuffer* buffer = buffers[i] && buffers[i]->byte_size() ? buffers[i] : &_vertex_buffer;
+        buffer->bind(BufferUsage::Storage, first_index + i);
+    }
+}
+
+size_t GeometryPool::gpu_byte_size() const {
+    return _vertex_buffer.byte_size() + _color_buffer.byte_size() + _short_index_buffer.byte_size() + _index_buffer.byte_size();
+}
+
+}
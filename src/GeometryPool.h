@@ -0,0 +1,103 @@
+#ifndef GEOMETRYPOOL_H
+#define GEOMETRYPOOL_H
+
+#include <ByteBuffer.h>
+#include <Vertex.h>
+
+#include <map>
+
+namespace OM3D {
+
+// Range of elements in one of the pool's buffers
+struct PoolRange {
+    u32 first = 0;
+    u32 count = 0;
+};
+
+// Vertex, color and index ranges of a mesh, released when destroyed
+class GeometryAllocation : NonCopyable {
+    public:
+        GeometryAllocation() = default;
+        GeometryAllocation(PoolRange vertices, PoolRange colors, PoolRange indices, bool short_indices);
+
+        GeometryAllocation(GeometryAllocation&& other);
+        GeometryAllocation& operator=(GeometryAllocation&& other);
+
+        ~GeometryAllocation();
+
+        // Indices are relative to the first vertex
+        const PoolRange& vertices() const;
+        // Empty for meshes without vertex colors
+        const PoolRange& colors() const;
+        const PoolRange& indices() const;
+        bool has_short_indices() const;
+
+    private:
+        void swap(GeometryAllocation& other);
+
+        PoolRange _vertices;
+        PoolRange _colors;
+        PoolRange _indices;
+        bool _short_indices = false;
+};
+
+// Vertex and index data of every StaticMesh, suballocated from a few shared buffers.
+// Geometry is bound once per pass, and draws only differ by their base vertex and first index
+// so they can be submitted together with glMultiDrawElementsIndirect.
+// Meshes with up to 65536 vertices keep 16 bit indices, in a separate index buffer.
+class GeometryPool : NonMovable {
+    public:
+        // Vertices are stored as CompactVertex, with colors in a separate stream, or as Vertex
+        GeometryPool(bool compact_vertices);
+
+        bool has_compact_vertices() const;
+
+        // vertices are CompactVertex or Vertex depending on the pool format.
+        // colors are only used by compact pools, and only stored for meshes that have some (colors != nullptr)
+        GeometryAllocation allocate(const void* vertices, const u32* colors, u32 vertex_count, Span<const u32> indices);
+        void release(const GeometryAllocation& allocation);
+
+        // Compact pools read vertex colors from storage binding 10, at gl_VertexID + DrawData::color_offset,
+        // the color attribute is a constant white for meshes without any
+        void bind_vertex_attribs() const;
+        void bind_index_buffer(bool short_indices) const;
+        void bind_index_storage(bool short_indices, u32 index) const;
+        // Vertices, colors, 16 and 32 bit indices at storage bindings first_index to first_index + 3, for shaders fetching geometry themselves.
+        // Unused or empty buffers are replaced by the vertex buffer so every binding stays valid
+        void bind_geometry_storage(u32 first_index) const;
+
+        size_t vertex_byte_size() const;
+        size_t gpu_byte_size() const;
+
+    private:
+        // First fit over the released ranges, new ranges are appended past the end
+        class RangeAllocator {
+            public:
+                PoolRange allocate(u32 count);
+                void release(PoolRange range);
+
+                u32 end() const;
+
+            private:
+                std::map<u32, u32> _free_ranges;
+                u32 _end = 0;
+        };
+
+        static void reserve(ByteBuffer& buffer, size_t byte_size);
+
+        const bool _compact;
+
+        ByteBuffer _vertex_buffer;
+        ByteBuffer _color_buffer;
+        ByteBuffer _short_index_buffer;
+        ByteBuffer _index_buffer;
+
+        RangeAllocator _vertices;
+        RangeAllocator _colors;
+        RangeAllocator _short_indices;
+        RangeAllocator _indices;
+};
+
+}
+
+#endif // GEOMETRYPOOL_H
@@ -1,6 +1,7 @@
 #include "ImGuiRenderer.h"
 
-#include <TypedBuffer.h>
+#include <FrameAllocator.h>
+#include <GLState.h>
 
 #include <glm/vec2.hpp>
 
@@ -165,7 +166,7 @@ static std::unique_ptr<Texture> create_font() {
     TextureData data;
     data.format = ImageFormat::RGBA8_UNORM;
     data.size = glm::uvec2(width, height);
-    data.data = std::make_unique<u8[]>(bytes);
+    data.data = TextureData::allocate(bytes);
     std::copy_n(font_data, bytes, data.data.get());
 
     return std::make_unique<Texture>(data);
@@ -254,38 +255,33 @@ void ImGuiRenderer::render(const ImDrawData* draw_data) {
     _material.set_uniform(HASH("viewport_size"), glm::vec2(draw_data->DisplaySize.x, draw_data->DisplaySize.y));
     _material.bind();
 
-    glDisable(GL_CULL_FACE);
+    GLState& state = gl_state();
+    state.set_face_culling(false);
 
-    glEnable(GL_SCISSOR_TEST);
-    DEFER(glDisable(GL_SCISSOR_TEST));
+    state.set_scissor_test(true);
+    DEFER(state.set_scissor_test(false));
 
-    TypedBuffer<ImDrawIdx> index_buffer(nullptr, draw_data->TotalIdxCount);
-    TypedBuffer<ImDrawVert> vertex_buffer(nullptr, draw_data->TotalVtxCount);
+    const auto index_buffer = frame_allocator().allocate<ImDrawIdx>(draw_data->TotalIdxCount);
+    const auto vertex_buffer = frame_allocator().allocate<ImDrawVert>(draw_data->TotalVtxCount);
 
     {
-        auto indices = index_buffer.map(AccessType::WriteOnly);
-        auto vertices = vertex_buffer.map(AccessType::WriteOnly);
-
-        size_t index_offset = 0;
-        size_t vertex_offset = 0;
+        ImDrawIdx* indices = static_cast<ImDrawIdx*>(index_buffer.data);
+        ImDrawVert* vertices = static_cast<ImDrawVert*>(vertex_buffer.data);
         for(int c = 0; c != draw_data->CmdListsCount; ++c) {
             const ImDrawList* cmd_list = draw_data->CmdLists[c];
-            std::copy_n(cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size, &indices[index_offset]);
-            std::copy_n(cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size, &vertices[vertex_offset]);
-            vertex_offset += cmd_list->VtxBuffer.Size;
-            index_offset += cmd_list->IdxBuffer.Size;
+            indices = std::copy_n(cmd_list->IdxBuffer.Data, cmd_list->IdxBuffer.Size, indices);
+            vertices = std::copy_n(cmd_list->VtxBuffer.Data, cmd_list->VtxBuffer.Size, vertices);
         }
     }
 
     index_buffer.bind(BufferUsage::Index);
-    vertex_buffer.bind(BufferUsage::Attribute);
 
-    byte* vertex_offset = nullptr;
-    byte* index_offset = nullptr;
+    size_t vertex_offset = vertex_buffer.offset;
+    size_t index_offset = index_buffer.offset;
     for(int c = 0; c != draw_data->CmdListsCount; ++c) {
         const ImDrawList* cmd_list = draw_data->CmdLists[c];
 
-        byte* drawn_index_offset = index_offset;
+        size_t drawn_index_offset = index_offset;
         for(int i = 0; i != cmd_list->CmdBuffer.Size; ++i) {
             const ImDrawCmd& cmd = cmd_list->CmdBuffer[i];
 
@@ -303,15 +299,15 @@ void ImGuiRenderer::render(const ImDrawData* draw_data) {
                 tex->bind(0);
             }
 
-            glVertexAttribPointer(0, 2, GL_FLOAT, false, sizeof(ImDrawVert), vertex_offset);
-            glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(ImDrawVert), vertex_offset + (2 * sizeof(float)));
-            glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, false, sizeof(ImDrawVert), vertex_offset + (4 * sizeof(float)));
+            state.vertex_attrib_pointer(0, vertex_buffer.buffer, 2, GL_FLOAT, false, sizeof(ImDrawVert), vertex_offset);
+            state.vertex_attrib_pointer(1, vertex_buffer.buffer, 2, GL_FLOAT, false, sizeof(ImDrawVert), vertex_offset + (2 * sizeof(float)));
+            state.vertex_attrib_pointer(2, vertex_buffer.buffer, 4, GL_UNSIGNED_BYTE, false, sizeof(ImDrawVert), vertex_offset + (4 * sizeof(float)));
 
-            glEnableVertexAttribArray(0);
-            glEnableVertexAttribArray(1);
-            glEnableVertexAttribArray(2);
-            glDisableVertexAttribArray(3);
-            glDisableVertexAttribArray(4);
+            state.enable_vertex_attrib(0, true);
+            state.enable_vertex_attrib(1, true);
+            state.enable_vertex_attrib(2, true);
+            state.enable_vertex_attrib(3, false);
+            state.enable_vertex_attrib(4, false);
 
             glDrawElements(GL_TRIANGLES, cmd.ElemCount, sizeof(ImDrawIdx) == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, reinterpret_cast<void*>(drawn_index_offset));
             drawn_index_offset += cmd.ElemCount * sizeof(ImDrawIdx);
@@ -11,11 +11,35 @@ ImageFormatGL image_format_to_gl(ImageFormat format) {
         case ImageFormat::RGB8_UNORM:       return ImageFormatGL{ GL_RGB, GL_RGB8, GL_UNSIGNED_BYTE };
         case ImageFormat::RGB8_sRGB:        return ImageFormatGL{ GL_RGB, GL_SRGB8, GL_UNSIGNED_BYTE };
         case ImageFormat::RG16_UNORM:       return ImageFormatGL{ GL_RG, GL_RG16, GL_UNSIGNED_SHORT };
+        case ImageFormat::RGB10_A2_UNORM:   return ImageFormatGL{ GL_RGBA, GL_RGB10_A2, GL_UNSIGNED_INT_2_10_10_10_REV };
         case ImageFormat::RGBA16_FLOAT:     return ImageFormatGL{ GL_RGBA, GL_RGBA16F, GL_FLOAT };
         case ImageFormat::Depth32_FLOAT:    return ImageFormatGL{ GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT32F, GL_FLOAT };
+        case ImageFormat::R32_FLOAT:        return ImageFormatGL{ GL_RED, GL_R32F, GL_FLOAT };
+        case ImageFormat::RG32_UINT:        return ImageFormatGL{ GL_RG_INTEGER, GL_RG32UI, GL_UNSIGNED_INT };
     }
 
     FATAL("Unknown image format");
 }
 
+u32 bytes_per_pixel(ImageFormat format) {
+    switch(format) {
+        case ImageFormat::RGBA8_UNORM:      return 4;
+        case ImageFormat::RGBA8_sRGB:       return 4;
+        case ImageFormat::RGB8_UNORM:       return 3;
+        case ImageFormat::RGB8_sRGB:        return 3;
+        case ImageFormat::RG16_UNORM:       return 4;
+        case ImageFormat::RGB10_A2_UNORM:   return 4;
+        case ImageFormat::RGBA16_FLOAT:     return 8;
+        case ImageFormat::Depth32_FLOAT:    return 4;
+        case ImageFormat::R32_FLOAT:        return 4;
+        case ImageFormat::RG32_UINT:        return 8;
+    }
+
+    FATAL("Unknown image format");
+}
+
+bool is_integer_format(ImageFormat format) {
+    return format == ImageFormat::RG32_UINT;
+}
+
 }
@@ -12,9 +12,13 @@ enum class ImageFormat {
     RGB8_sRGB,
 
     RG16_UNORM,
+    RGB10_A2_UNORM,
 
     RGBA16_FLOAT,
-    Depth32_FLOAT
+    Depth32_FLOAT,
+
+    R32_FLOAT,
+    RG32_UINT
 };
 
 
@@ -25,6 +29,9 @@ struct ImageFormatGL {
 };
 
 ImageFormatGL image_format_to_gl(ImageFormat format);
+u32 bytes_per_pixel(ImageFormat format);
+// Integer textures can only be read with texelFetch or as images
+bool is_integer_format(ImageFormat format);
 
 }
 
@@ -0,0 +1,72 @@
+#include "LightClusters.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace OM3D {
+
+// Slices past the first one cover at most this ratio of depths, the first one covers everything closer
+static constexpr float depth_range_ratio = 4096.0f;
+
+LightClusters::LightClusters() : _program(Program::from_file("light_cluster.comp")) {
+    // The lighting pass declares the cluster buffers even when clustering is disabled, they must always be valid
+    _counts = std::make_unique<ByteBuffer>(nullptr, sizeof(u32));
+    _indices = std::make_unique<ByteBuffer>(nullptr, sizeof(u32));
+}
+
+void LightClusters::setup(shader::FrameData& frame, const Camera& camera, const glm::uvec2& viewport_size, Span<const PointLight> lights) {
+    const glm::vec3 position = camera.position();
+    const glm::vec3 forward = camera.forward();
+
+    float max_depth = 0.0f;
+    for(const PointLight& light : lights) {
+        max_depth = std::max(max_depth, glm::dot(light.position() - position, forward) + light.radius());
+    }
+
+    const float near = camera.is_orthographic() ? 0.0f : camera.projection_matrix()[3][2];
+    const float depth_min = std::max(near, max_depth / depth_range_ratio);
+    max_depth = std::max(max_depth, depth_min * 2.0f);
+
+    _viewport_size = glm::max(viewport_size, glm::uvec2(1));
+    const glm::uvec2 tiles = (_viewport_size + tile_size - 1u) / tile_size;
+    _cluster_count = tiles.x * tiles.y * depth_slices;
+
+    frame.cluster_grid = glm::uvec3(tiles, depth_slices);
+    frame.cluster_tile_size = tile_size;
+    frame.cluster_depth_min = depth_min;
+    frame.cluster_depth_scale = float(depth_slices - 1) / std::log(max_depth / depth_min);
+    frame.max_lights_per_cluster = max_lights_per_cluster;
+}
+
+void LightClusters::build(const Camera& camera) {
+    // Buffers only ever grow
+    if(_counts->byte_size() < _cluster_count * sizeof(u32)) {
+        _counts = std::make_unique<ByteBuffer>(nullptr, _cluster_count * sizeof(u32));
+        _indices = std::make_unique<ByteBuffer>(nullptr, _cluster_count * max_lights_per_cluster * sizeof(u32));
+    }
+
+    const glm::mat4& proj = camera.projection_matrix();
+
+    _program->bind();
+    _program->set_uniform(HASH("view"), camera.view_matrix());
+    _program->set_uniform(HASH("proj_scale"), glm::vec2(proj[0][0], proj[1][1]));
+    _program->set_uniform(HASH("proj_offset"), glm::vec2(proj[3][0], proj[3][1]));
+    _program->set_uniform(HASH("orthographic"), u32(camera.is_orthographic()));
+    _program->set_uniform(HASH("viewport_size"), glm::vec2(_viewport_size));
+
+    _counts->bind(BufferUsage::Storage, 2);
+    _indices->bind(BufferUsage::Storage, 3);
+
+    glDispatchCompute((_cluster_count + 63) / 64, 1, 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void LightClusters::bind() const {
+    _counts->bind(BufferUsage::Storage, 5);
+    _indices->bind(BufferUsage::Storage, 6);
+}
+
+}
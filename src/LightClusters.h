@@ -0,0 +1,47 @@
+#ifndef LIGHTCLUSTERS_H
+#define LIGHTCLUSTERS_H
+
+#include <PointLight.h>
+#include <Camera.h>
+#include <ByteBuffer.h>
+#include <Program.h>
+
+#include <shader_structs.h>
+
+#include <memory>
+
+namespace OM3D {
+
+// Bins point lights into a froxel grid (screen tiles times exponential depth slices) in a compute pass,
+// so the lighting pass only evaluates the lights whose radius reaches the fragment's cluster.
+// Slices end at the farthest view depth any light reaches: fragments past it are not lit by point lights at all
+class LightClusters : NonMovable {
+    public:
+        static constexpr u32 tile_size = 64;
+        static constexpr u32 depth_slices = 24;
+        static constexpr u32 max_lights_per_cluster = 128;
+
+        LightClusters();
+
+        // Fills the cluster grid of the frame data
+        void setup(shader::FrameData& frame, const Camera& camera, const glm::uvec2& viewport_size, Span<const PointLight> lights);
+
+        // The frame data filled by setup must be bound, as well as the lights at storage binding 1
+        void build(const Camera& camera);
+
+        // Light counts at storage binding 5 and light indices at 6, as read by lit.frag
+        void bind() const;
+
+    private:
+        std::shared_ptr<Program> _program;
+
+        std::unique_ptr<ByteBuffer> _counts;
+        std::unique_ptr<ByteBuffer> _indices;
+
+        glm::uvec2 _viewport_size = {};
+        u32 _cluster_count = 0;
+};
+
+}
+
+#endif // LIGHTCLUSTERS_H
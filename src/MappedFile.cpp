@@ -0,0 +1,115 @@
+#include "MappedFile.h"
+
+#ifdef OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace OM3D {
+
+MappedFile::MappedFile(MappedFile&& other) {
+    swap(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) {
+    swap(other);
+    return *this;
+}
+
+void MappedFile::swap(MappedFile& other) {
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+#ifdef OS_WIN
+    std::swap(_file, other._file);
+    std::swap(_mapping, other._mapping);
+#endif
+}
+
+#ifdef OS_WIN
+
+MappedFile::~MappedFile() {
+    if(_data) {
+        UnmapViewOfFile(_data);
+    }
+    if(_mapping) {
+        CloseHandle(_mapping);
+    }
+    if(_file) {
+        CloseHandle(_file);
+    }
+}
+
+Result<MappedFile> MappedFile::open(const std::string& file_name) {
+    MappedFile file;
+
+    const HANDLE handle = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(handle == INVALID_HANDLE_VALUE) {
+        return {false, {}};
+    }
+    file._file = handle;
+
+    LARGE_INTEGER size = {};
+    if(!GetFileSizeEx(handle, &size) || !size.QuadPart) {
+        return {false, {}};
+    }
+    file._size = size_t(size.QuadPart);
+
+    file._mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!file._mapping) {
+        return {false, {}};
+    }
+
+    file._data = static_cast<const u8*>(MapViewOfFile(file._mapping, FILE_MAP_READ, 0, 0, 0));
+    if(!file._data) {
+        return {false, {}};
+    }
+
+    return {true, std::move(file)};
+}
+
+#else
+
+MappedFile::~MappedFile() {
+    if(_data) {
+        munmap(const_cast<u8*>(_data), _size);
+    }
+}
+
+Result<MappedFile> MappedFile::open(const std::string& file_name) {
+    const int fd = ::open(file_name.c_str(), O_RDONLY);
+    if(fd < 0) {
+        return {false, {}};
+    }
+    DEFER(::close(fd));
+
+    struct stat st = {};
+    if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+        return {false, {}};
+    }
+
+    void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if(data == MAP_FAILED) {
+        return {false, {}};
+    }
+
+    MappedFile file;
+    file._data = static_cast<const u8*>(data);
+    file._size = size_t(st.st_size);
+    return {true, std::move(file)};
+}
+
+#endif
+
+const u8* MappedFile::data() const {
+    return _data;
+}
+
+size_t MappedFile::size() const {
+    return _size;
+}
+
+}
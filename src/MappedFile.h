@@ -0,0 +1,39 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <utils.h>
+
+#include <string>
+
+namespace OM3D {
+
+// Read-only memory mapping of a whole file
+class MappedFile : NonCopyable {
+    public:
+        MappedFile() = default;
+
+        MappedFile(MappedFile&& other);
+        MappedFile& operator=(MappedFile&& other);
+
+        ~MappedFile();
+
+        void swap(MappedFile& other);
+
+        static Result<MappedFile> open(const std::string& file_name);
+
+        const u8* data() const;
+        size_t size() const;
+
+    private:
+        const u8* _data = nullptr;
+        size_t _size = 0;
+
+#ifdef OS_WIN
+        void* _file = nullptr;
+        void* _mapping = nullptr;
+#endif
+};
+
+}
+
+#endif // MAPPEDFILE_H
@@ -1,5 +1,8 @@
 #include "Material.h"
 
+#include <StaticMesh.h>
+#include <GLState.h>
+
 #include <glad/gl.h>
 
 #include <algorithm>
@@ -25,11 +28,14 @@ void Material::set_double_sided(bool double_sided) {
     _double_sided = double_sided;
 }
 
-void Material::set_texture(u32 slot, std::shared_ptr<Texture> tex) {
-    if(const auto it = std::find_if(_textures.begin(), _textures.end(), [&](const auto& t) { return t.first == slot; }); it != _textures.end()) {
-        it->second = std::move(tex);
+void Material::set_texture(u32 slot, std::shared_ptr<Texture> tex, u32 layer) {
+    DEBUG_ASSERT(_texture_arrays == (tex->texture_type() == GL_TEXTURE_2D_ARRAY));
+
+    if(const auto it = std::find_if(_textures.begin(), _textures.end(), [&](const auto& t) { return t.slot == slot; }); it != _textures.end()) {
+        it->texture = std::move(tex);
+        it->layer = layer;
     } else {
-        _textures.emplace_back(slot, std::move(tex));
+        _textures.push_back({slot, std::move(tex), layer});
     }
 }
 
@@ -37,6 +43,27 @@ bool Material::is_opaque() const {
     return _blend_mode == BlendMode::None;
 }
 
+bool Material::is_double_sided() const {
+    return _double_sided;
+}
+
+const Program* Material::program() const {
+    return _program.get();
+}
+
+Program& Material::pass_program(MaterialPass pass) const {
+    if(pass == MaterialPass::DepthPrepass && _depth_program) {
+        return *_depth_program;
+    }
+    if(pass == MaterialPass::GBuffer && _gbuffer_program) {
+        return *_gbuffer_program;
+    }
+    if(pass == MaterialPass::Visibility && _visibility_program) {
+        return *_visibility_program;
+    }
+    return *_program;
+}
+
 void Material::set_stored_uniform(u32 name_hash, UniformValue value) {
     for(auto& [h, v] : _uniforms) {
         if(h == name_hash) {
@@ -47,50 +74,172 @@ void Material::set_stored_uniform(u32 name_hash, UniformValue value) {
     _uniforms.emplace_back(name_hash, std::move(value));
 }
 
-void Material::bind() const {
+void Material::bind(const Material* previous, StateChangeStats* stats, MaterialPass pass) const {
+    if(previous == this) {
+        return;
+    }
+
+    StateChangeStats ignored;
+    StateChangeStats& counters = stats ? *stats : ignored;
+    ++counters.material_changes;
+
+    if(!previous || previous->_blend_mode != _blend_mode) {
+        ++counters.render_state_changes;
+        bind_blend_mode();
+    }
+
+    const DepthTestMode depth_test_mode = pass_depth_test_mode(pass);
+    if(!previous || previous->pass_depth_test_mode(pass) != depth_test_mode) {
+        ++counters.render_state_changes;
+        bind_depth_test_mode(depth_test_mode);
+    }
+
+    // Only alpha tested materials sample textures in the depth prepass
+    if(binds_textures(pass)) {
+        const bool previous_bound = previous && previous->binds_textures(pass);
+        for(const auto& [slot, texture, layer] : _textures) {
+            if(previous_bound) {
+                const auto it = std::find_if(previous->_textures.begin(), previous->_textures.end(), [&](const auto& t) { return t.slot == slot; });
+                if(it != previous->_textures.end() && it->texture == texture) {
+                    continue;
+                }
+            }
+            ++counters.texture_binds;
+            texture->bind(slot);
+        }
+    }
+
+    Program& program = pass_program(pass);
+    if(!uses_material_table()) {
+        for(const auto& [h, v] : _uniforms) {
+            program.set_uniform(h, v);
+        }
+    }
+
+    if(!previous || &previous->pass_program(pass) != &program) {
+        ++counters.program_binds;
+        program.bind();
+    }
+}
+
+bool Material::uses_material_table() const {
+    return _bindless || _texture_arrays;
+}
+
+shader::MaterialParams Material::params() const {
+    shader::MaterialParams params = {};
+    params.base_color_factor = glm::vec3(1.0f);
+    params.emissive_factor = glm::vec3(0.0f);
+    params.metal_rough_factor = glm::vec2(1.0f);
+
+    for(const auto& [h, v] : _uniforms) {
+        if(h == HASH("base_color_factor")) {
+            params.base_color_factor = std::get<glm::vec3>(v);
+        } else if(h == HASH("emissive_factor")) {
+            params.emissive_factor = std::get<glm::vec3>(v);
+        } else if(h == HASH("metal_rough_factor")) {
+            params.metal_rough_factor = std::get<glm::vec2>(v);
+        } else if(h == HASH("alpha_cutoff")) {
+            params.alpha_cutoff = std::get<float>(v);
+        }
+    }
+
+    for(const auto& [slot, texture, layer] : _textures) {
+        if(slot >= 4) {
+            continue;
+        }
+
+        if(_bindless) {
+            const u64 handle = texture->bindless_handle();
+            params.textures[slot] = glm::uvec2(u32(handle), u32(handle >> 32));
+        } else {
+            params.textures[slot] = glm::uvec2(layer, 0);
+        }
+    }
+
+    return params;
+}
+
+bool Material::can_batch_with(const Material& other) const {
+    if(&other == this) {
+        return true;
+    }
+
+    if(!uses_material_table() || !other.uses_material_table()) {
+        return false;
+    }
+
+    if(_program != other._program || _blend_mode != other._blend_mode || _depth_test_mode != other._depth_test_mode) {
+        return false;
+    }
+
+    // Texture array materials can only be batched if they sample the same arrays, layers come from the table
+    if(_texture_arrays) {
+        for(const auto& [slot, texture, layer] : _textures) {
+            const auto it = std::find_if(other._textures.begin(), other._textures.end(), [&](const auto& t) { return t.slot == slot; });
+            if(it == other._textures.end() || it->texture != texture) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void Material::bind_blend_mode() const {
     switch(_blend_mode) {
         case BlendMode::None:
-            glDisable(GL_BLEND);
+            gl_state().set_blending(false);
         break;
 
         case BlendMode::Alpha:
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            gl_state().set_blending(true);
+            gl_state().set_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        break;
+
+        case BlendMode::Additive:
+            gl_state().set_blending(true);
+            gl_state().set_blend_func(GL_ONE, GL_ONE);
         break;
     }
+}
 
-    switch(_depth_test_mode) {
+DepthTestMode Material::pass_depth_test_mode(MaterialPass pass) const {
+    // The prepass already wrote the depth of the closest surface
+    if(pass == MaterialPass::AfterPrepass && _depth_test_mode == DepthTestMode::Standard) {
+        return DepthTestMode::Equal;
+    }
+    return _depth_test_mode;
+}
+
+bool Material::binds_textures(MaterialPass pass) const {
+    const bool depth_only = pass == MaterialPass::DepthPrepass || pass == MaterialPass::Visibility;
+    return !_bindless && (!depth_only || _alpha_test);
+}
+
+void Material::bind_depth_test_mode(DepthTestMode mode) const {
+    switch(mode) {
         case DepthTestMode::None:
-            glDisable(GL_DEPTH_TEST);
+            gl_state().set_depth_test(false);
         break;
 
         case DepthTestMode::Equal:
-            glEnable(GL_DEPTH_TEST);
-            glDepthFunc(GL_EQUAL);
+            gl_state().set_depth_test(true);
+            gl_state().set_depth_func(GL_EQUAL);
         break;
 
         case DepthTestMode::Standard:
-            glEnable(GL_DEPTH_TEST);
+            gl_state().set_depth_test(true);
             // We are using reverse-Z
-            glDepthFunc(GL_GEQUAL);
+            gl_state().set_depth_func(GL_GEQUAL);
         break;
 
         case DepthTestMode::Reversed:
-            glEnable(GL_DEPTH_TEST);
+            gl_state().set_depth_test(true);
             // We are using reverse-Z
-            glDepthFunc(GL_LEQUAL);
+            gl_state().set_depth_func(GL_LEQUAL);
         break;
     }
-
-    for(const auto& texture : _textures) {
-        texture.second->bind(texture.first);
-    }
-
-    for(const auto& [h, v] : _uniforms) {
-        _program->set_uniform(h, v);
-    }
-
-    _program->bind();
 }
 
 Material Material::textured_pbr_material(bool alpha_test) {
@@ -100,13 +249,46 @@ Material Material::textured_pbr_material(bool alpha_test) {
     if(alpha_test) {
         defines.emplace_back("ALPHA_TEST");
     }
+    if(compact_vertex_format) {
+        defines.emplace_back("COMPACT_VERTEX");
+    }
+    if(draw_parameters_enabled()) {
+        defines.emplace_back("DRAW_PARAMETERS");
+    }
+    if(bindless_enabled()) {
+        defines.emplace_back("BINDLESS");
+        if(nonuniform_bindless_handles()) {
+            defines.emplace_back("NONUNIFORM_HANDLES");
+        }
+        material._bindless = true;
+    } else if(texture_arrays_enabled()) {
+        defines.emplace_back("TEXTURE_ARRAYS");
+        material._texture_arrays = true;
+    }
 
     material._program = Program::from_files("lit.frag", "basic.vert", defines);
+    material._gbuffer_program = Program::from_files("gbuffer.frag", "basic.vert", defines);
+    material._alpha_test = alpha_test;
+
+    defines.emplace_back("DEPTH_ONLY");
+    material._depth_program = Program::from_files("depth.frag", "basic.vert", defines);
 
-    material.set_texture(0u, default_white_texture());
-    material.set_texture(1u, default_normal_texture());
-    material.set_texture(2u, default_metal_rough_texture());
-    material.set_texture(3u, default_white_texture());
+    if(visibility_buffer_supported()) {
+        defines.emplace_back("VISIBILITY");
+        material._visibility_program = Program::from_files("depth.frag", "basic.vert", defines);
+    }
+
+    if(material._texture_arrays) {
+        material.set_texture(0u, default_texture_array(), 0);
+        material.set_texture(1u, default_texture_array(), 1);
+        material.set_texture(2u, default_texture_array(), 2);
+        material.set_texture(3u, default_texture_array(), 0);
+    } else {
+        material.set_texture(0u, default_white_texture());
+        material.set_texture(1u, default_normal_texture());
+        material.set_texture(2u, default_metal_rough_texture());
+        material.set_texture(3u, default_white_texture());
+    }
 
     return material;
 }
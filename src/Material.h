@@ -3,6 +3,7 @@
 
 #include <Program.h>
 #include <Texture.h>
+#include <shader_structs.h>
 
 #include <memory>
 #include <vector>
@@ -12,6 +13,7 @@ namespace OM3D {
 enum class BlendMode {
     None,
     Alpha,
+    Additive,
 };
 
 enum class DepthTestMode {
@@ -21,6 +23,29 @@ enum class DepthTestMode {
     None
 };
 
+// With a depth prepass, opaque objects are first drawn with a depth only program,
+// then shaded with an equal depth test so each pixel is only shaded once.
+// With deferred shading, they only write their surface parameters to the G-buffer,
+// and with a visibility buffer only the triangle covering each pixel
+enum class MaterialPass {
+    Main,
+    DepthPrepass,
+    AfterPrepass,
+    GBuffer,
+    Visibility,
+};
+
+// State actually changed by Material::bind
+struct StateChangeStats {
+    u32 draws = 0;
+    u32 draw_calls = 0;
+    u32 instances = 0;
+    u32 material_changes = 0;
+    u32 program_binds = 0;
+    u32 texture_binds = 0;
+    u32 render_state_changes = 0;
+};
+
 class Material {
 
     public:
@@ -30,9 +55,15 @@ class Material {
         void set_blend_mode(BlendMode blend);
         void set_depth_test_mode(DepthTestMode depth);
         void set_double_sided(bool double_sided);
-        void set_texture(u32 slot, std::shared_ptr<Texture> tex);
+        // layer is only used by texture array materials
+        void set_texture(u32 slot, std::shared_ptr<Texture> tex, u32 layer = 0);
 
         bool is_opaque() const;
+        bool is_double_sided() const;
+
+        const Program* program() const;
+        // Program the material binds in pass, the main program if it has no variant for it
+        Program& pass_program(MaterialPass pass = MaterialPass::Main) const;
 
         // Uniform will be stored inside the material and reset every time its bound
         void set_stored_uniform(u32 name_hash, UniformValue value);
@@ -43,18 +74,45 @@ class Material {
             _program->set_uniform(FWD(args)...);
         }
 
-        void bind() const;
+        // Only changes the state that differs from previous, which must be the last material bound
+        // Previous must have been bound in the same pass
+        void bind(const Material* previous = nullptr, StateChangeStats* stats = nullptr, MaterialPass pass = MaterialPass::Main) const;
+
+        // Bindless and texture array materials read their factors (and layers or texture handles) from the material table
+        bool uses_material_table() const;
+        shader::MaterialParams params() const;
+
+        // True if draws using other can be submitted together with draws using this material
+        bool can_batch_with(const Material& other) const;
 
         static Material textured_pbr_material(bool alpha_test = false);
 
     private:
+        void bind_blend_mode() const;
+        void bind_depth_test_mode(DepthTestMode mode) const;
+
+        DepthTestMode pass_depth_test_mode(MaterialPass pass) const;
+        bool binds_textures(MaterialPass pass) const;
+
         std::shared_ptr<Program> _program;
-        std::vector<std::pair<u32, std::shared_ptr<Texture>>> _textures;
+        std::shared_ptr<Program> _depth_program;
+        std::shared_ptr<Program> _gbuffer_program;
+        std::shared_ptr<Program> _visibility_program;
+        struct TextureSlot {
+            u32 slot = 0;
+            std::shared_ptr<Texture> texture;
+            u32 layer = 0;
+        };
+
+        std::vector<TextureSlot> _textures;
         std::vector<std::pair<u32, UniformValue>> _uniforms;
 
         BlendMode _blend_mode = BlendMode::None;
         DepthTestMode _depth_test_mode = DepthTestMode::Standard;
         bool _double_sided = false;
+        bool _alpha_test = false;
+        bool _bindless = false;
+        bool _texture_arrays = false;
 };
 
 }
@@ -0,0 +1,769 @@
+#include "MeshOptimizer.h"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <string_view>
+#include <cstring>
+#include <cmath>
+#include <limits>
+
+namespace OM3D {
+
+double VertexCacheStats::acmr() const {
+    return triangles ? double(transforms) / double(triangles) : 0.0;
+}
+
+double VertexCacheStats::atvr() const {
+    return vertices ? double(transforms) / double(vertices) : 0.0;
+}
+
+VertexCacheStats& VertexCacheStats::operator+=(const VertexCacheStats& other) {
+    triangles += other.triangles;
+    vertices += other.vertices;
+    transforms += other.transforms;
+    return *this;
+}
+
+
+// FIFO cache: a vertex is cached if it has been transformed less than cache_size misses ago
+class VertexCache {
+    public:
+        VertexCache(size_t vertex_count, u32 cache_size) : _timestamps(vertex_count, 0), _cache_size(cache_size), _time(cache_size + 1) {
+        }
+
+        void reset() {
+            _time += _cache_size + 1;
+        }
+
+        u32 access(u32 vertex) {
+            if(_time - _timestamps[vertex] > _cache_size) {
+                _timestamps[vertex] = _time++;
+                return 1;
+            }
+            return 0;
+        }
+
+        u32 access_triangle(const u32* tri) {
+            return access(tri[0]) + access(tri[1]) + access(tri[2]);
+        }
+
+    private:
+        std::vector<u64> _timestamps;
+        u64 _cache_size = 0;
+        u64 _time = 0;
+};
+
+VertexCacheStats analyze_vertex_cache(Span<const u32> indices, size_t vertex_count, u32 cache_size) {
+    VertexCacheStats stats;
+    stats.triangles = indices.size() / 3;
+
+    std::vector<bool> used(vertex_count, false);
+    VertexCache cache(vertex_count, cache_size);
+    for(const u32 index : indices) {
+        stats.transforms += cache.access(index);
+        if(!used[index]) {
+            used[index] = true;
+            ++stats.vertices;
+        }
+    }
+
+    return stats;
+}
+
+
+size_t weld_vertices(MeshData& mesh) {
+    auto vertex_bytes = [&](u32 index) {
+        return std::string_view(reinterpret_cast<const char*>(&mesh.vertices[index]), sizeof(Vertex));
+    };
+
+    static_assert(sizeof(Vertex) == 15 * sizeof(float), "Vertex should not contain padding");
+
+    auto hash = [&](u32 index) { return std::hash<std::string_view>()(vertex_bytes(index)); };
+    auto equal = [&](u32 a, u32 b) { return vertex_bytes(a) == vertex_bytes(b); };
+    std::unordered_map<u32, u32, decltype(hash), decltype(equal)> unique(mesh.vertices.size(), hash, equal);
+
+    std::vector<u32> remap(mesh.vertices.size());
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for(u32 i = 0; i != mesh.vertices.size(); ++i) {
+        const auto [it, inserted] = unique.try_emplace(i, u32(vertices.size()));
+        if(inserted) {
+            vertices.push_back(mesh.vertices[i]);
+        }
+        remap[i] = it->second;
+    }
+
+    for(u32& index : mesh.indices) {
+        index = remap[index];
+    }
+
+    const size_t welded = mesh.vertices.size() - vertices.size();
+    mesh.vertices = std::move(vertices);
+    return welded;
+}
+
+
+void optimize_vertex_cache(MeshData& mesh, u32 cache_size) {
+    optimize_vertex_cache(mesh.indices, mesh.vertices.size(), cache_size);
+}
+
+void optimize_vertex_cache(std::vector<u32>& index_buffer, size_t vertex_count, u32 cache_size) {
+    const size_t triangle_count = index_buffer.size() / 3;
+    const u32* indices = index_buffer.data();
+
+    // Vertex to triangle adjacency
+    std::vector<u32> live_triangles(vertex_count, 0);
+    for(size_t i = 0; i != triangle_count * 3; ++i) {
+        ++live_triangles[indices[i]];
+    }
+
+    std::vector<u32> offsets(vertex_count + 1, 0);
+    std::partial_sum(live_triangles.begin(), live_triangles.end(), offsets.begin() + 1);
+
+    std::vector<u32> adjacency(triangle_count * 3);
+    {
+        std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i != triangle_count * 3; ++i) {
+            adjacency[fill[indices[i]]++] = u32(i / 3);
+        }
+    }
+
+    std::vector<u64> timestamps(vertex_count, 0);
+    u64 time = cache_size + 1;
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<u32> dead_end;
+    std::vector<u32> candidates;
+    std::vector<u32> output;
+    output.reserve(triangle_count * 3);
+
+    u32 scan_cursor = 0;
+
+    auto next_vertex = [&]() -> i64 {
+        // Pick the candidate that will still be in cache once all its triangles have been emitted, preferring the oldest one
+        i64 best = -1;
+        i64 best_priority = -1;
+        for(const u32 v : candidates) {
+            if(!live_triangles[v]) {
+                continue;
+            }
+
+            i64 priority = 0;
+            if(time - timestamps[v] + 2 * live_triangles[v] <= cache_size) {
+                priority = i64(time - timestamps[v]);
+            }
+            if(priority > best_priority) {
+                best_priority = priority;
+                best = v;
+            }
+        }
+
+        if(best >= 0) {
+            return best;
+        }
+
+        while(!dead_end.empty()) {
+            const u32 v = dead_end.back();
+            dead_end.pop_back();
+            if(live_triangles[v]) {
+                return v;
+            }
+        }
+
+        for(; scan_cursor != vertex_count; ++scan_cursor) {
+            if(live_triangles[scan_cursor]) {
+                return scan_cursor;
+            }
+        }
+
+        return -1;
+    };
+
+    for(i64 fan = vertex_count ? 0 : -1; fan >= 0; fan = next_vertex()) {
+        candidates.clear();
+        for(u32 i = offsets[fan]; i != offsets[fan + 1]; ++i) {
+            const u32 tri = adjacency[i];
+            if(emitted[tri]) {
+                continue;
+            }
+            emitted[tri] = true;
+
+            for(u32 k = 0; k != 3; ++k) {
+                const u32 v = indices[tri * 3 + k];
+                output.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live_triangles[v];
+                if(time - timestamps[v] > cache_size) {
+                    timestamps[v] = time++;
+                }
+            }
+        }
+    }
+
+    DEBUG_ASSERT(output.size() == triangle_count * 3);
+    index_buffer = std::move(output);
+}
+
+
+void optimize_overdraw(MeshData& mesh, float threshold, u32 cache_size) {
+    const size_t triangle_count = mesh.indices.size() / 3;
+    if(!triangle_count) {
+        return;
+    }
+
+    const u32* indices = mesh.indices.data();
+    VertexCache cache(mesh.vertices.size(), cache_size);
+
+    // Hard boundaries are where the cache optimizer restarted: every vertex of the triangle missed
+    std::vector<u32> hard_boundaries;
+    for(u32 t = 0; t != triangle_count; ++t) {
+        if(cache.access_triangle(indices + t * 3) == 3) {
+            hard_boundaries.push_back(t);
+        }
+    }
+    hard_boundaries.push_back(u32(triangle_count));
+
+    // Split further wherever the cluster's ACMR so far is within threshold of the whole cluster's
+    std::vector<u32> clusters;
+    for(size_t c = 0; c + 1 < hard_boundaries.size(); ++c) {
+        const u32 begin = hard_boundaries[c];
+        const u32 end = hard_boundaries[c + 1];
+
+        cache.reset();
+        u32 misses = 0;
+        for(u32 t = begin; t != end; ++t) {
+            misses += cache.access_triangle(indices + t * 3);
+        }
+        const float limit = float(misses) / float(end - begin) * threshold;
+
+        cache.reset();
+        clusters.push_back(begin);
+        u32 cluster_begin = begin;
+        u32 cluster_misses = 0;
+        for(u32 t = begin; t != end; ++t) {
+            cluster_misses += cache.access_triangle(indices + t * 3);
+            if(t + 1 != end && float(cluster_misses) / float(t + 1 - cluster_begin) <= limit) {
+                cluster_begin = t + 1;
+                cluster_misses = 0;
+                clusters.push_back(cluster_begin);
+                cache.reset();
+            }
+        }
+    }
+    clusters.push_back(u32(triangle_count));
+
+    // Sort clusters by how much they face away from the mesh center
+    const size_t cluster_count = clusters.size() - 1;
+    std::vector<glm::vec3> centroids(cluster_count);
+    std::vector<glm::vec3> normals(cluster_count);
+    glm::vec3 mesh_center = {};
+    float mesh_area = 0.0f;
+    for(size_t c = 0; c != cluster_count; ++c) {
+        glm::vec3 centroid = {};
+        glm::vec3 normal = {};
+        float area = 0.0f;
+        for(u32 t = clusters[c]; t != clusters[c + 1]; ++t) {
+            const glm::vec3 p0 = mesh.vertices[indices[t * 3 + 0]].position;
+            const glm::vec3 p1 = mesh.vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 p2 = mesh.vertices[indices[t * 3 + 2]].position;
+            const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            const float a = glm::length(n);
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+
+        mesh_center += centroid;
+        mesh_area += area;
+        centroids[c] = area > 0.0f ? centroid / area : glm::vec3(mesh.vertices[indices[clusters[c] * 3]].position);
+        normals[c] = glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f);
+    }
+    mesh_center = mesh_area > 0.0f ? mesh_center / mesh_area : glm::vec3(0.0f);
+
+    std::vector<float> sort_keys(cluster_count);
+    for(size_t c = 0; c != cluster_count; ++c) {
+        sort_keys[c] = glm::dot(centroids[c] - mesh_center, normals[c]);
+    }
+
+    std::vector<u32> order(cluster_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b) { return sort_keys[a] > sort_keys[b]; });
+
+    std::vector<u32> output;
+    output.reserve(mesh.indices.size());
+    for(const u32 c : order) {
+        output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+    }
+    mesh.indices = std::move(output);
+}
+
+
+void optimize_vertex_fetch(MeshData& mesh) {
+    constexpr u32 unused = u32(-1);
+
+    std::vector<u32> remap(mesh.vertices.size(), unused);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+    for(u32& index : mesh.indices) {
+        if(remap[index] == unused) {
+            remap[index] = u32(vertices.size());
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    mesh.vertices = std::move(vertices);
+}
+
+
+MeshOptimizationStats optimize_mesh(MeshData& mesh) {
+    MeshOptimizationStats stats;
+    stats.before = analyze_vertex_cache(mesh.indices, mesh.vertices.size());
+
+    stats.welded_vertices = weld_vertices(mesh);
+
+    // Exporters sometimes already optimize meshes, never make them worse for the vertex cache
+    std::vector<u32> original_indices = mesh.indices;
+    optimize_vertex_cache(mesh);
+    optimize_overdraw(mesh);
+    if(analyze_vertex_cache(mesh.indices, mesh.vertices.size()).transforms > analyze_vertex_cache(original_indices, mesh.vertices.size()).transforms) {
+        mesh.indices = std::move(original_indices);
+    }
+
+    optimize_vertex_fetch(mesh);
+
+    stats.after = analyze_vertex_cache(mesh.indices, mesh.vertices.size());
+    return stats;
+}
+
+
+static shader::Meshlet compute_meshlet_bounds(const MeshData& mesh, u32 first_index, u32 triangle_count) {
+    const u32* indices = mesh.indices.data() + first_index;
+
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+    glm::vec3 normal_sum = {};
+    for(u32 i = 0; i != triangle_count * 3; i += 3) {
+        const glm::vec3 p0 = mesh.vertices[indices[i + 0]].position;
+        const glm::vec3 p1 = mesh.vertices[indices[i + 1]].position;
+        const glm::vec3 p2 = mesh.vertices[indices[i + 2]].position;
+        min = glm::min(min, glm::min(p0, glm::min(p1, p2)));
+        max = glm::max(max, glm::max(p0, glm::max(p1, p2)));
+
+        const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        const float len = glm::length(n);
+        if(len > 0.0f) {
+            normal_sum += n / len;
+        }
+    }
+
+    shader::Meshlet meshlet = {};
+    meshlet.first_index = first_index;
+    meshlet.triangle_count = triangle_count;
+    meshlet.center = (min + max) * 0.5f;
+    for(u32 i = 0; i != triangle_count * 3; ++i) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(mesh.vertices[indices[i]].position - meshlet.center));
+    }
+
+    // A cone that can never pass the test disables backface culling for the meshlet
+    meshlet.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.cone_cutoff = 1.0f;
+
+    const float normal_len = glm::length(normal_sum);
+    if(normal_len > 0.0f) {
+        const glm::vec3 axis = normal_sum / normal_len;
+        float min_dot = 1.0f;
+        for(u32 i = 0; i != triangle_count * 3; i += 3) {
+            const glm::vec3 p0 = mesh.vertices[indices[i + 0]].position;
+            const glm::vec3 n = glm::cross(mesh.vertices[indices[i + 1]].position - p0, mesh.vertices[indices[i + 2]].position - p0);
+            const float len = glm::length(n);
+            if(len > 0.0f) {
+                min_dot = std::min(min_dot, glm::dot(n / len, axis));
+            }
+        }
+
+        // Cones wider than a hemisphere can't be culled
+        if(min_dot > 0.1f) {
+            meshlet.cone_axis = axis;
+            meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+        }
+    }
+
+    return meshlet;
+}
+
+std::vector<shader::Meshlet> build_meshlets(const MeshData& mesh, u32 max_vertices, u32 max_triangles) {
+    DEBUG_ASSERT(max_vertices >= 3);
+
+    std::vector<shader::Meshlet> meshlets;
+
+    // Vertices referenced by the current meshlet are tagged with its index + 1
+    std::vector<u32> vertex_tags(mesh.vertices.size(), 0);
+    u32 tag = 1;
+
+    u32 first_index = 0;
+    u32 vertex_count = 0;
+    u32 triangle_count = 0;
+
+    const u32 index_count = u32(mesh.indices.size() / 3 * 3);
+    for(u32 i = 0; i != index_count; i += 3) {
+        const u32* tri = mesh.indices.data() + i;
+
+        u32 new_vertices = 0;
+        for(u32 k = 0; k != 3; ++k) {
+            DEBUG_ASSERT(tri[k] < vertex_tags.size());
+            new_vertices += vertex_tags[tri[k]] != tag;
+        }
+
+        if(vertex_count + new_vertices > max_vertices || triangle_count == max_triangles) {
+            meshlets.push_back(compute_meshlet_bounds(mesh, first_index, triangle_count));
+            first_index = i;
+            vertex_count = 0;
+            triangle_count = 0;
+            ++tag;
+        }
+
+        for(u32 k = 0; k != 3; ++k) {
+            if(vertex_tags[tri[k]] != tag) {
+                vertex_tags[tri[k]] = tag;
+                ++vertex_count;
+            }
+        }
+        ++triangle_count;
+    }
+
+    if(triangle_count) {
+        meshlets.push_back(compute_meshlet_bounds(mesh, first_index, triangle_count));
+    }
+
+    return meshlets;
+}
+
+
+// Sum of weighted squared distances to a set of planes
+struct Quadric {
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+    double weight = 0.0;
+
+    // Plane of points p such that dot(normal, p) + d == 0
+    static Quadric from_plane(const glm::dvec3& normal, double d, double weight) {
+        Quadric q;
+        q.a00 = weight * normal.x * normal.x;
+        q.a01 = weight * normal.x * normal.y;
+        q.a02 = weight * normal.x * normal.z;
+        q.a11 = weight * normal.y * normal.y;
+        q.a12 = weight * normal.y * normal.z;
+        q.a22 = weight * normal.z * normal.z;
+        q.b0 = weight * normal.x * d;
+        q.b1 = weight * normal.y * d;
+        q.b2 = weight * normal.z * d;
+        q.c = weight * d * d;
+        q.weight = weight;
+        return q;
+    }
+
+    Quadric& operator+=(const Quadric& other) {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02;
+        a11 += other.a11; a12 += other.a12; a22 += other.a22;
+        b0 += other.b0; b1 += other.b1; b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+        return *this;
+    }
+
+    // Weighted mean of the squared distances between p and the planes
+    double error(const glm::dvec3& p) const {
+        const double e = p.x * (a00 * p.x + 2.0 * (a01 * p.y + a02 * p.z + b0))
+                       + p.y * (a11 * p.y + 2.0 * (a12 * p.z + b1))
+                       + p.z * (a22 * p.z + 2.0 * b2)
+                       + c;
+        return weight > 0.0 ? std::abs(e) / weight : 0.0;
+    }
+};
+
+std::vector<u32> simplify(const MeshData& mesh, Span<const u32> source_indices, size_t target_index_count, float* out_error) {
+    // Border planes are weighted by squared edge length, on top of face planes weighted by area
+    constexpr double border_weight = 10.0;
+    // Collapses that rotate a triangle's normal by more than ~75 degrees are rejected
+    constexpr double max_normal_rotation_cos = 0.25;
+
+    const size_t vertex_count = mesh.vertices.size();
+    std::vector<u32> indices(source_indices.begin(), source_indices.begin() + source_indices.size() / 3 * 3);
+
+    auto position = [&](u32 vertex) { return glm::dvec3(mesh.vertices[vertex].position); };
+
+    // Vertices split along UV seams or hard edges (wedges) share a position, identified by the first such vertex.
+    // Wedges of a position are linked in a circular list
+    std::vector<u32> position_ids(vertex_count);
+    std::vector<u32> next_wedge(vertex_count);
+    {
+        auto position_bytes = [&](u32 index) {
+            return std::string_view(reinterpret_cast<const char*>(&mesh.vertices[index].position), sizeof(glm::vec3));
+        };
+        auto hash = [&](u32 index) { return std::hash<std::string_view>()(position_bytes(index)); };
+        auto equal = [&](u32 a, u32 b) { return position_bytes(a) == position_bytes(b); };
+        std::unordered_map<u32, u32, decltype(hash), decltype(equal)> unique(vertex_count, hash, equal);
+
+        for(u32 i = 0; i != vertex_count; ++i) {
+            const u32 id = unique.try_emplace(i, i).first->second;
+            position_ids[i] = id;
+            next_wedge[i] = i;
+            if(id != i) {
+                next_wedge[i] = next_wedge[id];
+                next_wedge[id] = i;
+            }
+        }
+    }
+
+    auto edge_key = [](u32 a, u32 b) {
+        return a < b ? (u64(a) << 32) | b : (u64(b) << 32) | a;
+    };
+
+    struct Collapse {
+        u32 from;
+        u32 to;
+        double cost;
+    };
+
+    std::unordered_map<u64, u32> edge_use;
+    std::vector<Quadric> quadrics;
+    std::vector<bool> border;
+    std::vector<bool> locked;
+    std::vector<bool> dead;
+    std::vector<u32> offsets;
+    std::vector<u32> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<std::pair<u32, u32>> wedge_targets;
+
+    double max_error = 0.0;
+
+    // Every pass collapses the cheapest edges whose endpoints haven't been touched yet in the pass
+    while(indices.size() > target_index_count) {
+        const size_t triangle_count = indices.size() / 3;
+        auto position_id = [&](size_t tri, u32 k) { return position_ids[indices[tri * 3 + k]]; };
+
+        // Edges used by a single triangle are on the border
+        edge_use.clear();
+        for(size_t t = 0; t != triangle_count; ++t) {
+            for(u32 k = 0; k != 3; ++k) {
+                ++edge_use[edge_key(position_id(t, k), position_id(t, (k + 1) % 3))];
+            }
+        }
+
+        quadrics.assign(vertex_count, Quadric());
+        border.assign(vertex_count, false);
+        for(size_t t = 0; t != triangle_count; ++t) {
+            const glm::dvec3 p[] = {position(indices[t * 3 + 0]), position(indices[t * 3 + 1]), position(indices[t * 3 + 2])};
+            glm::dvec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+            const double area = glm::length(normal) * 0.5;
+            if(!(area > 0.0)) {
+                continue;
+            }
+            normal /= area * 2.0;
+
+            const Quadric face = Quadric::from_plane(normal, -glm::dot(normal, p[0]), area);
+            for(u32 k = 0; k != 3; ++k) {
+                quadrics[position_id(t, k)] += face;
+            }
+
+            for(u32 k = 0; k != 3; ++k) {
+                const u32 a = position_id(t, k);
+                const u32 b = position_id(t, (k + 1) % 3);
+                if(edge_use[edge_key(a, b)] != 1) {
+                    continue;
+                }
+
+                // Plane containing the edge, orthogonal to the face, to keep the border in place
+                border[a] = border[b] = true;
+                const glm::dvec3 edge = p[(k + 1) % 3] - p[k];
+                const glm::dvec3 edge_normal = glm::normalize(glm::cross(edge, normal));
+                const Quadric plane = Quadric::from_plane(edge_normal, -glm::dot(edge_normal, p[k]), glm::dot(edge, edge) * border_weight);
+                quadrics[a] += plane;
+                quadrics[b] += plane;
+            }
+        }
+
+        // Vertex to triangle adjacency
+        offsets.assign(vertex_count + 1, 0);
+        for(const u32 index : indices) {
+            ++offsets[index + 1];
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        adjacency.resize(indices.size());
+        {
+            std::vector<u32> fill(offsets.begin(), offsets.end() - 1);
+            for(size_t i = 0; i != indices.size(); ++i) {
+                adjacency[fill[indices[i]]++] = u32(i / 3);
+            }
+        }
+
+        // Border vertices can only slide along the border and non-manifold edges are left alone
+        collapses.clear();
+        for(size_t t = 0; t != triangle_count; ++t) {
+            for(u32 k = 0; k != 3; ++k) {
+                const u32 a = position_id(t, k);
+                const u32 b = position_id(t, (k + 1) % 3);
+                const u32 use = a == b ? 0 : edge_use[edge_key(a, b)];
+                if(use == 0 || use > 2) {
+                    continue;
+                }
+                if(!border[a] || use == 1) {
+                    collapses.push_back({a, b, quadrics[a].error(position(b))});
+                }
+                if(!border[b] || use == 1) {
+                    collapses.push_back({b, a, quadrics[b].error(position(a))});
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+        locked.assign(vertex_count, false);
+        dead.assign(triangle_count, false);
+        size_t live_index_count = indices.size();
+        size_t collapsed = 0;
+
+        for(const Collapse& collapse : collapses) {
+            if(live_index_count <= target_index_count) {
+                break;
+            }
+            if(locked[collapse.from] || locked[collapse.to]) {
+                continue;
+            }
+
+            auto live_triangles = [&](u32 vertex) {
+                return Span<const u32>(adjacency.data() + offsets[vertex], offsets[vertex + 1] - offsets[vertex]);
+            };
+
+            // Every wedge of the collapsed position moves onto the wedge of the target it shares an edge with
+            bool valid = true;
+            wedge_targets.clear();
+            u32 wedge = collapse.from;
+            do {
+                bool used = false;
+                u32 target = u32(-1);
+                for(const u32 tri : live_triangles(wedge)) {
+                    if(dead[tri]) {
+                        continue;
+                    }
+                    used = true;
+                    for(u32 k = 0; k != 3; ++k) {
+                        if(position_id(tri, k) == collapse.to) {
+                            target = indices[tri * 3 + k];
+                        }
+                    }
+                }
+
+                if(used) {
+                    valid = valid && target != u32(-1);
+                    wedge_targets.emplace_back(wedge, target);
+                }
+                wedge = next_wedge[wedge];
+            } while(valid && wedge != collapse.from);
+
+            // Reject collapses that fold triangles over
+            const glm::dvec3 target_position = position(collapse.to);
+            for(size_t w = 0; valid && w != wedge_targets.size(); ++w) {
+                for(const u32 tri : live_triangles(wedge_targets[w].first)) {
+                    if(dead[tri] || position_id(tri, 0) == collapse.to || position_id(tri, 1) == collapse.to || position_id(tri, 2) == collapse.to) {
+                        continue;
+                    }
+
+                    glm::dvec3 p[] = {position(indices[tri * 3 + 0]), position(indices[tri * 3 + 1]), position(indices[tri * 3 + 2])};
+                    const glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    for(u32 k = 0; k != 3; ++k) {
+                        if(position_id(tri, k) == collapse.from) {
+                            p[k] = target_position;
+                        }
+                    }
+                    const glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                    if(glm::dot(before, after) <= max_normal_rotation_cos * glm::length(before) * glm::length(after)) {
+                        valid = false;
+                        break;
+                    }
+                }
+            }
+
+            if(!valid) {
+                continue;
+            }
+
+            for(const auto& [from, to] : wedge_targets) {
+                for(const u32 tri : live_triangles(from)) {
+                    if(dead[tri]) {
+                        continue;
+                    }
+                    for(u32 k = 0; k != 3; ++k) {
+                        if(indices[tri * 3 + k] == from) {
+                            indices[tri * 3 + k] = to;
+                        }
+                    }
+                    if(position_id(tri, 0) == position_id(tri, 1) || position_id(tri, 1) == position_id(tri, 2) || position_id(tri, 2) == position_id(tri, 0)) {
+                        dead[tri] = true;
+                        live_index_count -= 3;
+                    }
+                }
+            }
+
+            locked[collapse.from] = locked[collapse.to] = true;
+            max_error = std::max(max_error, collapse.cost);
+            ++collapsed;
+        }
+
+        if(!collapsed) {
+            break;
+        }
+
+        size_t write = 0;
+        for(size_t t = 0; t != triangle_count; ++t) {
+            if(!dead[t]) {
+                std::copy_n(indices.begin() + t * 3, 3, indices.begin() + write);
+                write += 3;
+            }
+        }
+        indices.resize(write);
+    }
+
+    if(out_error) {
+        *out_error = float(std::sqrt(max_error));
+    }
+
+    return indices;
+}
+
+std::vector<MeshLod> build_lods(MeshData& mesh, u32 max_lods) {
+    // Levels are not worth it for tiny meshes, or when the simplifier gets stuck on a topology it can't reduce
+    constexpr size_t min_triangle_count = 64;
+    constexpr double min_reduction = 0.85;
+
+    std::vector<MeshLod> lods;
+    std::vector<u32> previous(mesh.indices.begin(), mesh.indices.begin() + mesh.indices.size() / 3 * 3);
+    lods.push_back({0, u32(previous.size()), 0.0f});
+
+    float error = 0.0f;
+    while(lods.size() < max_lods && previous.size() / 3 >= min_triangle_count) {
+        float lod_error = 0.0f;
+        std::vector<u32> lod = simplify(mesh, previous, previous.size() / 6 * 3, &lod_error);
+        if(lod.empty() || double(lod.size()) > double(previous.size()) * min_reduction) {
+            break;
+        }
+
+        optimize_vertex_cache(lod, mesh.vertices.size());
+
+        // Each level is simplified from the previous one, summing the errors of every pass estimates the error relative to
+        // the original mesh. It is not a bound: the quadrics of a pass only measure the distance to the level it simplifies
+        error += lod_error;
+        lods.push_back({u32(mesh.indices.size()), u32(lod.size()), error});
+        mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+        previous = std::move(lod);
+    }
+
+    return lods;
+}
+
+}
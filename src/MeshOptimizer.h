@@ -0,0 +1,66 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <StaticMesh.h>
+
+#include <vector>
+
+namespace OM3D {
+
+// Result of a FIFO post-transform vertex cache simulation
+struct VertexCacheStats {
+    size_t triangles = 0;
+    size_t vertices = 0;
+    size_t transforms = 0;
+
+    // Average cache miss ratio: transformed vertices per triangle, 0.5 is the best case for a regular grid
+    double acmr() const;
+    // Average transform to vertex ratio: 1.0 means every vertex is transformed exactly once
+    double atvr() const;
+
+    VertexCacheStats& operator+=(const VertexCacheStats& other);
+};
+
+struct MeshOptimizationStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    size_t welded_vertices = 0;
+};
+
+VertexCacheStats analyze_vertex_cache(Span<const u32> indices, size_t vertex_count, u32 cache_size = 16);
+
+// Merges bit identical vertices, returns the number of removed vertices
+size_t weld_vertices(MeshData& mesh);
+
+// Reorders triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007)
+void optimize_vertex_cache(MeshData& mesh, u32 cache_size = 16);
+void optimize_vertex_cache(std::vector<u32>& indices, size_t vertex_count, u32 cache_size = 16);
+
+// Splits the triangle stream into clusters that don't degrade the ACMR by more than threshold
+// and sorts them so that outward facing clusters are drawn first. Must run after optimize_vertex_cache
+void optimize_overdraw(MeshData& mesh, float threshold = 1.05f, u32 cache_size = 16);
+
+// Reorders vertices by first use and drops unreferenced ones
+void optimize_vertex_fetch(MeshData& mesh);
+
+// Runs every pass above, in order
+MeshOptimizationStats optimize_mesh(MeshData& mesh);
+
+// Splits the index buffer into consecutive runs of triangles referencing at most max_vertices unique vertices,
+// and computes their bounding sphere and normal cone. Works best on meshes optimized for the vertex cache.
+// Indices must be in range, they are validated when decoding the mesh
+std::vector<shader::Meshlet> build_meshlets(const MeshData& mesh, u32 max_vertices = 64, u32 max_triangles = 124);
+
+// Simplifies the given triangles of the mesh down to about target_index_count indices using quadric error metrics
+// (Garland and Heckbert 1997). Edges are collapsed onto existing vertices so the result indexes the same vertex buffer.
+// UV seams and hard edges are only collapsed along their length and open borders never move inward.
+// Writes the square root of the largest collapse cost to out_error, an estimate of the distance to the input triangles in mesh units
+std::vector<u32> simplify(const MeshData& mesh, Span<const u32> indices, size_t target_index_count, float* out_error = nullptr);
+
+// Appends successively simplified levels, each with about half the triangles of the previous one, after the mesh's indices.
+// The first returned level is the original mesh. Must run after build_meshlets since meshlets only cover the first level
+std::vector<MeshLod> build_lods(MeshData& mesh, u32 max_lods = max_lod_count);
+
+}
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,116 @@
+#include "MeshletCuller.h"
+
+#include <FrameAllocator.h>
+
+#include <glad/gl.h>
+
+#include <algorithm>
+
+namespace OM3D {
+
+MeshletCuller::MeshletCuller() : _program(Program::from_file("meshlet_cull.comp")) {
+    const shader::MeshletCullingStats zero = {};
+    for(auto& buffer : _stats_buffers) {
+        buffer = TypedBuffer<shader::MeshletCullingStats>(&zero, 1);
+    }
+}
+
+void MeshletCuller::cull(Span<const SceneObject> objects, Span<const u32> object_lods) {
+    DEBUG_ASSERT(object_lods.size() == objects.size());
+
+    // Collect the results of the frame that last used this stats buffer
+    const u32 stats_index = u32(_frame++ % stats_latency);
+    if(_frame > stats_latency) {
+        auto mapping = _stats_buffers[stats_index].map(AccessType::ReadWrite);
+        MeshletCullingStats& stats = _pending_stats[stats_index];
+        stats.frustum_culled = mapping[0].frustum_culled;
+        stats.backface_culled = mapping[0].backface_culled;
+        stats.visible_meshlets = mapping[0].visible_meshlets;
+        stats.visible_triangles = mapping[0].visible_triangles;
+        _stats = stats;
+        mapping[0] = {};
+    }
+
+    MeshletCullingStats& stats = _pending_stats[stats_index];
+    stats = {};
+
+    _command_indices.assign(objects.size(), -1);
+    std::vector<shader::DrawElementsIndirectCommand> commands;
+    u32 index_count = 0;
+    for(size_t i = 0; i != objects.size(); ++i) {
+        const StaticMesh* mesh = objects[i].mesh();
+        if(!mesh || !mesh->meshlet_count() || object_lods[i]) {
+            continue;
+        }
+
+        _command_indices[i] = i32(commands.size());
+        commands.push_back({0, 1, index_count, i32(mesh->base_vertex()), 0});
+        index_count += mesh->index_count();
+
+        ++stats.objects;
+        stats.meshlets += mesh->meshlet_count();
+        stats.triangles += mesh->index_count() / 3;
+    }
+
+    if(commands.empty()) {
+        return;
+    }
+
+    // Buffers only ever grow, commands are rebuilt every frame with their counts reset
+    if(!_indices || _indices->byte_size() < index_count * sizeof(u32)) {
+        _indices = std::make_unique<ByteBuffer>(nullptr, index_count * sizeof(u32));
+    }
+    if(!_commands || _commands->byte_size() < commands.size() * sizeof(shader::DrawElementsIndirectCommand)) {
+        _commands = std::make_unique<ByteBuffer>(nullptr, commands.size() * sizeof(shader::DrawElementsIndirectCommand));
+    }
+    {
+        auto staging = frame_allocator().allocate<shader::DrawElementsIndirectCommand>(commands.size());
+        std::copy(commands.begin(), commands.end(), &staging[0]);
+        staging.copy_to(*_commands);
+    }
+
+    _program->bind();
+    _indices->bind(BufferUsage::Storage, 3);
+    _commands->bind(BufferUsage::Storage, 4);
+    _stats_buffers[stats_index].bind(BufferUsage::Storage, 5);
+
+    for(size_t i = 0; i != objects.size(); ++i) {
+        if(_command_indices[i] < 0) {
+            continue;
+        }
+
+        const SceneObject& object = objects[i];
+        const StaticMesh* mesh = object.mesh();
+        mesh->bind_meshlets(1, 2);
+
+        _program->set_uniform(HASH("model"), object.transform());
+        _program->set_uniform(HASH("meshlet_count"), mesh->meshlet_count());
+        _program->set_uniform(HASH("short_indices"), u32(mesh->has_short_indices()));
+        _program->set_uniform(HASH("source_offset"), mesh->first_index());
+        _program->set_uniform(HASH("command_index"), u32(_command_indices[i]));
+        _program->set_uniform(HASH("output_offset"), commands[_command_indices[i]].first_index);
+        _program->set_uniform(HASH("backface_culling"), u32(!object.material().is_double_sided()));
+
+        glDispatchCompute(std::min(mesh->meshlet_count(), 65535u), 1, 1);
+    }
+
+    glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+bool MeshletCuller::has_culled(size_t object_index) const {
+    return object_index < _command_indices.size() && _command_indices[object_index] >= 0;
+}
+
+void MeshletCuller::draw(const SceneObject& object, size_t object_index, u32 lod) const {
+    if(has_culled(object_index)) {
+        object.draw_indirect(*_indices, *_commands, _command_indices[object_index]);
+    } else {
+        object.draw(lod);
+    }
+}
+
+const MeshletCullingStats& MeshletCuller::stats() const {
+    return _stats;
+}
+
+}
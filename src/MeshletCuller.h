@@ -0,0 +1,63 @@
+#ifndef MESHLETCULLER_H
+#define MESHLETCULLER_H
+
+#include <SceneObject.h>
+#include <TypedBuffer.h>
+#include <Program.h>
+
+#include <shader_structs.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace OM3D {
+
+struct MeshletCullingStats {
+    u32 objects = 0;
+    u32 meshlets = 0;
+    u32 triangles = 0;
+
+    u32 frustum_culled = 0;
+    u32 backface_culled = 0;
+    u32 visible_meshlets = 0;
+    u32 visible_triangles = 0;
+};
+
+// Culls the meshlets of every object against the camera frustum and their normal cone in a compute pass,
+// then compacts the indices of the surviving triangles so each object is drawn with a single indirect draw.
+class MeshletCuller : NonMovable {
+    public:
+        MeshletCuller();
+
+        // The frame data must be bound. Objects without meshlets or drawn at a coarser level of detail are left untouched
+        void cull(Span<const SceneObject> objects, Span<const u32> object_lods);
+
+        // True if the object's meshlets were culled this frame, its surviving triangles can only be drawn by draw
+        bool has_culled(size_t object_index) const;
+
+        // Draws what survived culling, or the whole object at the given level of detail if it wasn't culled.
+        // The object must be bound
+        void draw(const SceneObject& object, size_t object_index, u32 lod) const;
+
+        // Stats are read back a few frames late to avoid stalling
+        const MeshletCullingStats& stats() const;
+
+    private:
+        static constexpr u32 stats_latency = 3;
+
+        std::shared_ptr<Program> _program;
+
+        std::unique_ptr<ByteBuffer> _indices;
+        std::unique_ptr<ByteBuffer> _commands;
+        std::vector<i32> _command_indices;
+
+        std::array<TypedBuffer<shader::MeshletCullingStats>, stats_latency> _stats_buffers;
+        std::array<MeshletCullingStats, stats_latency> _pending_stats;
+        MeshletCullingStats _stats;
+        u64 _frame = 0;
+};
+
+}
+
+#endif // MESHLETCULLER_H
@@ -0,0 +1,272 @@
+#include "ObjectCuller.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <array>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OM3D_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace OM3D {
+
+ObjectCuller::ObjectCuller() : _program(Program::from_file("object_cull.comp")) {
+    const shader::ObjectCullingStats zero = {};
+    for(auto& buffer : _stats_buffers) {
+        buffer = TypedBuffer<shader::ObjectCullingStats>(&zero, 1);
+    }
+}
+
+void ObjectCuller::add(const BoundingSphere& world_sphere) {
+    _center_x.push_back(world_sphere.center.x);
+    _center_y.push_back(world_sphere.center.y);
+    _center_z.push_back(world_sphere.center.z);
+    _radius.push_back(world_sphere.radius);
+    _visible.push_back(1);
+    ++_count;
+
+    _spheres = nullptr;
+}
+
+void ObjectCuller::update(size_t index, const BoundingSphere& world_sphere) {
+    DEBUG_ASSERT(index < _count);
+    _center_x[index] = world_sphere.center.x;
+    _center_y[index] = world_sphere.center.y;
+    _center_z[index] = world_sphere.center.z;
+    _radius[index] = world_sphere.radius;
+
+    _spheres = nullptr;
+}
+
+void ObjectCuller::cull(const Camera& camera, float min_screen_size, Span<const u32> candidates) {
+    _stats = {};
+    _stats.objects = u32(_count);
+
+    if(camera.is_orthographic()) {
+        std::fill(_visible.begin(), _visible.end(), u8(1));
+        _stats.visible = _stats.objects;
+        return;
+    }
+
+    // Objects that aren't candidates are outside of the frustum
+    std::fill(_visible.begin(), _visible.end(), u8(0));
+    _stats.frustum_culled = _stats.objects - u32(candidates.size());
+
+    const Frustum frustum = camera.build_frustum();
+    // Near first, its distance is the view depth used for small object culling
+    const std::array<glm::vec3, 5> normals = {
+        frustum._near_normal,
+        frustum._top_normal,
+        frustum._bottom_normal,
+        frustum._right_normal,
+        frustum._left_normal,
+    };
+    const glm::vec3 position = camera.position();
+
+    // A sphere at depth d covers radius * cot(fov / 2) / d of the viewport height
+    const float proj_scale = camera.projection_matrix()[1][1];
+
+    for(size_t first = 0; first < candidates.size(); first += 4) {
+        const size_t lanes = std::min(size_t(4), candidates.size() - first);
+
+        // Missing lanes repeat the last candidate, their results are ignored
+        std::array<u32, 4> indices;
+        for(size_t lane = 0; lane != 4; ++lane) {
+            indices[lane] = candidates[first + std::min(lane, lanes - 1)];
+        }
+
+        int inside_mask = 0;
+        int small_mask = 0;
+
+#ifdef OM3D_SSE2
+        {
+            auto gather = [&](const std::vector<float>& v) {
+                return _mm_set_ps(v[indices[3]], v[indices[2]], v[indices[1]], v[indices[0]]);
+            };
+
+            const __m128 x = _mm_sub_ps(gather(_center_x), _mm_set1_ps(position.x));
+            const __m128 y = _mm_sub_ps(gather(_center_y), _mm_set1_ps(position.y));
+            const __m128 z = _mm_sub_ps(gather(_center_z), _mm_set1_ps(position.z));
+            const __m128 radius = gather(_radius);
+            const __m128 neg_radius = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            __m128 depth = _mm_setzero_ps();
+            for(size_t i = 0; i != normals.size(); ++i) {
+                const __m128 dist = _mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(x, _mm_set1_ps(normals[i].x)),
+                    _mm_mul_ps(y, _mm_set1_ps(normals[i].y))),
+                    _mm_mul_ps(z, _mm_set1_ps(normals[i].z)));
+                inside = _mm_and_ps(inside, _mm_cmpgt_ps(dist, neg_radius));
+                if(i == 0) {
+                    depth = dist;
+                }
+            }
+
+            const __m128 small = _mm_cmplt_ps(_mm_mul_ps(radius, _mm_set1_ps(proj_scale)), _mm_mul_ps(depth, _mm_set1_ps(min_screen_size)));
+            inside_mask = _mm_movemask_ps(inside);
+            small_mask = _mm_movemask_ps(_mm_and_ps(inside, small));
+        }
+#else
+        for(size_t lane = 0; lane != 4; ++lane) {
+            const u32 index = indices[lane];
+            const glm::vec3 v = glm::vec3(_center_x[index], _center_y[index], _center_z[index]) - position;
+            const float radius = _radius[index];
+
+            bool inside = true;
+            for(const glm::vec3& normal : normals) {
+                inside &= glm::dot(v, normal) > -radius;
+            }
+
+            const float depth = glm::dot(v, normals[0]);
+            inside_mask |= int(inside) << lane;
+            small_mask |= int(inside && radius * proj_scale < depth * min_screen_size) << lane;
+        }
+#endif
+
+        for(size_t lane = 0; lane != lanes; ++lane) {
+            const bool inside = (inside_mask >> lane) & 1;
+            const bool small = (small_mask >> lane) & 1;
+            _visible[indices[lane]] = u8(inside && !small);
+
+            _stats.frustum_culled += u32(!inside);
+            _stats.small_culled += u32(small);
+        }
+    }
+
+    _stats.visible = _stats.objects - _stats.frustum_culled - _stats.small_culled;
+}
+
+bool ObjectCuller::is_visible(size_t index) const {
+    DEBUG_ASSERT(index < _count);
+    return _visible[index];
+}
+
+void ObjectCuller::cull_gpu(const Camera& camera, float min_screen_size, u32 instance_count,
+                            const TypedFrameAllocation<shader::CullItem>& items,
+                            const TypedFrameAllocation<glm::mat4>& source_instances,
+                            const TypedFrameAllocation<shader::DrawData>& draw_data,
+                            const TypedFrameAllocation<shader::DrawElementsIndirectCommand>& commands,
+                            const DepthPyramid* occluders) {
+
+    // Collect the results of the frame that last used this stats buffer
+    _stats_index = u32(_frame++ % stats_latency);
+    if(_frame > stats_latency) {
+        auto mapping = _stats_buffers[_stats_index].map(AccessType::ReadWrite);
+        _stats.objects = _pending_instances[_stats_index];
+        _stats.frustum_culled = mapping[0].frustum_culled;
+        _stats.small_culled = mapping[0].small_culled;
+        _stats.visible = mapping[0].visible;
+        _stats.occluded = mapping[0].occluded;
+        mapping[0] = {};
+    }
+    _pending_instances[_stats_index] = instance_count;
+
+    if(!instance_count) {
+        return;
+    }
+
+    if(!_spheres) {
+        std::vector<glm::vec4> spheres(std::max(_count, size_t(1)));
+        for(size_t i = 0; i != _count; ++i) {
+            spheres[i] = glm::vec4(_center_x[i], _center_y[i], _center_z[i], _radius[i]);
+        }
+        _spheres = std::make_unique<TypedBuffer<glm::vec4>>(spheres.data(), spheres.size());
+    }
+
+    // Buffers only ever grow, instance counts are rebuilt from 0 in the copies of the commands
+    for(auto& buffer : _commands) {
+        if(!buffer || buffer->byte_size() < commands.byte_size) {
+            buffer = std::make_unique<ByteBuffer>(nullptr, commands.byte_size);
+        }
+        commands.copy_to(*buffer);
+    }
+    for(auto& buffer : _instances) {
+        if(!buffer || buffer->byte_size() < source_instances.byte_size) {
+            buffer = std::make_unique<ByteBuffer>(nullptr, source_instances.byte_size);
+        }
+    }
+
+    // Nothing to retest until the first phase finds occluded instances
+    const size_t retest_size = sizeof(shader::OcclusionRetest) + instance_count * sizeof(u32);
+    if(!_retest || _retest->byte_size() < retest_size) {
+        _retest = std::make_unique<ByteBuffer>(nullptr, retest_size);
+    }
+    {
+        auto args = frame_allocator().allocate<shader::OcclusionRetest>();
+        args[0] = {0, 1, 1, 0};
+        args.copy_to(*_retest);
+    }
+
+    _program->bind();
+    _program->set_uniform(HASH("instance_count"), instance_count);
+    _program->set_uniform(HASH("frustum_culling"), u32(!camera.is_orthographic()));
+    _program->set_uniform(HASH("proj_scale"), camera.projection_matrix()[1][1]);
+    _program->set_uniform(HASH("min_screen_size"), min_screen_size);
+
+    dispatch(items, source_instances, draw_data, occluders, false);
+}
+
+void ObjectCuller::retest_gpu(const DepthPyramid& occluders,
+                              const TypedFrameAllocation<shader::CullItem>& items,
+                              const TypedFrameAllocation<glm::mat4>& source_instances,
+                              const TypedFrameAllocation<shader::DrawData>& draw_data) {
+
+    if(!_pending_instances[_stats_index]) {
+        return;
+    }
+
+    _program->bind();
+    dispatch(items, source_instances, draw_data, &occluders, true);
+}
+
+void ObjectCuller::dispatch(const TypedFrameAllocation<shader::CullItem>& items,
+                            const TypedFrameAllocation<glm::mat4>& source_instances,
+                            const TypedFrameAllocation<shader::DrawData>& draw_data,
+                            const DepthPyramid* occluders, bool retest) {
+
+    const bool occlusion_culling = occluders && occluders->is_valid();
+    _program->set_uniform(HASH("retest"), u32(retest));
+    _program->set_uniform(HASH("occlusion_culling"), u32(occlusion_culling));
+    if(occlusion_culling) {
+        _program->set_uniform(HASH("occluder_view_proj"), occluders->view_proj());
+        _program->set_uniform(HASH("occluder_depth_size"), glm::vec2(occluders->depth_size()));
+        occluders->texture().bind(6);
+    }
+
+    items.bind(BufferUsage::Storage, 1);
+    _spheres->bind(BufferUsage::Storage, 2);
+    draw_data.bind(BufferUsage::Storage, 3);
+    _commands[retest]->bind(BufferUsage::Storage, 4);
+    source_instances.bind(BufferUsage::Storage, 5);
+    _instances[retest]->bind(BufferUsage::Storage, 6);
+    _stats_buffers[_stats_index].bind(BufferUsage::Storage, 7);
+    _retest->bind(BufferUsage::Storage, 8);
+
+    if(retest) {
+        _retest->bind(BufferUsage::DispatchIndirect);
+        glDispatchComputeIndirect(0);
+    } else {
+        glDispatchCompute((_pending_instances[_stats_index] + 63) / 64, 1, 1);
+    }
+
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+const ByteBuffer& ObjectCuller::command_buffer(bool retested) const {
+    DEBUG_ASSERT(_commands[retested]);
+    return *_commands[retested];
+}
+
+const ByteBuffer& ObjectCuller::instance_buffer(bool retested) const {
+    DEBUG_ASSERT(_instances[retested]);
+    return *_instances[retested];
+}
+
+const ObjectCullingStats& ObjectCuller::stats() const {
+    return _stats;
+}
+
+}
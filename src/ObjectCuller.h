@@ -0,0 +1,104 @@
+#ifndef OBJECTCULLER_H
+#define OBJECTCULLER_H
+
+#include <StaticMesh.h>
+#include <Camera.h>
+#include <FrameAllocator.h>
+#include <TypedBuffer.h>
+#include <Program.h>
+#include <DepthPyramid.h>
+
+#include <shader_structs.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace OM3D {
+
+struct ObjectCullingStats {
+    u32 objects = 0;
+    u32 frustum_culled = 0;
+    u32 small_culled = 0;
+    u32 visible = 0;
+    u32 occluded = 0;
+};
+
+// Culls whole objects by testing their world space bounding spheres against the camera frustum.
+// On the CPU, spheres are stored as a structure of arrays so the candidates of a coarser test (like a BVH) can be tested 4 at a time with SSE.
+// On the GPU, a compute pass rebuilds the instance counts of indirect draws from the visible instances, without any readback.
+// It can also cull instances hidden behind the depth pyramid of the previous frame, those are tested again by retest_gpu
+// against the pyramid of the current frame, once what was found visible has been drawn, so nothing pops in a frame late.
+class ObjectCuller : NonMovable {
+    public:
+        ObjectCuller();
+
+        void add(const BoundingSphere& world_sphere);
+        void update(size_t index, const BoundingSphere& world_sphere);
+
+        // Only candidates are tested, every other object is considered outside of the frustum.
+        // Objects whose bounding sphere covers less than min_screen_size (as a fraction of the viewport height) are also culled.
+        // The frustum has planes through the camera position, so nothing is culled with an orthographic camera
+        void cull(const Camera& camera, float min_screen_size, Span<const u32> candidates);
+
+        bool is_visible(size_t index) const;
+
+        // The frame data must be bound. items holds the instance_count instances to test and source_instances their model matrices.
+        // commands are copied to command_buffer() where the instance count of each draw, which must be 0, only counts its visible instances.
+        // Their model matrices are compacted in instance_buffer(), starting at the draw's first instance.
+        // With occluders, instances allowed to be occluded are also tested against them and kept for retest_gpu if hidden
+        void cull_gpu(const Camera& camera, float min_screen_size, u32 instance_count,
+                      const TypedFrameAllocation<shader::CullItem>& items,
+                      const TypedFrameAllocation<glm::mat4>& source_instances,
+                      const TypedFrameAllocation<shader::DrawData>& draw_data,
+                      const TypedFrameAllocation<shader::DrawElementsIndirectCommand>& commands,
+                      const DepthPyramid* occluders = nullptr);
+
+        // Tests the instances cull_gpu found occluded against occluders, with the same buffers.
+        // Those still visible are drawn with command_buffer(true) and instance_buffer(true)
+        void retest_gpu(const DepthPyramid& occluders,
+                        const TypedFrameAllocation<shader::CullItem>& items,
+                        const TypedFrameAllocation<glm::mat4>& source_instances,
+                        const TypedFrameAllocation<shader::DrawData>& draw_data);
+
+        const ByteBuffer& command_buffer(bool retested = false) const;
+        const ByteBuffer& instance_buffer(bool retested = false) const;
+
+        // Stats of the GPU path are read back a few frames late to avoid stalling
+        const ObjectCullingStats& stats() const;
+
+    private:
+        static constexpr u32 stats_latency = 3;
+
+        void dispatch(const TypedFrameAllocation<shader::CullItem>& items,
+                      const TypedFrameAllocation<glm::mat4>& source_instances,
+                      const TypedFrameAllocation<shader::DrawData>& draw_data,
+                      const DepthPyramid* occluders, bool retest);
+
+        std::vector<float> _center_x;
+        std::vector<float> _center_y;
+        std::vector<float> _center_z;
+        std::vector<float> _radius;
+        size_t _count = 0;
+
+        std::vector<u8> _visible;
+        ObjectCullingStats _stats;
+
+        std::shared_ptr<Program> _program;
+
+        // Spheres are only uploaded again when objects are added
+        std::unique_ptr<TypedBuffer<glm::vec4>> _spheres;
+        // Indexed by phase: [1] holds what retest_gpu found visible
+        std::array<std::unique_ptr<ByteBuffer>, 2> _commands;
+        std::array<std::unique_ptr<ByteBuffer>, 2> _instances;
+        std::unique_ptr<ByteBuffer> _retest;
+
+        std::array<TypedBuffer<shader::ObjectCullingStats>, stats_latency> _stats_buffers;
+        u32 _stats_index = 0;
+        std::array<u32, stats_latency> _pending_instances = {};
+        u64 _frame = 0;
+};
+
+}
+
+#endif // OBJECTCULLER_H
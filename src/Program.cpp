@@ -1,4 +1,5 @@
 #include "Program.h"
+#include "GLState.h"
 
 #include <glad/gl.h>
 
@@ -170,12 +171,13 @@ void Program::fetch_uniform_locations() {
 
 Program::~Program() {
     if(_handle.is_valid()) {
+        gl_state().forget_program(_handle.get());
         glDeleteProgram(_handle.get());
     }
 }
 
 void Program::bind() const {
-    glUseProgram(_handle.get());
+    gl_state().use_program(_handle.get());
 }
 
 bool Program::is_compute() const {
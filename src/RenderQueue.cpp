@@ -0,0 +1,106 @@
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace OM3D {
+
+static_assert(max_lod_count <= 8, "Levels of detail don't fit in the sort key");
+
+static u64 bits(u32 value, u32 bit_count) {
+    return u64(value) & ((u64(1) << bit_count) - 1);
+}
+
+// Positive floats sort like their bit patterns, keeping the top bits gives a logarithmic quantization
+static u32 depth_bits(float view_depth) {
+    const float depth = std::max(view_depth, 0.0f);
+    u32 b = 0;
+    std::memcpy(&b, &depth, sizeof(b));
+    return b;
+}
+
+void RenderQueue::clear() {
+    _items.clear();
+    _program_ids.clear();
+    _material_ids.clear();
+    _mesh_ids.clear();
+    _materials.clear();
+}
+
+u32 RenderQueue::dense_id(std::unordered_map<const void*, u32>& ids, const void* ptr) {
+    return ids.try_emplace(ptr, u32(ids.size())).first->second;
+}
+
+void RenderQueue::push(RenderPass pass, const SceneObject& object, u32 object_index, u32 lod, float view_depth) {
+    const Material& material = object.material();
+    const u32 program = dense_id(_program_ids, material.program());
+    const u32 mat = dense_id(_material_ids, &material);
+    if(mat == _materials.size()) {
+        _materials.push_back(&material);
+    }
+    const u32 mesh = dense_id(_mesh_ids, object.mesh());
+    const u32 depth = depth_bits(view_depth);
+
+    u64 key = u64(pass) << 62;
+    if(!_sorting) {
+        key |= object_index;
+    } else if(pass == RenderPass::Opaque) {
+        key |= bits(program, 10) << 52;
+        key |= bits(mat, 16) << 36;
+        key |= bits(mesh, 13) << 23;
+        key |= bits(lod, 3) << 20;
+        key |= u64(depth >> 12);
+    } else {
+        key |= u64(~depth) << 30;
+        key |= bits(program, 10) << 20;
+        key |= bits(mat, 20);
+    }
+
+    _items.push_back({key, object_index, mat});
+}
+
+void RenderQueue::set_sorting(bool enabled) {
+    _sorting = enabled;
+}
+
+void RenderQueue::sort() {
+    constexpr u32 digit_count = sizeof(u64);
+
+    std::array<std::array<u32, 256>, digit_count> histograms = {};
+    for(const Item& item : _items) {
+        for(u32 d = 0; d != digit_count; ++d) {
+            ++histograms[d][(item.key >> (d * 8)) & 0xFF];
+        }
+    }
+
+    _scratch.resize(_items.size());
+    for(u32 d = 0; d != digit_count; ++d) {
+        auto& histogram = histograms[d];
+        if(std::find(histogram.begin(), histogram.end(), u32(_items.size())) != histogram.end()) {
+            continue;
+        }
+
+        u32 offset = 0;
+        for(u32& count : histogram) {
+            const u32 c = count;
+            count = offset;
+            offset += c;
+        }
+
+        for(const Item& item : _items) {
+            _scratch[histogram[(item.key >> (d * 8)) & 0xFF]++] = item;
+        }
+        _items.swap(_scratch);
+    }
+}
+
+Span<const RenderQueue::Item> RenderQueue::items() const {
+    return _items;
+}
+
+Span<const Material* const> RenderQueue::materials() const {
+    return _materials;
+}
+
+}
@@ -0,0 +1,62 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <SceneObject.h>
+
+#include <unordered_map>
+#include <vector>
+
+namespace OM3D {
+
+enum class RenderPass : u32 {
+    Opaque,
+    Transparent,
+};
+
+// Orders draws by a 64 bit key:
+//   opaque:      [pass 2][program 10][material 16][mesh 13][lod 3][depth 20]  to group state changes, front to back within a group
+//   transparent: [pass 2][depth 32][program 10][material 20]                  back to front, as blending requires
+// Program, material and mesh ids are assigned in order of first appearance since the last clear.
+// Opaque objects that can be drawn as instances of the same draw (same material, mesh and lod) end up next to each other
+class RenderQueue : NonCopyable {
+    public:
+        struct Item {
+            u64 key = 0;
+            u32 object = 0;
+            u32 material = 0; // Dense id, not truncated like in the key
+        };
+
+        void clear();
+
+        // view_depth is the distance to the camera plane, negative values are clamped to 0
+        void push(RenderPass pass, const SceneObject& object, u32 object_index, u32 lod, float view_depth);
+
+        // When disabled, items are only grouped by pass and keep their insertion order
+        void set_sorting(bool enabled);
+
+        // Radix sort, digits shared by every key are skipped
+        void sort();
+
+        Span<const Item> items() const;
+
+        // Materials indexed by their dense id
+        Span<const Material* const> materials() const;
+
+    private:
+        static u32 dense_id(std::unordered_map<const void*, u32>& ids, const void* ptr);
+
+        std::vector<Item> _items;
+        std::vector<Item> _scratch;
+
+        std::unordered_map<const void*, u32> _program_ids;
+        std::unordered_map<const void*, u32> _material_ids;
+        std::unordered_map<const void*, u32> _mesh_ids;
+
+        std::vector<const Material*> _materials;
+
+        bool _sorting = true;
+};
+
+}
+
+#endif // RENDERQUEUE_H
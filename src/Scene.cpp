@@ -1,20 +1,61 @@
 #include "Scene.h"
 
-#include <TypedBuffer.h>
+#include <FrameAllocator.h>
+#include <GeometryPool.h>
+#include <GLState.h>
+
+#include <TimestampQuery.h>
 
 #include <shader_structs.h>
 
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <limits>
+
 namespace OM3D {
 
+extern bool audit_bindings_before_draw;
+
+// Coarser levels are only picked once their error is comfortably below the threshold, to avoid popping back and forth
+static constexpr float lod_hysteresis = 0.75f;
+
 Scene::Scene() {
     _sky_material.set_program(Program::from_files("sky.frag", "screen.vert"));
     _sky_material.set_depth_test_mode(DepthTestMode::None);
 
+    _deferred_lighting_material.set_program(Program::from_files("deferred.frag", "screen.vert"));
+    _deferred_lighting_material.set_blend_mode(BlendMode::Additive);
+    _deferred_lighting_material.set_depth_test_mode(DepthTestMode::None);
+
+    if(visibility_buffer_supported()) {
+        std::vector<std::string> defines = {"BINDLESS"};
+        if(nonuniform_bindless_handles()) {
+            defines.emplace_back("NONUNIFORM_HANDLES");
+        }
+        if(geometry_pool().has_compact_vertices()) {
+            defines.emplace_back("COMPACT_VERTEX");
+        }
+        _visibility_material.set_program(Program::from_files("visibility.frag", "screen.vert", defines));
+        _visibility_material.set_depth_test_mode(DepthTestMode::None);
+    }
+
     _envmap = std::make_shared<Texture>(Texture::empty_cubemap(4, ImageFormat::RGBA8_UNORM));
+
+    _meshlet_culler = std::make_unique<MeshletCuller>();
+    _depth_pyramid = std::make_unique<DepthPyramid>();
+    _light_clusters = std::make_unique<LightClusters>();
+}
+
+static AABB world_bounds(const SceneObject& object) {
+    const BoundingSphere sphere = object.world_bounding_sphere();
+    return AABB::from_sphere(sphere.center, sphere.radius);
 }
 
 void Scene::add_object(SceneObject obj) {
+    _object_culler.add(obj.world_bounding_sphere());
     _objects.emplace_back(std::move(obj));
+    _bvh_dirty = true;
 }
 
 void Scene::add_light(PointLight obj) {
@@ -29,6 +70,28 @@ Span<const PointLight> Scene::point_lights() const {
     return _point_lights;
 }
 
+void Scene::set_object_transform(size_t index, const glm::mat4& transform) {
+    SceneObject& object = _objects[index];
+    object.set_transform(transform);
+    _object_culler.update(index, object.world_bounding_sphere());
+    if(!_bvh_dirty) {
+        _bvh.update(u32(index), world_bounds(object));
+    }
+}
+
+const BVH& Scene::bvh() const {
+    if(_bvh_dirty) {
+        std::vector<AABB> bounds;
+        bounds.reserve(_objects.size());
+        for(const SceneObject& object : _objects) {
+            bounds.push_back(world_bounds(object));
+        }
+        _bvh.build(bounds);
+        _bvh_dirty = false;
+    }
+    return _bvh;
+}
+
 Camera& Scene::camera() {
     return _camera;
 }
@@ -54,28 +117,181 @@ void Scene::set_sun(float altitude, float azimuth, glm::vec3 color) {
     _sun_color = color;
 }
 
+void Scene::set_meshlet_culling(bool enabled) {
+    _meshlet_culling = enabled;
+}
+
+bool Scene::meshlet_culling() const {
+    return _meshlet_culling;
+}
+
+const MeshletCullingStats& Scene::meshlet_culling_stats() const {
+    return _meshlet_culler->stats();
+}
+
+void Scene::set_lod_max_error(float max_error) {
+    _lod_max_error = max_error;
+}
+
+const LodStats& Scene::lod_stats() const {
+    return _lod_stats;
+}
+
+void Scene::set_draw_sorting(bool enabled) {
+    _draw_sorting = enabled;
+}
+
+const StateChangeStats& Scene::draw_stats() const {
+    return _draw_stats;
+}
+
+void Scene::set_instancing(bool enabled) {
+    _instancing = enabled;
+}
+
+void Scene::set_frustum_culling(bool enabled, float min_screen_size, bool on_gpu) {
+    _frustum_culling = enabled;
+    _min_screen_size = min_screen_size;
+    _gpu_culling = on_gpu;
+}
+
+const ObjectCullingStats& Scene::object_culling_stats() const {
+    return _object_culler.stats();
+}
+
+void Scene::set_clustered_lighting(bool enabled, bool heatmap) {
+    _clustered_lighting = enabled;
+    _light_heatmap = heatmap;
+}
+
+void Scene::set_occlusion_culling(const Texture* depth) {
+    _occlusion_depth = depth;
+}
+
+void Scene::set_depth_prepass(bool enabled) {
+    _depth_prepass = enabled;
+}
+
+void Scene::set_deferred_shading(const GBuffer* gbuffer, const Texture* depth) {
+    _gbuffer = gbuffer;
+    _gbuffer_depth = depth;
+}
+
+void Scene::set_visibility_buffer(const VisibilityBuffer* visibility, const Texture* depth) {
+    _visibility_buffer = visibility;
+    _visibility_depth = depth;
+}
+
+// Submits count consecutive commands of the bound indirect buffer, returns the number of API draw calls
+static u32 multi_draw(Program& program, bool short_indices, size_t command_offset, u32 count) {
+    geometry_pool().bind_vertex_attribs();
+    geometry_pool().bind_index_buffer(short_indices);
+
+    if(audit_bindings_before_draw) {
+        audit_bindings();
+    }
+
+    const GLenum index_type = short_indices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    if(draw_parameters_enabled()) {
+        glMultiDrawElementsIndirect(GL_TRIANGLES, index_type, reinterpret_cast<const void*>(command_offset), GLsizei(count), 0);
+        return 1;
+    }
+
+    // Without gl_DrawIDARB, the draw index is a uniform
+    for(u32 i = 0; i != count; ++i) {
+        program.set_uniform(HASH("draw_id"), i);
+        glDrawElementsIndirect(GL_TRIANGLES, index_type, reinterpret_cast<const void*>(command_offset + i * sizeof(shader::DrawElementsIndirectCommand)));
+    }
+    return count;
+}
+
+// Factor from an error in mesh space to a fraction of the viewport height, for the closest point of the mesh's bounding sphere
+static float projected_error_scale(const Camera& camera, const SceneObject& object) {
+    const glm::mat4& transform = object.transform();
+    const float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+    // Maps view space heights to [-1; 1]: cot(fov / 2) for perspective projections, 2 / height for orthographic ones
+    const float proj_scale = camera.projection_matrix()[1][1] * 0.5f;
+    if(camera.is_orthographic()) {
+        return scale * proj_scale;
+    }
+
+    const BoundingSphere& sphere = object.mesh()->bounding_sphere();
+    const glm::vec3 center = glm::vec3(transform * glm::vec4(sphere.center, 1.0f));
+    const float distance = glm::length(center - camera.position()) - sphere.radius * scale;
+    if(distance <= 0.0f) {
+        return std::numeric_limits<float>::infinity();
+    }
+
+    return scale * proj_scale / distance;
+}
+
+void Scene::select_lods() const {
+    _object_lods.resize(_objects.size(), 0);
+    _lod_stats = {};
+
+    for(size_t i = 0; i != _objects.size(); ++i) {
+        const StaticMesh* mesh = _objects[i].mesh();
+        if(!mesh) {
+            _object_lods[i] = 0;
+            continue;
+        }
+
+        u32 lod = 0;
+        if(_lod_max_error > 0.0f) {
+            const float error_scale = projected_error_scale(_camera, _objects[i]);
+            auto projected_error = [&](u32 level) { return mesh->lod(level).error * error_scale; };
+
+            // Refine as soon as the current level is too coarse, coarsen only past the hysteresis band
+            lod = std::min(_object_lods[i], mesh->lod_count() - 1);
+            while(lod > 0 && projected_error(lod) > _lod_max_error) {
+                --lod;
+            }
+            while(lod + 1 < mesh->lod_count() && projected_error(lod + 1) < _lod_max_error * lod_hysteresis) {
+                ++lod;
+            }
+        }
+
+        _object_lods[i] = lod;
+        _lod_stats.loaded_triangles += mesh->index_count() / 3;
+    }
+}
+
 void Scene::render() const {
     // Fill and bind frame data buffer
-    TypedBuffer<shader::FrameData> buffer(nullptr, 1);
+    auto buffer = frame_allocator().allocate<shader::FrameData>();
     {
-        auto mapping = buffer.map(AccessType::WriteOnly);
-        mapping[0].camera.view_proj = _camera.view_proj_matrix();
-        mapping[0].camera.inv_view_proj = glm::inverse(_camera.view_proj_matrix());
-        mapping[0].camera.position = _camera.position();
-        mapping[0].point_light_count = u32(_point_lights.size());
-        mapping[0].sun_color = _sun_color;
-        mapping[0].sun_dir = glm::normalize(_sun_direction);
-        mapping[0].ibl_intensity = _ibl_intensity;
+        shader::FrameData& frame = buffer[0];
+        frame.camera.view_proj = _camera.view_proj_matrix();
+        frame.camera.inv_view_proj = glm::inverse(_camera.view_proj_matrix());
+        frame.camera.position = _camera.position();
+        {
+            const Frustum frustum = _camera.build_frustum();
+            frame.camera.frustum.near_normal = frustum._near_normal;
+            frame.camera.frustum.top_normal = frustum._top_normal;
+            frame.camera.frustum.bottom_normal = frustum._bottom_normal;
+            frame.camera.frustum.right_normal = frustum._right_normal;
+            frame.camera.frustum.left_normal = frustum._left_normal;
+        }
+        frame.point_light_count = u32(_point_lights.size());
+        frame.sun_color = _sun_color;
+        frame.sun_dir = glm::normalize(_sun_direction);
+        frame.ibl_intensity = _ibl_intensity;
+
+        frame.cluster_grid = glm::uvec3(0);
+        if(_clustered_lighting) {
+            _light_clusters->setup(frame, _camera, gl_state().viewport(), _point_lights);
+        }
+        frame.light_heatmap = u32(_light_heatmap);
     }
     buffer.bind(BufferUsage::Uniform, 0);
 
     // Fill and bind lights buffer
-    TypedBuffer<shader::PointLight> light_buffer(nullptr, std::max(_point_lights.size(), size_t(1)));
+    auto light_buffer = frame_allocator().allocate<shader::PointLight>(std::max(_point_lights.size(), size_t(1)));
     {
-        auto mapping = light_buffer.map(AccessType::WriteOnly);
         for(size_t i = 0; i != _point_lights.size(); ++i) {
             const auto& light = _point_lights[i];
-            mapping[i] = {
+            light_buffer[i] = {
                 light.position(),
                 light.radius(),
                 light.color(),
@@ -83,7 +299,12 @@ void Scene::render() const {
             };
         }
     }
-    light_buffer.bind(BufferUsage::Storage, 1);
+
+    if(_clustered_lighting) {
+        PROFILE_GPU("Light clustering");
+        light_buffer.bind(BufferUsage::Storage, 1);
+        _light_clusters->build(_camera);
+    }
 
     // Bind envmap
     DEBUG_ASSERT(_envmap && !_envmap->is_null());
@@ -97,23 +318,292 @@ void Scene::render() const {
     _sky_material.set_uniform(HASH("intensity"), _ibl_intensity);
     draw_full_screen_triangle();
 
-    // Render every object
+    const bool cpu_culling = _frustum_culling && !_gpu_culling;
+    const bool gpu_culling = _frustum_culling && _gpu_culling;
+    const bool occlusion_culling = gpu_culling && _occlusion_depth;
+    const bool visibility = _visibility_buffer && _visibility_depth && visibility_buffer_supported();
+    const bool deferred = !visibility && _gbuffer && _gbuffer_depth;
+    const bool depth_prepass = _depth_prepass && !deferred && !visibility;
+    // Triangle ids of objects with culled meshlets would index their compacted index buffer
+    const bool meshlet_culling = _meshlet_culling && !visibility;
+
+    if(cpu_culling) {
+        PROFILE_GPU("Frustum culling");
+        _culling_candidates.clear();
+        bvh().query_frustum(_camera.build_frustum(), _camera.position(), _culling_candidates);
+        _object_culler.cull(_camera, _min_screen_size, _culling_candidates);
+    }
+
+    select_lods();
+
+    if(meshlet_culling) {
+        PROFILE_GPU("Meshlet culling");
+        _meshlet_culler->cull(_objects, _object_lods);
+    }
+
+    // Queue every object, opaque first then transparent
+    _render_queue.clear();
+    _render_queue.set_sorting(_draw_sorting);
     {
-        // Opaque first
-        for(const SceneObject& obj : _objects) {
-            if(obj.material().is_opaque()) {
-                obj.render();
+        const glm::vec3 camera_position = _camera.position();
+        const glm::vec3 camera_forward = _camera.forward();
+        for(size_t i = 0; i != _objects.size(); ++i) {
+            const SceneObject& object = _objects[i];
+            if(!object.mesh() || (cpu_culling && !_object_culler.is_visible(i))) {
+                continue;
+            }
+
+            const glm::vec3 center = object.world_bounding_sphere().center;
+            const RenderPass pass = object.material().is_opaque() ? RenderPass::Opaque : RenderPass::Transparent;
+            _render_queue.push(pass, object, u32(i), _object_lods[i], glm::dot(center - camera_position, camera_forward));
+
+            // Only queued objects are submitted, objects culled on the GPU are still counted
+            _lod_stats.submitted_triangles += object.mesh()->index_count(_object_lods[i]) / 3;
+            ++_lod_stats.objects_per_lod[_object_lods[i]];
+        }
+    }
+    _render_queue.sort();
+
+    const Span<const RenderQueue::Item> items = _render_queue.items();
+
+    // Transforms are stored in queue order, so objects drawn together are contiguous
+    auto instances = frame_allocator().allocate<glm::mat4>(std::max(items.size(), size_t(1)));
+    for(size_t i = 0; i != items.size(); ++i) {
+        instances[i] = _objects[items[i].object].transform();
+    }
+
+    auto same_draw = [&](u32 a, u32 b) {
+        return _objects[a].mesh() == _objects[b].mesh()
+            && &_objects[a].material() == &_objects[b].material()
+            && _object_lods[a] == _object_lods[b];
+    };
+
+    // Every run of identical objects becomes one draw. Objects with culled meshlets have their own index range and are drawn alone
+    auto commands = frame_allocator().allocate<shader::DrawElementsIndirectCommand>(std::max(items.size(), size_t(1)));
+    auto draw_data = frame_allocator().allocate<shader::DrawData>(std::max(items.size(), size_t(1)));
+    // Object and draw of every instance, for GPU culling
+    auto cull_items = frame_allocator().allocate<shader::CullItem>(gpu_culling ? std::max(items.size(), size_t(1)) : 0);
+    // Draw and index range of every instance slot, for the visibility buffer shading pass
+    auto visibility_instances = frame_allocator().allocate<shader::VisibilityInstance>(visibility ? std::max(items.size(), size_t(1)) : 0);
+    _draws.clear();
+    for(size_t first = 0, count = 1; first < items.size(); first += count) {
+        const u32 object_index = items[first].object;
+        const SceneObject& object = _objects[object_index];
+        const u32 lod = _object_lods[object_index];
+        const bool culled = meshlet_culling && _meshlet_culler->has_culled(object_index);
+
+        count = 1;
+        if(_instancing && !culled) {
+            while(first + count != items.size() && same_draw(object_index, items[first + count].object)) {
+                ++count;
+            }
+        }
+
+        if(gpu_culling) {
+            // Transparent objects don't write depth, and objects with culled meshlets are drawn regardless of their instance count
+            const bool occludable = object.material().is_opaque() && !culled;
+            for(size_t i = first; i != first + count; ++i) {
+                cull_items[i] = {items[i].object, u32(_draws.size()), u32(occludable), u32(culled)};
             }
         }
 
-        // Transparent after
-        for(const SceneObject& obj : _objects) {
-            if(!obj.material().is_opaque()) {
-                obj.render();
+        // With GPU culling, instance counts are rebuilt from the visible instances
+        const shader::DrawElementsIndirectCommand command = object.mesh()->draw_command(lod, gpu_culling ? 0 : u32(count));
+        if(visibility) {
+            for(size_t i = first; i != first + count; ++i) {
+                visibility_instances[i] = {u32(_draws.size()), command.first_index, command.base_vertex, u32(object.mesh()->has_short_indices())};
+            }
+        }
+
+        commands[_draws.size()] = command;
+        draw_data[_draws.size()] = object.draw_data(u32(first), items[first].material);
+        _draws.push_back({object_index, u32(count), culled});
+    }
+
+    // Visible instances are compacted in a buffer of the culler. Objects with culled meshlets are drawn with the meshlet
+    // culler's command whatever the object culling decides, their transform is always written
+    if(gpu_culling) {
+        PROFILE_GPU("GPU culling");
+        const DepthPyramid* occluders = occlusion_culling && _depth_pyramid->depth_size() == _occlusion_depth->size() ? _depth_pyramid.get() : nullptr;
+        _object_culler.cull_gpu(_camera, _min_screen_size, u32(items.size()), cull_items, instances, draw_data, commands, occluders);
+    }
+
+    // Bindless and texture array materials read their parameters from this table, indexed by the draw's material id
+    const bool material_table = bindless_enabled() || texture_arrays_enabled();
+    const Span<const Material* const> materials = _render_queue.materials();
+    auto material_params = frame_allocator().allocate<shader::MaterialParams>(material_table ? std::max(materials.size(), size_t(1)) : 0);
+    if(material_table) {
+        for(size_t i = 0; i != materials.size(); ++i) {
+            material_params[i] = materials[i]->params();
+        }
+    }
+
+    // Culling uses the storage bindings, bind the draw buffers only once it's done
+    auto bind_draw_buffers = [&](bool retested) {
+        light_buffer.bind(BufferUsage::Storage, 1);
+        if(gpu_culling && !items.is_empty()) {
+            _object_culler.instance_buffer(retested).bind(BufferUsage::Storage, 2);
+        } else {
+            instances.bind(BufferUsage::Storage, 2);
+        }
+        draw_data.bind(BufferUsage::Storage, 3);
+        if(material_table) {
+            material_params.bind(BufferUsage::Storage, 4);
+        }
+        _light_clusters->bind();
+    };
+
+    // Consecutive draws with compatible materials and the same index type are submitted together, only changing the state that differs from the previous submission
+    auto same_submission = [&](const Draw& a, const Draw& b) {
+        const SceneObject& obj_a = _objects[a.object];
+        const SceneObject& obj_b = _objects[b.object];
+        return !b.culled
+            && obj_a.material().can_batch_with(obj_b.material())
+            && obj_a.mesh()->has_short_indices() == obj_b.mesh()->has_short_indices();
+    };
+
+    // Draws found visible by the occlusion re-test are submitted again with the commands of the second phase,
+    // objects with culled meshlets were already drawn by the first one
+    auto submit_draws = [&](size_t begin, size_t end, bool retested, MaterialPass pass) {
+        const Material* bound = nullptr;
+        for(size_t first = begin, count = 1; first < end; first += count) {
+            const Draw& draw = _draws[first];
+            const SceneObject& object = _objects[draw.object];
+
+            count = 1;
+            if(!draw.culled) {
+                while(first + count != end && same_submission(draw, _draws[first + count])) {
+                    ++count;
+                }
+            }
+
+            if(retested && draw.culled) {
+                continue;
             }
+
+            if(!object.bind(u32(first), bound, &_draw_stats, pass)) {
+                continue;
+            }
+            if(pass == MaterialPass::Visibility) {
+                object.material().pass_program(pass).set_uniform(HASH("instance_phase"), u32(retested));
+            }
+            bound = &object.material();
+
+            if(draw.culled) {
+                _meshlet_culler->draw(object, draw.object, _object_lods[draw.object]);
+                ++_draw_stats.draw_calls;
+            } else if(gpu_culling) {
+                _object_culler.command_buffer(retested).bind(BufferUsage::Indirect);
+                _draw_stats.draw_calls += multi_draw(object.material().pass_program(pass), object.mesh()->has_short_indices(), first * sizeof(shader::DrawElementsIndirectCommand), u32(count));
+            } else {
+                commands.bind(BufferUsage::Indirect);
+                _draw_stats.draw_calls += multi_draw(object.material().pass_program(pass), object.mesh()->has_short_indices(), commands.offset + first * sizeof(shader::DrawElementsIndirectCommand), u32(count));
+            }
+
+            if(!retested && pass != MaterialPass::DepthPrepass) {
+                _draw_stats.draws += u32(count);
+                for(size_t i = 0; i != count; ++i) {
+                    _draw_stats.instances += _draws[first + i].instance_count;
+                }
+            }
+        }
+    };
+
+    // Opaque draws come first
+    const size_t opaque_end = size_t(std::find_if(_draws.begin(), _draws.end(), [&](const Draw& draw) {
+        return !_objects[draw.object].material().is_opaque();
+    }) - _draws.begin());
+
+    // With a depth prepass, opaque objects only write depth until the depth buffer is complete, and are shaded afterwards
+    auto draw_opaque = [&](bool retested) {
+        if(depth_prepass) {
+            PROFILE_GPU("Depth prepass");
+            gl_state().set_color_write(false);
+            submit_draws(0, opaque_end, retested, MaterialPass::DepthPrepass);
+            gl_state().set_color_write(true);
+        } else if(deferred) {
+            PROFILE_GPU("G-buffer");
+            submit_draws(0, opaque_end, retested, MaterialPass::GBuffer);
+        } else if(visibility) {
+            PROFILE_GPU("Visibility buffer");
+            submit_draws(0, opaque_end, retested, MaterialPass::Visibility);
+        } else {
+            submit_draws(0, opaque_end, retested, MaterialPass::Main);
+        }
+    };
+
+    if(deferred) {
+        _gbuffer->bind_geometry();
+    } else if(visibility) {
+        _visibility_buffer->bind_geometry();
+    }
+
+    _draw_stats = {};
+    bind_draw_buffers(false);
+    draw_opaque(false);
+
+    // Instances hidden by the previous frame's depth are tested again against the depth of what was just drawn,
+    // which is then built again once they have been drawn, for the first phase of the next frame
+    if(occlusion_culling) {
+        const glm::mat4 view_proj = _camera.view_proj_matrix();
+        {
+            PROFILE_GPU("Depth pyramid");
+            _depth_pyramid->build(*_occlusion_depth, view_proj);
+        }
+        {
+            PROFILE_GPU("Occlusion culling");
+            _object_culler.retest_gpu(*_depth_pyramid, cull_items, instances, draw_data);
+        }
+
+        bind_draw_buffers(true);
+        draw_opaque(true);
+
+        {
+            PROFILE_GPU("Depth pyramid");
+            _depth_pyramid->build(*_occlusion_depth, view_proj);
+        }
+        bind_draw_buffers(false);
+    }
+
+    // Only fragments matching the prepass depth are shaded, depth is already final
+    if(depth_prepass) {
+        PROFILE_GPU("Opaque shading");
+        gl_state().set_depth_write(false);
+        submit_draws(0, opaque_end, false, MaterialPass::AfterPrepass);
+        if(occlusion_culling) {
+            bind_draw_buffers(true);
+            submit_draws(0, opaque_end, true, MaterialPass::AfterPrepass);
+            bind_draw_buffers(false);
+        }
+        gl_state().set_depth_write(true);
+    }
+
+    // Every pixel covered by the G-buffer is lit once, on top of the emissive it wrote. Transparent objects are still drawn forward
+    if(deferred) {
+        PROFILE_GPU("Deferred lighting");
+        _gbuffer->bind_lighting(*_gbuffer_depth);
+        _deferred_lighting_material.bind();
+        draw_full_screen_triangle();
+        _gbuffer->bind_forward();
+    }
+
+    // Every pixel covered by an opaque object fetches its triangle and is shaded once
+    if(visibility) {
+        PROFILE_GPU("Visibility shading");
+        _visibility_buffer->bind_shading(*_visibility_depth);
+        if(gpu_culling && !items.is_empty()) {
+            _object_culler.instance_buffer(true).bind(BufferUsage::Storage, 7);
+        } else {
+            instances.bind(BufferUsage::Storage, 7);
         }
+        visibility_instances.bind(BufferUsage::Storage, 8);
+        geometry_pool().bind_geometry_storage(9);
+        _visibility_material.bind();
+        draw_full_screen_triangle();
+        _visibility_buffer->bind_forward();
     }
 
+    submit_draws(opaque_end, _draws.size(), false, MaterialPass::Main);
 }
 
 }
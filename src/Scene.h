@@ -2,20 +2,36 @@
 #define SCENE_H
 
 #include <SceneObject.h>
+#include <MeshletCuller.h>
+#include <ObjectCuller.h>
+#include <DepthPyramid.h>
+#include <BVH.h>
+#include <LightClusters.h>
+#include <GBuffer.h>
+#include <VisibilityBuffer.h>
+#include <RenderQueue.h>
 #include <PointLight.h>
 #include <Camera.h>
 
+#include <array>
 #include <vector>
 #include <memory>
 
 namespace OM3D {
 
+struct LodStats {
+    u32 loaded_triangles = 0;
+    u32 submitted_triangles = 0;
+    std::array<u32, max_lod_count> objects_per_lod = {};
+};
+
 class Scene : NonMovable {
 
     public:
         Scene();
 
         static Result<std::unique_ptr<Scene>> from_gltf(const std::string& file_name);
+        static Result<std::unique_ptr<Scene>> from_baked(const std::string& file_name);
 
         void render() const;
 
@@ -25,6 +41,13 @@ class Scene : NonMovable {
         Span<const SceneObject> objects() const;
         Span<const PointLight> point_lights() const;
 
+        // Moves an object, refitting the BVH instead of rebuilding it
+        void set_object_transform(size_t index, const glm::mat4& transform);
+
+        // Hierarchy over the world bounds of every object, for culling and spatial queries (picking, objects touched by lights...).
+        // Object indices are indices in objects(). It is built again on first use after objects are added
+        const BVH& bvh() const;
+
         Camera& camera();
         const Camera& camera() const;
 
@@ -33,10 +56,56 @@ class Scene : NonMovable {
 
         void set_sun(float altitude, float azimuth, glm::vec3 color = glm::vec3(1.0f));
 
+        void set_meshlet_culling(bool enabled);
+        bool meshlet_culling() const;
+        const MeshletCullingStats& meshlet_culling_stats() const;
+
+        // Objects are drawn with the coarsest level of detail whose projected error is below max_error,
+        // as a fraction of the viewport height. 0 always draws the full resolution meshes
+        void set_lod_max_error(float max_error);
+        const LodStats& lod_stats() const;
+
+        // Sorts draws by state and depth instead of drawing them in insertion order
+        void set_draw_sorting(bool enabled);
+        const StateChangeStats& draw_stats() const;
+
+        // Draws consecutive objects sharing mesh, material and level of detail with a single instanced draw
+        void set_instancing(bool enabled);
+
+        // Skips objects outside of the camera frustum, or smaller than min_screen_size as a fraction of the viewport height (0 keeps them).
+        // On the GPU, culling only changes the instance counts of indirect draws, which are still all submitted
+        void set_frustum_culling(bool enabled, float min_screen_size = 0.0f, bool on_gpu = false);
+        const ObjectCullingStats& object_culling_stats() const;
+
+        // Bins point lights into screen space clusters so each fragment only evaluates the lights that can reach it.
+        // The heatmap replaces the shading with the number of lights evaluated per fragment
+        void set_clustered_lighting(bool enabled, bool heatmap = false);
+
+        // Also skips opaque objects hidden behind the depth of the previous frame, only with GPU culling.
+        // depth is the depth buffer the scene is rendered into, nullptr disables it
+        void set_occlusion_culling(const Texture* depth);
+
+        // Draws opaque objects to depth first, so the lighting pass only shades the visible surface of each pixel
+        void set_depth_prepass(bool enabled);
+
+        // Writes opaque objects to the G-buffer and lights every pixel they cover once in a full screen pass, nullptr draws them forward.
+        // depth is the depth buffer the scene is rendered into. The depth prepass is not used with deferred shading
+        void set_deferred_shading(const GBuffer* gbuffer, const Texture* depth);
+
+        // Only writes the triangle covering each pixel of opaque objects, then fetches and shades it once per pixel, nullptr draws them forward.
+        // Takes precedence over deferred shading, and is only used if visibility_buffer_supported(). Meshlet culling is not used with it
+        void set_visibility_buffer(const VisibilityBuffer* visibility, const Texture* depth);
+
     private:
+        void select_lods() const;
+
         std::vector<SceneObject> _objects;
         std::vector<PointLight> _point_lights;
 
+        mutable BVH _bvh;
+        mutable bool _bvh_dirty = true;
+        mutable std::vector<u32> _culling_candidates;
+
         glm::vec3 _sun_direction = glm::vec3(0.2f, 1.0f, 0.1f);
         glm::vec3 _sun_color = glm::vec3(1.0f);
 
@@ -44,6 +113,49 @@ class Scene : NonMovable {
         float _ibl_intensity = 1.0f;
         Material _sky_material;
 
+        mutable ObjectCuller _object_culler;
+        bool _frustum_culling = true;
+        bool _gpu_culling = false;
+        float _min_screen_size = 0.0f;
+
+        std::unique_ptr<LightClusters> _light_clusters;
+        bool _clustered_lighting = true;
+        bool _light_heatmap = false;
+
+        std::unique_ptr<DepthPyramid> _depth_pyramid;
+        const Texture* _occlusion_depth = nullptr;
+
+        bool _depth_prepass = false;
+
+        const GBuffer* _gbuffer = nullptr;
+        const Texture* _gbuffer_depth = nullptr;
+        Material _deferred_lighting_material;
+
+        const VisibilityBuffer* _visibility_buffer = nullptr;
+        const Texture* _visibility_depth = nullptr;
+        Material _visibility_material;
+
+        std::unique_ptr<MeshletCuller> _meshlet_culler;
+        bool _meshlet_culling = false;
+
+        float _lod_max_error = 0.0f;
+        // Levels are kept from one frame to the next for hysteresis
+        mutable std::vector<u32> _object_lods;
+        mutable LodStats _lod_stats;
+
+        bool _draw_sorting = true;
+        bool _instancing = true;
+
+        struct Draw {
+            u32 object = 0;
+            u32 instance_count = 0;
+            bool culled = false;
+        };
+
+        mutable std::vector<Draw> _draws;
+        mutable RenderQueue _render_queue;
+        mutable StateChangeStats _draw_stats;
+
         Camera _camera;
 };
 
@@ -0,0 +1,722 @@
+#include "SceneData.h"
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <AttribDecoder.h>
+#include <MeshOptimizer.h>
+#include <utils.h>
+
+#include <iostream>
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wignored-qualifiers"
+#endif
+
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_NO_STB_IMAGE_WRITE
+#define TINYGLTF_NOEXCEPTION
+#include <tinygltf/tiny_gltf.h>
+
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+namespace OM3D {
+
+bool display_gltf_loading_warnings = false;
+bool parallel_gltf_loading = true;
+bool optimize_gltf_meshes = true;
+bool display_mesh_optimization_stats = false;
+bool generate_gltf_lods = true;
+
+// Runs func for every index on worker threads, unless parallel loading has been disabled
+static void loader_for(size_t count, const std::function<void(size_t)>& func) {
+    if(parallel_gltf_loading) {
+        parallel_for(count, func);
+    } else {
+        for(size_t i = 0; i != count; ++i) {
+            func(i);
+        }
+    }
+}
+
+static u32 component_count(int type) {
+    switch(type) {
+        case TINYGLTF_TYPE_SCALAR: return 1;
+        case TINYGLTF_TYPE_VEC2: return 2;
+        case TINYGLTF_TYPE_VEC3: return 3;
+        case TINYGLTF_TYPE_VEC4: return 4;
+        case TINYGLTF_TYPE_MAT2: return 4;
+        case TINYGLTF_TYPE_MAT3: return 9;
+        case TINYGLTF_TYPE_MAT4: return 16;
+        default: return 0;
+    }
+}
+
+// Returns the first byte of the accessor and its stride, or nullptr if it doesn't fit in its buffer
+static const u8* accessor_data(const tinygltf::Model& gltf, const tinygltf::Accessor& accessor, size_t elem_size, size_t& stride) {
+    if(accessor.bufferView < 0 || size_t(accessor.bufferView) >= gltf.bufferViews.size()) {
+        return nullptr;
+    }
+
+    const tinygltf::BufferView& buffer = gltf.bufferViews[accessor.bufferView];
+    if(buffer.buffer < 0 || size_t(buffer.buffer) >= gltf.buffers.size()) {
+        return nullptr;
+    }
+
+    const auto& data = gltf.buffers[buffer.buffer].data;
+    if(!accessor.count) {
+        return nullptr;
+    }
+
+    stride = buffer.byteStride ? buffer.byteStride : elem_size;
+
+    const size_t begin = buffer.byteOffset + accessor.byteOffset;
+    const size_t end = begin + (accessor.count - 1) * stride + elem_size;
+    if(end > data.size() || end > buffer.byteOffset + buffer.byteLength) {
+        return nullptr;
+    }
+
+    return data.data() + begin;
+}
+
+static bool decode_attrib_buffer(const tinygltf::Model& gltf, const std::string& name, const tinygltf::Accessor& accessor, Span<Vertex> vertices) {
+    DEBUG_ASSERT(accessor.count == vertices.size());
+
+    auto decode = [&](auto* vertex_elems) {
+        using attrib_type = std::remove_reference_t<decltype(vertex_elems[0])>;
+        static constexpr u32 size = u32(attrib_type::length());
+
+        const ComponentType type = ComponentType(accessor.componentType);
+        const u32 components = component_count(accessor.type);
+
+        if(components != size) {
+            if(display_gltf_loading_warnings) {
+                std::cerr << "Expected VEC" << size << " attribute, got VEC" << components << std::endl;
+            }
+        }
+
+        size_t stride = 0;
+        const u8* in = accessor_data(gltf, accessor, components * component_byte_size(type), stride);
+        if(!in) {
+            std::cerr << "Invalid accessor for \"" << name << "\"" << std::endl;
+            return false;
+        }
+
+        if(!decode_attribs(in, stride, accessor.count, type, components, accessor.normalized, &vertex_elems->x, sizeof(Vertex), size)) {
+            if(display_gltf_loading_warnings) {
+                std::cerr << "Unsupported component type (" << accessor.componentType << ") for \"" << name << "\"" << std::endl;
+            }
+            return false;
+        }
+
+        return true;
+    };
+
+    if(name == "POSITION") {
+        return decode(&vertices[0].position);
+    } else if(name == "NORMAL") {
+        return decode(&vertices[0].normal);
+    } else if(name == "TANGENT") {
+        return decode(&vertices[0].tangent_bitangent_sign);
+    } else if(name == "TEXCOORD_0") {
+        return decode(&vertices[0].uv);
+    } else if(name == "COLOR_0") {
+        return decode(&vertices[0].color);
+    } else {
+        if(display_gltf_loading_warnings) {
+            std::cerr << "Attribute \"" << name << "\" is not supported" << std::endl;
+        }
+    }
+    return true;
+}
+
+static bool decode_index_buffer(const tinygltf::Model& gltf, const tinygltf::Accessor& accessor, Span<u32> indices) {
+    const ComponentType type = ComponentType(accessor.componentType);
+
+    size_t stride = 0;
+    const u8* in = accessor_data(gltf, accessor, component_byte_size(type), stride);
+    if(!in) {
+        std::cerr << "Invalid index accessor" << std::endl;
+        return false;
+    }
+
+    if(!decode_indices(in, stride, accessor.count, type, indices.data())) {
+        std::cerr << "Index component type not supported" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static Result<MeshData> build_mesh_data(const tinygltf::Model& gltf, const tinygltf::Primitive& prim) {
+    std::vector<Vertex> vertices;
+    for(auto&& [name, id] : prim.attributes) {
+        tinygltf::Accessor accessor = gltf.accessors[id];
+        if(!accessor.count) {
+            continue;
+        }
+
+        if(accessor.sparse.isSparse) {
+            return {false, {}};
+        }
+
+        if(!vertices.size()) {
+            std::fill_n(std::back_inserter(vertices), accessor.count, Vertex{});
+        } else if(vertices.size() != accessor.count) {
+            return {false, {}};
+        }
+
+        if(!decode_attrib_buffer(gltf, name, accessor, vertices)) {
+            return {false, {}};
+        }
+    }
+
+    std::vector<u32> indices;
+    {
+        if(prim.indices < 0 || size_t(prim.indices) >= gltf.accessors.size()) {
+            std::cerr << "Primitive has no valid index accessor" << std::endl;
+            return {false, {}};
+        }
+
+        tinygltf::Accessor accessor = gltf.accessors[prim.indices];
+        if(!accessor.count || accessor.sparse.isSparse) {
+            return {false, {}};
+        }
+
+        if(!indices.size()) {
+            std::fill_n(std::back_inserter(indices), accessor.count, u32(0));
+        } else if(indices.size() != accessor.count) {
+            return {false, {}};
+        }
+
+        if(!decode_index_buffer(gltf, accessor, indices)) {
+            return {false, {}};
+        }
+
+        // Tangents, mesh optimization and meshlets all index CPU side vertex arrays
+        const u32 vertex_count = u32(vertices.size());
+        if(std::any_of(indices.begin(), indices.end(), [=](u32 index) { return index >= vertex_count; })) {
+            std::cerr << "Index out of range (" << vertices.size() << " vertices)" << std::endl;
+            return {false, {}};
+        }
+    }
+
+    return {true, MeshData{std::move(vertices), std::move(indices), {}, {}}};
+}
+
+// Only keeps the encoded bytes, images are decoded later and only if a material uses them
+static bool capture_encoded_image(tinygltf::Image*, const int image_index, std::string*, std::string*, int, int, const unsigned char* bytes, int size, void* user_data) {
+    auto& encoded_images = *static_cast<std::vector<std::vector<u8>>*>(user_data);
+    if(encoded_images.size() <= size_t(image_index)) {
+        encoded_images.resize(image_index + 1);
+    }
+    encoded_images[image_index].assign(bytes, bytes + size);
+    return true;
+}
+
+static Result<TextureData> decode_texture_data(Span<const u8> encoded, bool as_sRGB) {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    TextureData::TexelBuffer texels(stbi_load_from_memory(encoded.data(), int(encoded.size()), &width, &height, &channels, 4));
+    if(!texels || width <= 0 || height <= 0) {
+        std::cerr << "Unable to decode image: " << stbi_failure_reason() << std::endl;
+        return {false, {}};
+    }
+
+    const ImageFormat format = as_sRGB ? ImageFormat::RGBA8_sRGB : ImageFormat::RGBA8_UNORM;
+    return {true, TextureData{std::move(texels), glm::uvec2(width, height), format}};
+}
+
+
+static glm::mat4 trs_matrix(const glm::vec3& translation, const glm::vec4& rotation, const glm::vec3& scale) {
+    const glm::tquat<float> q(rotation.w, rotation.x, rotation.y, rotation.z);
+    return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(q) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+static glm::mat4 parse_node_matrix(const tinygltf::Node& node) {
+    glm::vec3 translation(0.0f, 0.0f, 0.0f);
+    for(u32 k = 0; k != node.translation.size(); ++k) {
+        translation[k] = float(node.translation[k]);
+    }
+
+    glm::vec3 scale(1.0f, 1.0f, 1.0f);
+    for(u32 k = 0; k != node.scale.size(); ++k) {
+        scale[k] = float(node.scale[k]);
+    }
+
+    glm::vec4 rotation(0.0f, 0.0f, 0.0f, 1.0f);
+    for(u32 k = 0; k != node.rotation.size(); ++k) {
+        rotation[k] = float(node.rotation[k]);
+    }
+
+    return trs_matrix(translation, rotation, scale);
+}
+
+// Transforms of every instance of the node's mesh: one per EXT_mesh_gpu_instancing instance, or only the node's own
+static std::vector<glm::mat4> parse_instance_transforms(const tinygltf::Model& gltf, const tinygltf::Node& node, const glm::mat4& node_transform) {
+    const auto it = node.extensions.find("EXT_mesh_gpu_instancing");
+    if(it == node.extensions.end()) {
+        return {node_transform};
+    }
+
+    const tinygltf::Value& attributes = it->second.Get("attributes");
+
+    size_t instance_count = 0;
+    auto decode = [&](const std::string& name, auto& values) {
+        using attrib_type = typename std::remove_reference_t<decltype(values)>::value_type;
+        static constexpr u32 size = u32(attrib_type::length());
+
+        if(!attributes.Has(name)) {
+            return true;
+        }
+
+        const int index = attributes.Get(name).GetNumberAsInt();
+        if(index < 0 || size_t(index) >= gltf.accessors.size()) {
+            return false;
+        }
+
+        const tinygltf::Accessor& accessor = gltf.accessors[index];
+        if(accessor.sparse.isSparse || component_count(accessor.type) != size || (instance_count && accessor.count != instance_count)) {
+            return false;
+        }
+
+        const ComponentType type = ComponentType(accessor.componentType);
+        size_t stride = 0;
+        const u8* in = accessor_data(gltf, accessor, size * component_byte_size(type), stride);
+        if(!in) {
+            return false;
+        }
+
+        instance_count = accessor.count;
+        values.resize(instance_count);
+        return decode_attribs(in, stride, instance_count, type, size, accessor.normalized, &values[0].x, sizeof(attrib_type), size);
+    };
+
+    std::vector<glm::vec3> translations;
+    std::vector<glm::vec4> rotations;
+    std::vector<glm::vec3> scales;
+    if(!decode("TRANSLATION", translations) || !decode("ROTATION", rotations) || !decode("SCALE", scales)) {
+        std::cerr << "Invalid EXT_mesh_gpu_instancing attributes for node \"" << node.name << "\"" << std::endl;
+        return {node_transform};
+    }
+
+    // Missing attributes are identity
+    translations.resize(instance_count, glm::vec3(0.0f));
+    rotations.resize(instance_count, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    scales.resize(instance_count, glm::vec3(1.0f));
+
+    std::vector<glm::mat4> transforms(instance_count);
+    for(size_t i = 0; i != instance_count; ++i) {
+        transforms[i] = node_transform * trs_matrix(translations[i], rotations[i], scales[i]);
+    }
+    return transforms;
+}
+
+static glm::mat4 base_transform() {
+    return glm::mat4(1.0f);
+}
+
+static void parse_node_transforms(int node_index, const tinygltf::Model& gltf, std::unordered_map<int, glm::mat4>& node_transforms, const glm::mat4& parent_transform = base_transform()) {
+    const tinygltf::Node& node = gltf.nodes[node_index];
+    const glm::mat4 transform = parent_transform * parse_node_matrix(node);
+    node_transforms[node_index] = transform;
+    for(int child : node.children)  {
+        parse_node_transforms(child, gltf, node_transforms, transform);
+    }
+}
+
+static void compute_tangents(MeshData& mesh) {
+    for(Vertex& vert : mesh.vertices) {
+        vert.tangent_bitangent_sign = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    for(size_t i = 0; i < mesh.indices.size(); i += 3) {
+        const u32 tri[] = {
+            mesh.indices[i + 0],
+            mesh.indices[i + 1],
+            mesh.indices[i + 2]
+        };
+
+        const glm::vec3 edges[] = {
+            mesh.vertices[tri[1]].position - mesh.vertices[tri[0]].position,
+            mesh.vertices[tri[2]].position - mesh.vertices[tri[0]].position
+        };
+
+        const glm::vec2 uvs[] = {
+            mesh.vertices[tri[0]].uv,
+            mesh.vertices[tri[1]].uv,
+            mesh.vertices[tri[2]].uv
+        };
+
+        const float dt[] = {
+            uvs[1].y - uvs[0].y,
+            uvs[2].y - uvs[0].y
+        };
+
+        const glm::vec3 tangent = -glm::normalize((edges[0] * dt[1]) - (edges[1] * dt[0]));
+        mesh.vertices[tri[0]].tangent_bitangent_sign += glm::vec4(tangent, 0.0f);
+        mesh.vertices[tri[1]].tangent_bitangent_sign += glm::vec4(tangent, 0.0f);
+        mesh.vertices[tri[2]].tangent_bitangent_sign += glm::vec4(tangent, 0.0f);
+    }
+
+    for(Vertex& vert : mesh.vertices) {
+        const glm::vec3 tangent = vert.tangent_bitangent_sign;
+        vert.tangent_bitangent_sign = glm::vec4(glm::normalize(tangent), 1.0f);
+    }
+}
+
+
+Result<SceneData> SceneData::from_gltf(const std::string& file_name) {
+    const double time = program_time();
+
+    tinygltf::TinyGLTF ctx;
+    tinygltf::Model gltf;
+
+    std::vector<std::vector<u8>> encoded_images;
+    ctx.SetImageLoader(capture_encoded_image, &encoded_images);
+
+    {
+        std::string err;
+        std::string warn;
+
+        const bool is_ascii = ends_with(file_name, ".gltf");
+        const bool ok = is_ascii
+                ? ctx.LoadASCIIFromFile(&gltf, &err, &warn, file_name)
+                : ctx.LoadBinaryFromFile(&gltf, &err, &warn, file_name);
+
+        if(!err.empty()) {
+            std::cerr << "Error while loading gltf: " << err << std::endl;
+        }
+        if(!warn.empty()) {
+            std::cerr << "Warning while loading gltf: " << warn << std::endl;
+        }
+
+        if(!ok) {
+            return {false, {}};
+        }
+    }
+
+    std::cout << file_name << " parsed in " << std::round((program_time() - time) * 100.0) / 100.0 << "s" << std::endl;
+
+    SceneData scene;
+
+    std::unordered_map<int, i32> textures;
+    std::vector<std::pair<int, bool>> texture_images;
+    std::unordered_map<int, i32> materials;
+    std::unordered_map<int, glm::mat4> node_transforms;
+    std::vector<std::pair<int, int>> light_nodes;
+
+    {
+        std::vector<int> node_indices;
+        if(gltf.defaultScene >= 0) {
+            node_indices = gltf.scenes[gltf.defaultScene].nodes;
+        } else {
+            for(u32 i = 0; i != gltf.nodes.size(); ++i) {
+                node_indices.push_back(i);
+                node_transforms[i] = base_transform();
+            }
+        }
+
+        for(const int node_index : node_indices) {
+            parse_node_transforms(node_index, gltf, node_transforms);
+        }
+
+        for(const int node_index : node_indices) {
+            const auto& node = gltf.nodes[node_index];
+            if(const auto it = node.extensions.find("KHR_lights_punctual"); it != node.extensions.end()) {
+                const int light_index = it->second.Get("light").Get<int>();
+                if(light_index < 0 || light_index >= static_cast<int>(gltf.lights.size())) {
+                    continue;
+                }
+                light_nodes.emplace_back(std::pair{node_index, light_index});
+            }
+        }
+    }
+
+    const std::string emissive_strength_ext_name = "KHR_materials_emissive_strength";
+
+    struct PrimitiveInstance {
+        glm::mat4 transform;
+        u32 mesh = 0;
+    };
+
+    // Primitives are only decoded once, no matter how many nodes (or GPU instances of a node) reference their mesh
+    std::vector<PrimitiveInstance> instances;
+    std::vector<const tinygltf::Primitive*> primitives;
+    std::map<std::pair<int, size_t>, u32> primitive_meshes;
+    for(auto [node_index, node_transform] : node_transforms) {
+        const tinygltf::Node& node = gltf.nodes[node_index];
+
+        if(node.mesh < 0) {
+            continue;
+        }
+
+        const std::vector<glm::mat4> instance_transforms = parse_instance_transforms(gltf, node, node_transform);
+
+        const tinygltf::Mesh& mesh = gltf.meshes[node.mesh];
+        for(size_t j = 0; j != mesh.primitives.size(); ++j) {
+            if(mesh.primitives[j].mode != TINYGLTF_MODE_TRIANGLES) {
+                continue;
+            }
+
+            const auto [it, inserted] = primitive_meshes.try_emplace(std::pair{node.mesh, j}, u32(primitives.size()));
+            if(inserted) {
+                primitives.push_back(&mesh.primitives[j]);
+            }
+            for(const glm::mat4& transform : instance_transforms) {
+                instances.push_back(PrimitiveInstance{transform, it->second});
+            }
+        }
+    }
+
+    // Decode, build tangents for and prepare every primitive on worker threads
+    std::vector<Result<MeshData>> mesh_data(primitives.size());
+    std::vector<double> decode_times(primitives.size());
+    std::vector<MeshOptimizationStats> optimization_stats(primitives.size());
+    {
+        const double decode_time = program_time();
+
+        auto decode_primitive = [&](size_t i) {
+            const double start = program_time();
+            auto mesh = build_mesh_data(gltf, *primitives[i]);
+            if(mesh.is_ok && mesh.value.vertices[0].tangent_bitangent_sign == glm::vec4(0.0f)) {
+                compute_tangents(mesh.value);
+            }
+            if(mesh.is_ok && optimize_gltf_meshes) {
+                optimization_stats[i] = optimize_mesh(mesh.value);
+            }
+            // Meshlets are built even without optimization, build_mesh_data already rejected out of range indices
+            if(mesh.is_ok) {
+                mesh.value.meshlets = build_meshlets(mesh.value);
+            }
+            if(mesh.is_ok && generate_gltf_lods) {
+                mesh.value.lods = build_lods(mesh.value);
+            }
+            mesh_data[i] = std::move(mesh);
+            decode_times[i] = program_time() - start;
+        };
+
+        loader_for(primitives.size(), decode_primitive);
+
+        std::cout << primitives.size() << " primitives decoded in " << std::round((program_time() - decode_time) * 1000.0) / 1000.0 << "s"
+                  << (parallel_gltf_loading ? " (parallel)" : " (serial)") << std::endl;
+    }
+
+    if(optimize_gltf_meshes) {
+        auto print_stats = [](const MeshOptimizationStats& stats) {
+            std::cout << "ACMR " << std::round(stats.before.acmr() * 1000.0) / 1000.0 << " -> " << std::round(stats.after.acmr() * 1000.0) / 1000.0
+                      << ", ATVR " << std::round(stats.before.atvr() * 1000.0) / 1000.0 << " -> " << std::round(stats.after.atvr() * 1000.0) / 1000.0
+                      << ", " << stats.welded_vertices << " vertices welded" << std::endl;
+        };
+
+        MeshOptimizationStats total;
+        for(size_t i = 0; i != optimization_stats.size(); ++i) {
+            if(display_mesh_optimization_stats) {
+                std::cout << "  mesh " << i << " (" << optimization_stats[i].after.triangles << " triangles): ";
+                print_stats(optimization_stats[i]);
+            }
+            total.before += optimization_stats[i].before;
+            total.after += optimization_stats[i].after;
+            total.welded_vertices += optimization_stats[i].welded_vertices;
+        }
+
+        std::cout << "Meshes optimized: ";
+        print_stats(total);
+    }
+
+    if(generate_gltf_lods) {
+        size_t lod_count = 0;
+        size_t full_triangles = 0;
+        size_t coarsest_triangles = 0;
+        for(const auto& mesh : mesh_data) {
+            if(mesh.is_ok && !mesh.value.lods.empty()) {
+                lod_count += mesh.value.lods.size();
+                full_triangles += mesh.value.lods.front().index_count / 3;
+                coarsest_triangles += mesh.value.lods.back().index_count / 3;
+            }
+        }
+
+        std::cout << lod_count << " LODs generated: " << full_triangles << " triangles at full resolution, " << coarsest_triangles << " at the coarsest levels" << std::endl;
+    }
+
+    for(auto& mesh : mesh_data) {
+        if(!mesh.is_ok) {
+            return {false, {}};
+        }
+        scene.meshes.emplace_back(std::move(mesh.value));
+    }
+
+    {
+        double saved_time = 0.0;
+        size_t saved_vertices = 0;
+        size_t saved_indices = 0;
+        std::vector<bool> first_instance(primitives.size(), true);
+        for(const PrimitiveInstance& instance : instances) {
+            if(first_instance[instance.mesh]) {
+                first_instance[instance.mesh] = false;
+                continue;
+            }
+            saved_time += decode_times[instance.mesh];
+            saved_vertices += scene.meshes[instance.mesh].vertices.size();
+            saved_indices += scene.meshes[instance.mesh].indices.size();
+        }
+
+        if(instances.size() != primitives.size()) {
+            const size_t saved_bytes = saved_vertices * sizeof(Vertex) + saved_indices * sizeof(u32);
+            std::cout << instances.size() << " primitive instances share " << primitives.size() << " meshes: saved "
+                      << std::round(saved_time * 1000.0) / 1000.0 << "s of decoding, "
+                      << saved_vertices << " vertices and " << saved_indices << " indices ("
+                      << std::round(double(saved_bytes) / (1024.0 * 1024.0) * 100.0) / 100.0 << "MB)" << std::endl;
+        }
+    }
+
+    for(const PrimitiveInstance& instance : instances) {
+        const tinygltf::Primitive& prim = *primitives[instance.mesh];
+
+        i32 material = -1;
+        if(prim.material >= 0) {
+            auto [mat, inserted] = materials.try_emplace(prim.material, -1);
+
+            if(inserted) {
+                const auto& gltf_mat = gltf.materials[prim.material];
+                const auto& albedo_info = gltf_mat.pbrMetallicRoughness.baseColorTexture;
+                const auto& normal_info = gltf_mat.normalTexture;
+                const auto& metal_rough_info = gltf_mat.pbrMetallicRoughness.metallicRoughnessTexture;
+                const auto& emissive_info = gltf_mat.emissiveTexture;
+
+                auto load_texture = [&](auto texture_info, bool as_sRGB) -> i32 {
+                    if(texture_info.texCoord != 0) {
+                        std::cerr << "Unsupported texture coordinate channel (" << texture_info.texCoord << ")" << std::endl;
+                        return -1;
+                    }
+
+                    if(texture_info.index < 0) {
+                        return -1;
+                    }
+
+                    const int index = gltf.textures[texture_info.index].source;
+                    if(index < 0) {
+                        return -1;
+                    }
+
+                    if(size_t(index) >= encoded_images.size() || encoded_images[index].empty()) {
+                        return -1;
+                    }
+
+                    auto [texture, inserted] = textures.try_emplace(index, i32(texture_images.size()));
+                    if(inserted) {
+                        texture_images.emplace_back(index, as_sRGB);
+                    }
+                    return texture->second;
+                };
+
+                const bool opaque = (gltf_mat.alphaMode == "OPAQUE") || (gltf_mat.alphaMode == "NONE");
+                const bool mask = (gltf_mat.alphaMode == "MASK");
+
+                MaterialData data;
+                data.alpha_test = !opaque || mask;
+                data.blended = !opaque && !mask;
+                data.double_sided = gltf_mat.doubleSided;
+                data.alpha_cutoff = float(gltf_mat.alphaCutoff);
+
+                data.textures = {
+                    load_texture(albedo_info, true),
+                    load_texture(normal_info, false),
+                    load_texture(metal_rough_info, false),
+                    load_texture(emissive_info, false),
+                };
+
+                data.base_color_factor = glm::vec3(
+                    gltf_mat.pbrMetallicRoughness.baseColorFactor[0],
+                    gltf_mat.pbrMetallicRoughness.baseColorFactor[1],
+                    gltf_mat.pbrMetallicRoughness.baseColorFactor[2]
+                );
+
+                data.metal_rough_factor = glm::vec2(
+                    gltf_mat.pbrMetallicRoughness.metallicFactor,
+                    gltf_mat.pbrMetallicRoughness.roughnessFactor
+                );
+
+                float emissive_factor = 1.0f;
+                if(const auto it = gltf_mat.extensions.find(emissive_strength_ext_name); it != gltf_mat.extensions.end()) {
+                    emissive_factor = float(it->second.Get("emissiveStrength").GetNumberAsDouble());
+                }
+
+                data.emissive_factor = glm::vec3(
+                    gltf_mat.emissiveFactor[0],
+                    gltf_mat.emissiveFactor[1],
+                    gltf_mat.emissiveFactor[2]
+                ) * emissive_factor;
+
+                mat->second = i32(scene.materials.size());
+                scene.materials.push_back(data);
+            }
+
+            material = mat->second;
+        }
+
+        scene.objects.push_back(ObjectData{instance.transform, instance.mesh, material});
+    }
+
+    // Decode every image used by a material on worker threads
+    {
+        const double decode_time = program_time();
+
+        std::vector<Result<TextureData>> texture_data(texture_images.size());
+        loader_for(texture_images.size(), [&](size_t i) {
+            const auto [image_index, as_sRGB] = texture_images[i];
+            texture_data[i] = decode_texture_data(encoded_images[image_index], as_sRGB);
+        });
+
+        // Textures that failed to decode are removed and materials fall back to the default ones
+        std::vector<i32> texture_indices;
+        for(auto& texture : texture_data) {
+            texture_indices.push_back(texture.is_ok ? i32(scene.textures.size()) : -1);
+            if(texture.is_ok) {
+                scene.textures.emplace_back(std::move(texture.value));
+            }
+        }
+
+        for(MaterialData& material : scene.materials) {
+            for(i32& texture : material.textures) {
+                if(texture >= 0) {
+                    texture = texture_indices[texture];
+                }
+            }
+        }
+
+        std::cout << scene.textures.size() << " of " << gltf.images.size() << " images decoded in " << std::round((program_time() - decode_time) * 1000.0) / 1000.0 << "s"
+                  << (parallel_gltf_loading ? " (parallel)" : " (serial)") << std::endl;
+    }
+
+    for(auto [node_index, light_index] : light_nodes) {
+        const auto& gltf_light = gltf.lights[light_index];
+
+        const glm::vec3 color = glm::vec3(float(gltf_light.color[0]), float(gltf_light.color[1]), float(gltf_light.color[2])) * float(gltf_light.intensity);;
+
+        PointLight light;
+        light.set_position(node_transforms[node_index][3]);
+        light.set_color(color);
+        if(gltf_light.range > 0.0) {
+            light.set_radius(float(gltf_light.range));
+        } else {
+            const float intensity = glm::dot(color, glm::vec3(1.0f));
+            light.set_radius(std::sqrt(intensity * 100.0f)); // Put radius where lum < 1%
+        }
+        scene.point_lights.push_back(light);
+    }
+
+
+    return {true, std::move(scene)};
+}
+
+}
+
@@ -0,0 +1,51 @@
+#ifndef SCENEDATA_H
+#define SCENEDATA_H
+
+#include <StaticMesh.h>
+#include <Texture.h>
+#include <PointLight.h>
+
+#include <glm/matrix.hpp>
+
+#include <array>
+#include <vector>
+#include <string>
+
+namespace OM3D {
+
+// CPU side description of a scene, with no GL objects.
+// Used to build a Scene and by the baker.
+
+struct MaterialData {
+    // Index in SceneData::textures for every texture slot of Material::textured_pbr_material (-1 if none)
+    std::array<i32, 4> textures = {-1, -1, -1, -1};
+
+    glm::vec3 base_color_factor = glm::vec3(1.0f);
+    float alpha_cutoff = 0.5f;
+    glm::vec3 emissive_factor = glm::vec3(0.0f);
+    glm::vec2 metal_rough_factor = glm::vec2(1.0f);
+
+    bool alpha_test = false;
+    bool blended = false;
+    bool double_sided = false;
+};
+
+struct ObjectData {
+    glm::mat4 transform = glm::mat4(1.0f);
+    u32 mesh = 0;
+    i32 material = -1; // -1 uses the default material
+};
+
+struct SceneData {
+    std::vector<MeshData> meshes;
+    std::vector<TextureData> textures;
+    std::vector<MaterialData> materials;
+    std::vector<ObjectData> objects;
+    std::vector<PointLight> point_lights;
+
+    static Result<SceneData> from_gltf(const std::string& file_name);
+};
+
+}
+
+#endif // SCENEDATA_H
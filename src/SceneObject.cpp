@@ -1,22 +1,75 @@
 #include "SceneObject.h"
 
+#include <FrameAllocator.h>
+
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+
 namespace OM3D {
 
 SceneObject::SceneObject(std::shared_ptr<StaticMesh> mesh, std::shared_ptr<Material> material) :
     _mesh(std::move(mesh)),
     _material(std::move(material)) {
+
+    update_world_bounds();
 }
 
-void SceneObject::render() const {
+void SceneObject::render(u32 lod) const {
     if(!_material || !_mesh) {
         return;
     }
 
-    _material->set_uniform(HASH("model"), transform());
-    _material->bind();
-    _mesh->draw();
+    auto instance = frame_allocator().allocate<glm::mat4>();
+    instance[0] = _transform;
+    instance.bind(BufferUsage::Storage, 2);
+
+    auto draw_buffer = frame_allocator().allocate<shader::DrawData>();
+    draw_buffer[0] = draw_data(0);
+    draw_buffer.bind(BufferUsage::Storage, 3);
+
+    if(_material->uses_material_table()) {
+        auto material_buffer = frame_allocator().allocate<shader::MaterialParams>();
+        material_buffer[0] = _material->params();
+        material_buffer.bind(BufferUsage::Storage, 4);
+    }
+
+    if(bind(0)) {
+        draw(lod);
+    }
+}
+
+bool SceneObject::bind(u32 first_draw, const Material* previous, StateChangeStats* stats, MaterialPass pass) const {
+    if(!_material || !_mesh) {
+        return false;
+    }
+
+    Program& program = _material->pass_program(pass);
+    program.set_uniform(HASH("first_draw"), first_draw);
+    program.set_uniform(HASH("draw_id"), 0u);
+    _material->bind(previous, stats, pass);
+    return true;
+}
+
+void SceneObject::draw(u32 lod, u32 instance_count) const {
+    _mesh->draw(lod, instance_count);
+}
+
+void SceneObject::draw_indirect(const ByteBuffer& indices, const ByteBuffer& commands, size_t command_index) const {
+    _mesh->draw_indirect(indices, commands, command_index);
+}
+
+shader::DrawData SceneObject::draw_data(u32 first_instance, u32 material_index) const {
+    DEBUG_ASSERT(_mesh);
+
+    shader::DrawData data = {};
+    data.position_min = _mesh->position_min();
+    data.first_instance = first_instance;
+    data.position_extent = _mesh->position_extent();
+    data.material_index = material_index;
+    data.color_offset = _mesh->color_offset();
+    data.has_colors = u32(_mesh->has_colors());
+    return data;
 }
 
 const Material& SceneObject::material() const {
@@ -26,10 +79,33 @@ const Material& SceneObject::material() const {
 
 void SceneObject::set_transform(const glm::mat4& tr) {
     _transform = tr;
+    update_world_bounds();
+}
+
+const StaticMesh* SceneObject::mesh() const {
+    return _mesh.get();
 }
 
 const glm::mat4& SceneObject::transform() const {
     return _transform;
 }
 
+const BoundingSphere& SceneObject::world_bounding_sphere() const {
+    return _world_bounding_sphere;
+}
+
+// The radius is scaled by the largest axis scale, so the sphere stays conservative under non uniform scaling
+void SceneObject::update_world_bounds() {
+    if(!_mesh) {
+        _world_bounding_sphere = {};
+        return;
+    }
+
+    const BoundingSphere& sphere = _mesh->bounding_sphere();
+    const float scale = std::max(glm::length(glm::vec3(_transform[0])), std::max(glm::length(glm::vec3(_transform[1])), glm::length(glm::vec3(_transform[2]))));
+
+    _world_bounding_sphere.center = glm::vec3(_transform * glm::vec4(sphere.center, 1.0f));
+    _world_bounding_sphere.radius = sphere.radius * scale;
+}
+
 }
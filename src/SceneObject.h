@@ -15,15 +15,33 @@ class SceneObject {
     public:
         SceneObject(std::shared_ptr<StaticMesh> mesh = nullptr, std::shared_ptr<Material> material = nullptr);
 
-        void render() const;
+        void render(u32 lod = 0) const;
+
+        // Binds the object's material, see Material::bind. Draws read their DrawData from the draw buffer (storage binding 3)
+        // at first_draw + draw index, which points into the instance buffer (storage binding 2) for model matrices.
+        // Returns false if the object can't be drawn
+        bool bind(u32 first_draw, const Material* previous = nullptr, StateChangeStats* stats = nullptr, MaterialPass pass = MaterialPass::Main) const;
+
+        // Only valid right after bind
+        void draw(u32 lod = 0, u32 instance_count = 1) const;
+        void draw_indirect(const ByteBuffer& indices, const ByteBuffer& commands, size_t command_index) const;
+
+        shader::DrawData draw_data(u32 first_instance, u32 material_index = 0) const;
 
         const Material& material() const;
+        const StaticMesh* mesh() const;
 
         void set_transform(const glm::mat4& tr);
         const glm::mat4& transform() const;
 
+        // Bounding sphere of the mesh in world space, updated with the transform
+        const BoundingSphere& world_bounding_sphere() const;
+
     private:
+        void update_world_bounds();
+
         glm::mat4 _transform = glm::mat4(1.0f);
+        BoundingSphere _world_bounding_sphere;
 
         std::shared_ptr<StaticMesh> _mesh;
         std::shared_ptr<Material> _material;
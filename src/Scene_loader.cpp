@@ -1,304 +1,153 @@
 #include "Scene.h"
-#include "StaticMesh.h"
 
-#include <glm/gtc/quaternion.hpp>
+#include <SceneData.h>
+#include <BakedScene.h>
+#include <TextureUploader.h>
 
-#include <utils.h>
+#include <glad/gl.h>
 
 #include <iostream>
+#include <cmath>
+#include <map>
+#include <tuple>
 
-#ifdef __GNUC__
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wignored-qualifiers"
-#endif
+namespace OM3D {
 
-#define TINYGLTF_IMPLEMENTATION
-#define TINYGLTF_NO_STB_IMAGE_WRITE
-#define TINYGLTF_NOEXCEPTION
-#include <tinygltf/tiny_gltf.h>
+struct TextureSource {
+    std::shared_ptr<const u8> texels;
+    glm::uvec2 size = {};
+    ImageFormat format = ImageFormat::RGBA8_UNORM;
+};
 
-#ifdef __GNUC__
-#pragma GCC diagnostic pop
-#endif
+// Textures are set once they have been uploaded, until then the material uses the default textures
+static std::shared_ptr<Material> create_material(const MaterialData& data) {
+    auto material = std::make_shared<Material>(Material::textured_pbr_material(data.alpha_test));
 
-namespace OM3D {
-
-bool display_gltf_loading_warnings = false;
-
-static size_t component_count(int type) {
-    switch(type) {
-        case TINYGLTF_TYPE_SCALAR: return 1;
-        case TINYGLTF_TYPE_VEC2: return 2;
-        case TINYGLTF_TYPE_VEC3: return 3;
-        case TINYGLTF_TYPE_VEC4: return 4;
-        case TINYGLTF_TYPE_MAT2: return 4;
-        case TINYGLTF_TYPE_MAT3: return 9;
-        case TINYGLTF_TYPE_MAT4: return 16;
-        default: return 0;
+    if(data.blended) {
+        material->set_blend_mode(BlendMode::Alpha);
+        material->set_depth_test_mode(DepthTestMode::None);
     }
-}
 
-static bool decode_attrib_buffer(const tinygltf::Model& gltf, const std::string& name, const tinygltf::Accessor& accessor, Span<Vertex> vertices) {
-    const tinygltf::BufferView& buffer = gltf.bufferViews[accessor.bufferView];
-
-    if(accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
-        if(display_gltf_loading_warnings) {
-            std::cerr << "Unsupported component type (" << accessor.componentType << ") for \"" << name << "\"" << std::endl;
-        }
-        return false;
+    if(data.alpha_test) {
+        material->set_stored_uniform(HASH("alpha_cutoff"), data.alpha_cutoff);
     }
 
-    [[maybe_unused]]
-    const size_t vertex_count = vertices.size();
+    material->set_double_sided(data.double_sided);
 
-    auto decode_attribs =  [&](auto* vertex_elems) {
-        using attrib_type = std::remove_reference_t<decltype(vertex_elems[0])>;
-        using value_type = typename attrib_type::value_type;
-        static constexpr size_t size = sizeof(attrib_type) / sizeof(value_type);
+    material->set_stored_uniform(HASH("base_color_factor"), data.base_color_factor);
+    material->set_stored_uniform(HASH("metal_rough_factor"), data.metal_rough_factor);
+    material->set_stored_uniform(HASH("emissive_factor"), data.emissive_factor);
 
-        const size_t components = component_count(accessor.type);
-        const bool normalize = accessor.normalized;
+    return material;
+}
 
-        DEBUG_ASSERT(accessor.count == vertex_count);
+using TextureUsers = std::vector<std::pair<std::weak_ptr<Material>, u32>>;
 
-        if(components != size) {
-            if(display_gltf_loading_warnings) {
-                std::cerr << "Expected VEC" << size << " attribute, got VEC" << components << std::endl;
-            }
+static void upload_textures(Span<const TextureSource> textures, std::vector<TextureUsers>& texture_users) {
+    for(size_t i = 0; i != textures.size(); ++i) {
+        if(texture_users[i].empty()) {
+            continue;
         }
 
-        const size_t min_size = std::min(size, components);
-        auto convert = [=](const u8* data) {
-            attrib_type vec;
-            for(size_t i = 0; i != min_size; ++i) {
-                vec[int(i)] = reinterpret_cast<const value_type*>(data)[i];
-            }
-            if(normalize) {
-                if constexpr(size == 4) {
-                    const glm::vec3 n = glm::normalize(glm::vec3(vec));
-                    vec[0] = n[0];
-                    vec[1] = n[1];
-                    vec[2] = n[2];
-                } else {
-                    vec = glm::normalize(vec);
+        texture_uploader().upload(textures[i].texels, textures[i].size, textures[i].format, [users = std::move(texture_users[i])](std::shared_ptr<Texture> texture) {
+            for(const auto& [weak_material, slot] : users) {
+                if(const auto material = weak_material.lock()) {
+                    material->set_texture(slot, texture);
                 }
             }
-            return vec;
-        };
-
-        {
-            u8* out_begin = reinterpret_cast<u8*>(vertex_elems);
-
-            const auto& in_buffer = gltf.buffers[buffer.buffer].data;
-            const u8* in_begin = in_buffer.data() + buffer.byteOffset + accessor.byteOffset;
-            const size_t attrib_size = components * sizeof(value_type);
-            const size_t input_stride = buffer.byteStride ? buffer.byteStride : attrib_size;
-
-            for(size_t i = 0; i != accessor.count; ++i) {
-                const u8* attrib = in_begin + i * input_stride;
-                DEBUG_ASSERT(attrib < in_buffer.data() + in_buffer.size());
-                *reinterpret_cast<attrib_type*>(out_begin + i * sizeof(Vertex)) = convert(attrib);
-            }
-        }
-    };
-
-    if(name == "POSITION") {
-        decode_attribs(&vertices[0].position);
-    } else if(name == "NORMAL") {
-        decode_attribs(&vertices[0].normal);
-    } else if(name == "TANGENT") {
-        decode_attribs(&vertices[0].tangent_bitangent_sign);
-    } else if(name == "TEXCOORD_0") {
-        decode_attribs(&vertices[0].uv);
-    } else if(name == "COLOR_0") {
-        decode_attribs(&vertices[0].color);
-    } else {
-        if(display_gltf_loading_warnings) {
-            std::cerr << "Attribute \"" << name << "\" is not supported" << std::endl;
-        }
+        });
     }
-    return true;
 }
 
-static bool decode_index_buffer(const tinygltf::Model& gltf, const tinygltf::Accessor& accessor, Span<u32> indices) {
-    const tinygltf::BufferView& buffer = gltf.bufferViews[accessor.bufferView];
-
-    auto decode_indices = [&](u32 elem_size, auto convert_index) {
-        const u8* in_buffer = gltf.buffers[buffer.buffer].data.data() + buffer.byteOffset + accessor.byteOffset;
-        const size_t input_stride = buffer.byteStride ? buffer.byteStride : elem_size;
-
-        for(size_t i = 0; i != accessor.count; ++i) {
-            indices[i] = convert_index(in_buffer + i * input_stride);
+// Textures with the same size and format (and thus mip count) become layers of the same array
+static void upload_texture_arrays(Span<const TextureSource> textures, std::vector<TextureUsers>& texture_users) {
+    std::map<std::tuple<u32, u32, ImageFormat>, std::vector<u32>> groups;
+    for(size_t i = 0; i != textures.size(); ++i) {
+        if(!texture_users[i].empty()) {
+            groups[{textures[i].size.x, textures[i].size.y, textures[i].format}].push_back(u32(i));
         }
-    };
-
-    switch(accessor.componentType) {
-        case TINYGLTF_PARAMETER_TYPE_BYTE:
-        case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE:
-            decode_indices(1, [](const u8* data) -> u32 { return *data; });
-        break;
-
-        case TINYGLTF_PARAMETER_TYPE_SHORT:
-        case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT:
-            decode_indices(2, [](const u8* data) -> u32 { return *reinterpret_cast<const u16*>(data); });
-        break;
-
-        case TINYGLTF_PARAMETER_TYPE_INT:
-        case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT:
-            decode_indices(4, [](const u8* data) -> u32 { return *reinterpret_cast<const u32*>(data); });
-        break;
-
-        default:
-            std::cerr << "Index component type not supported" << std::endl;
-            return false;
     }
 
-    return true;
-}
-
-static Result<MeshData> build_mesh_data(const tinygltf::Model& gltf, const tinygltf::Primitive& prim) {
-    std::vector<Vertex> vertices;
-    for(auto&& [name, id] : prim.attributes) {
-        tinygltf::Accessor accessor = gltf.accessors[id];
-        if(!accessor.count) {
-            continue;
-        }
-
-        if(accessor.sparse.isSparse) {
-            return {false, {}};
-        }
-
-        if(!vertices.size()) {
-            std::fill_n(std::back_inserter(vertices), accessor.count, Vertex{});
-        } else if(vertices.size() != accessor.count) {
-            return {false, {}};
-        }
+    int max_layers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
 
-        if(!decode_attrib_buffer(gltf, name, accessor, vertices)) {
-            return {false, {}};
-        }
-    }
-
-    std::vector<u32> indices;
-    {
-        tinygltf::Accessor accessor = gltf.accessors[prim.indices];
-        if(!accessor.count || accessor.sparse.isSparse) {
-            return {false, {}};
-        }
+    size_t array_count = 0;
+    size_t layer_count = 0;
+    for(const auto& [key, indices] : groups) {
+        for(size_t first = 0; first < indices.size(); first += size_t(max_layers)) {
+            const u32 layers = u32(std::min(indices.size() - first, size_t(max_layers)));
+            const TextureSource& source = textures[indices[first]];
+            auto array = std::make_shared<Texture>(Texture::empty_array(source.size, layers, source.format));
 
-        if(!indices.size()) {
-            std::fill_n(std::back_inserter(indices), accessor.count, u32(0));
-        } else if(indices.size() != accessor.count) {
-            return {false, {}};
-        }
+            for(u32 layer = 0; layer != layers; ++layer) {
+                const u32 index = indices[first + layer];
+                texture_uploader().upload_layer(array, layer, textures[index].texels, [layer, users = std::move(texture_users[index])](std::shared_ptr<Texture> texture) {
+                    for(const auto& [weak_material, slot] : users) {
+                        if(const auto material = weak_material.lock()) {
+                            material->set_texture(slot, texture, layer);
+                        }
+                    }
+                });
+            }
 
-        if(!decode_index_buffer(gltf, accessor, indices)) {
-            return {false, {}};
+            ++array_count;
+            layer_count += layers;
         }
     }
 
-    return {true, MeshData{std::move(vertices), std::move(indices)}};
+    std::cout << layer_count << " textures packed in " << array_count << " texture arrays" << std::endl;
 }
 
-static Result<TextureData> build_texture_data(const tinygltf::Image& image, bool as_sRGB) {
-    if(image.bits != 8 && image.pixel_type != TINYGLTF_COMPONENT_TYPE_BYTE && image.pixel_type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-        std::cerr << "Unsupported image format (pixel type)" << std::endl;
-        return {false, {}};
-    }
-
-    ImageFormat format = ImageFormat::RGBA8_UNORM;
-    switch(image.component) {
-        case 3:
-            format = as_sRGB ? ImageFormat::RGB8_sRGB : ImageFormat::RGB8_UNORM;
-        break;
-
-        case 4:
-            format = as_sRGB ? ImageFormat::RGBA8_sRGB : ImageFormat::RGBA8_UNORM;
-        break;
-
-        default:
-            std::cerr << "Unsupported image format (components)" << std::endl;
-            return {false, {}};
-    }
-
-    auto data = std::make_unique<u8[]>(image.image.size());
-    std::copy(image.image.begin(), image.image.end(), data.get());
-
-    return {true, TextureData{std::move(data), glm::uvec2(image.width, image.height), format}};
-}
+// Creates every GL object needed by the scene, meshes have already been uploaded
+static std::unique_ptr<Scene> create_scene(Span<const std::shared_ptr<StaticMesh>> meshes,
+                                           Span<const TextureSource> textures,
+                                           Span<const MaterialData> material_data,
+                                           Span<const ObjectData> objects,
+                                           Span<const PointLight> point_lights) {
 
+    auto scene = std::make_unique<Scene>();
 
-static glm::mat4 parse_node_matrix(const tinygltf::Node& node) {
-    glm::vec3 translation(0.0f, 0.0f, 0.0f);
-    for(u32 k = 0; k != node.translation.size(); ++k) {
-        translation[k] = float(node.translation[k]);
+    {
+        size_t mesh_bytes = 0;
+        for(const auto& mesh : meshes) {
+            mesh_bytes += mesh->gpu_byte_size();
+        }
+        std::cout << meshes.size() << " meshes use " << std::round(double(mesh_bytes) / (1024.0 * 1024.0) * 100.0) / 100.0 << "MB of GPU memory"
+                  << (compact_vertex_format ? " (compact vertices)" : " (float vertices)") << std::endl;
     }
 
-    glm::vec3 scale(1.0f, 1.0f, 1.0f);
-    for(u32 k = 0; k != node.scale.size(); ++k) {
-        scale[k] = float(node.scale[k]);
+    std::vector<std::shared_ptr<Material>> materials;
+    std::vector<TextureUsers> texture_users(textures.size());
+    for(const MaterialData& data : material_data) {
+        const auto& material = materials.emplace_back(create_material(data));
+        for(u32 slot = 0; slot != data.textures.size(); ++slot) {
+            if(const i32 index = data.textures[slot]; index >= 0) {
+                texture_users[index].emplace_back(material, slot);
+            }
+        }
     }
 
-    glm::vec4 rotation(0.0f, 0.0f, 0.0f, 1.0f);
-    for(u32 k = 0; k != node.rotation.size(); ++k) {
-        rotation[k] = float(node.rotation[k]);
+    if(texture_arrays_enabled()) {
+        upload_texture_arrays(textures, texture_users);
+    } else {
+        upload_textures(textures, texture_users);
     }
 
-    const glm::tquat<float> q(rotation.w, rotation.x, rotation.y, rotation.z);
-    return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(q) * glm::scale(glm::mat4(1.0f), scale);
-}
-
-static glm::mat4 base_transform() {
-    return glm::mat4(1.0f);
-}
-
-static void parse_node_transforms(int node_index, const tinygltf::Model& gltf, std::unordered_map<int, glm::mat4>& node_transforms, const glm::mat4& parent_transform = base_transform()) {
-    const tinygltf::Node& node = gltf.nodes[node_index];
-    const glm::mat4 transform = parent_transform * parse_node_matrix(node);
-    node_transforms[node_index] = transform;
-    for(int child : node.children)  {
-        parse_node_transforms(child, gltf, node_transforms, transform);
+    const std::shared_ptr<Material> default_material = std::make_shared<Material>(Material::textured_pbr_material());
+    for(const ObjectData& object : objects) {
+        auto scene_object = SceneObject(meshes[object.mesh], object.material >= 0 ? materials[object.material] : default_material);
+        scene_object.set_transform(object.transform);
+        scene->add_object(std::move(scene_object));
     }
-}
 
-static void compute_tangents(MeshData& mesh) {
-    for(Vertex& vert : mesh.vertices) {
-        vert.tangent_bitangent_sign = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+    for(const PointLight& light : point_lights) {
+        scene->add_light(light);
     }
 
-    for(size_t i = 0; i < mesh.indices.size(); i += 3) {
-        const u32 tri[] = {
-            mesh.indices[i + 0],
-            mesh.indices[i + 1],
-            mesh.indices[i + 2]
-        };
-
-        const glm::vec3 edges[] = {
-            mesh.vertices[tri[1]].position - mesh.vertices[tri[0]].position,
-            mesh.vertices[tri[2]].position - mesh.vertices[tri[0]].position
-        };
-
-        const glm::vec2 uvs[] = {
-            mesh.vertices[tri[0]].uv,
-            mesh.vertices[tri[1]].uv,
-            mesh.vertices[tri[2]].uv
-        };
-
-        const float dt[] = {
-            uvs[1].y - uvs[0].y,
-            uvs[2].y - uvs[0].y
-        };
-
-        const glm::vec3 tangent = -glm::normalize((edges[0] * dt[1]) - (edges[1] * dt[0]));
-        mesh.vertices[tri[0]].tangent_bitangent_sign += glm::vec4(tangent, 0.0f);
-        mesh.vertices[tri[1]].tangent_bitangent_sign += glm::vec4(tangent, 0.0f);
-        mesh.vertices[tri[2]].tangent_bitangent_sign += glm::vec4(tangent, 0.0f);
-    }
+    // Build the hierarchy while loading rather than on the first frame
+    scene->bvh();
 
-    for(Vertex& vert : mesh.vertices) {
-        const glm::vec3 tangent = vert.tangent_bitangent_sign;
-        vert.tangent_bitangent_sign = glm::vec4(glm::normalize(tangent), 1.0f);
-    }
+    return scene;
 }
 
 
@@ -306,223 +155,57 @@ Result<std::unique_ptr<Scene>> Scene::from_gltf(const std::string& file_name) {
     const double time = program_time();
     DEFER(std::cout << file_name << " loaded in " << std::round((program_time() - time) * 100.0) / 100.0 << "s" << std::endl);
 
-    tinygltf::TinyGLTF ctx;
-    tinygltf::Model gltf;
-
-    {
-        std::string err;
-        std::string warn;
-
-        const bool is_ascii = ends_with(file_name, ".gltf");
-        const bool ok = is_ascii
-                ? ctx.LoadASCIIFromFile(&gltf, &err, &warn, file_name)
-                : ctx.LoadBinaryFromFile(&gltf, &err, &warn, file_name);
-
-        if(!err.empty()) {
-            std::cerr << "Error while loading gltf: " << err << std::endl;
-        }
-        if(!warn.empty()) {
-            std::cerr << "Warning while loading gltf: " << warn << std::endl;
-        }
+    auto data = SceneData::from_gltf(file_name);
+    if(!data.is_ok) {
+        return {false, {}};
+    }
 
-        if(!ok) {
-            return {false, {}};
-        }
+    std::vector<std::shared_ptr<StaticMesh>> meshes;
+    for(const MeshData& mesh : data.value.meshes) {
+        meshes.emplace_back(std::make_shared<StaticMesh>(mesh));
     }
 
-    std::cout << file_name << " parsed in " << std::round((program_time() - time) * 100.0) / 100.0 << "s" << std::endl;
+    std::vector<TextureSource> textures;
+    for(TextureData& texture : data.value.textures) {
+        textures.push_back(TextureSource{
+            std::shared_ptr<const u8>(texture.data.release(), TextureData::TexelDeleter()),
+            texture.size,
+            texture.format
+        });
+    }
 
-    auto scene = std::make_unique<Scene>();
+    return {true, create_scene(meshes, textures, data.value.materials, data.value.objects, data.value.point_lights)};
+}
 
-    std::unordered_map<int, std::shared_ptr<Texture>> textures;
-    std::unordered_map<int, std::shared_ptr<Material>> materials;
-    std::unordered_map<int, glm::mat4> node_transforms;
-    std::vector<std::pair<int, int>> light_nodes;
+Result<std::unique_ptr<Scene>> Scene::from_baked(const std::string& file_name) {
+    const double time = program_time();
+    DEFER(std::cout << file_name << " loaded in " << std::round((program_time() - time) * 1000.0) / 1000.0 << "s" << std::endl);
 
+    std::shared_ptr<const BakedScene> baked;
     {
-        std::vector<int> node_indices;
-        if(gltf.defaultScene >= 0) {
-            node_indices = gltf.scenes[gltf.defaultScene].nodes;
-        } else {
-            for(u32 i = 0; i != gltf.nodes.size(); ++i) {
-                node_indices.push_back(i);
-                node_transforms[i] = base_transform();
-            }
-        }
-
-        for(const int node_index : node_indices) {
-            parse_node_transforms(node_index, gltf, node_transforms);
-        }
-
-        for(const int node_index : node_indices) {
-            const auto& node = gltf.nodes[node_index];
-            if(const auto it = node.extensions.find("KHR_lights_punctual"); it != node.extensions.end()) {
-                const int light_index = it->second.Get("light").Get<int>();
-                if(light_index < 0 || light_index >= static_cast<int>(gltf.lights.size())) {
-                    continue;
-                }
-                light_nodes.emplace_back(std::pair{node_index, light_index});
-            }
+        auto r = BakedScene::open(file_name);
+        if(!r.is_ok) {
+            return {false, {}};
         }
+        baked = std::make_shared<const BakedScene>(std::move(r.value));
     }
 
-    const std::string emissive_strength_ext_name = "KHR_materials_emissive_strength";
-
-    for(auto [node_index, node_transform] : node_transforms) {
-        const tinygltf::Node& node = gltf.nodes[node_index];
-
-        if(node.mesh < 0) {
-            continue;
-        }
-
-        const tinygltf::Mesh& mesh = gltf.meshes[node.mesh];
-
-        const std::shared_ptr<Material> default_material = std::make_shared<Material>(Material::textured_pbr_material());
-        for(size_t j = 0; j != mesh.primitives.size(); ++j) {
-            const tinygltf::Primitive& prim = mesh.primitives[j];
-
-            if(prim.mode != TINYGLTF_MODE_TRIANGLES) {
-                continue;
-            }
-
-            auto mesh = build_mesh_data(gltf, prim);
-            if(!mesh.is_ok) {
-                return {false, {}};
-            }
-
-            if(mesh.value.vertices[0].tangent_bitangent_sign == glm::vec4(0.0f)) {
-                compute_tangents(mesh.value);
-            }
-
-            std::shared_ptr<Material> material = default_material;
-            if(prim.material >= 0) {
-                auto& mat = materials[prim.material];
-
-                if(!mat) {
-                    const auto& gltf_mat = gltf.materials[prim.material];
-                    const auto& albedo_info = gltf_mat.pbrMetallicRoughness.baseColorTexture;
-                    const auto& normal_info = gltf_mat.normalTexture;
-                    const auto& metal_rough_info = gltf_mat.pbrMetallicRoughness.metallicRoughnessTexture;
-                    const auto& emissive_info = gltf_mat.emissiveTexture;
-
-                    auto load_texture = [&](auto texture_info, bool as_sRGB) -> std::shared_ptr<Texture> {
-                        if(texture_info.texCoord != 0) {
-                            std::cerr << "Unsupported texture coordinate channel (" << texture_info.texCoord << ")" << std::endl;
-                            return nullptr;
-                        }
-
-                        if(texture_info.index < 0) {
-                            return nullptr;
-                        }
-
-                        const int index = gltf.textures[texture_info.index].source;
-                        if(index < 0) {
-                            return nullptr;
-                        }
-
-                        auto& texture = textures[index];
-                        if(!texture) {
-                            if(const auto r = build_texture_data(gltf.images[index], as_sRGB); r.is_ok) {
-                                texture = std::make_shared<Texture>(r.value);
-                            }
-                        }
-                        return texture;
-                    };
-
-                    const bool opaque = (gltf_mat.alphaMode == "OPAQUE") || (gltf_mat.alphaMode == "NONE");
-                    const bool mask = (gltf_mat.alphaMode == "MASK");
-                    const bool alpha_test = !opaque || mask;
-
-                    auto albedo = load_texture(albedo_info, true);
-                    auto normal = load_texture(normal_info, false);
-                    auto metal_rough = load_texture(metal_rough_info, false);
-                    auto emissive = load_texture(emissive_info, false);
-
-
-                    mat = std::make_shared<Material>(Material::textured_pbr_material(alpha_test));
-
-                    if(!opaque && !mask) {
-                        mat->set_blend_mode(BlendMode::Alpha);
-                        mat->set_depth_test_mode(DepthTestMode::None);
-                    }
-
-                    if(albedo) {
-                        mat->set_texture(0u, albedo);
-                    }
-
-                    if(normal) {
-                        mat->set_texture(1u, normal);
-                    }
-
-                    if(metal_rough) {
-                        mat->set_texture(2u, metal_rough);
-                    }
-
-                    if(emissive) {
-                        mat->set_texture(3u, emissive);
-                    }
-
-
-                    if(alpha_test) {
-                        mat->set_stored_uniform(HASH("alpha_cutoff"), float(gltf_mat.alphaCutoff));
-                    }
-
-                    mat->set_double_sided(gltf_mat.doubleSided);
-
-                    mat->set_stored_uniform(HASH("base_color_factor"), glm::vec3(
-                        gltf_mat.pbrMetallicRoughness.baseColorFactor[0],
-                        gltf_mat.pbrMetallicRoughness.baseColorFactor[1],
-                        gltf_mat.pbrMetallicRoughness.baseColorFactor[2]
-                    ));
-
-                    mat->set_stored_uniform(HASH("metal_rough_factor"), glm::vec2(
-                        gltf_mat.pbrMetallicRoughness.metallicFactor,
-                        gltf_mat.pbrMetallicRoughness.roughnessFactor
-                    ));
-
-
-
-                    float emissive_factor = 1.0f;
-                    if(const auto it = gltf_mat.extensions.find(emissive_strength_ext_name); it != gltf_mat.extensions.end()) {
-                        emissive_factor = float(it->second.Get("emissiveStrength").GetNumberAsDouble());
-                    }
-
-                    mat->set_stored_uniform(HASH("emissive_factor"), glm::vec3(
-                        gltf_mat.emissiveFactor[0],
-                        gltf_mat.emissiveFactor[1],
-                        gltf_mat.emissiveFactor[2]
-                    ) * emissive_factor);
-                }
-
-                material = mat;
-            }
-
-            auto scene_object = SceneObject(std::make_shared<StaticMesh>(mesh.value), std::move(material));
-            scene_object.set_transform(node_transform);
-            scene->add_object(std::move(scene_object));
-        }
+    // Upload straight from the mapped file, which is kept alive until every texture has been streamed
+    std::vector<std::shared_ptr<StaticMesh>> meshes;
+    for(u32 i = 0; i != baked->mesh_count(); ++i) {
+        meshes.emplace_back(std::make_shared<StaticMesh>(baked->vertices(i), baked->indices(i), baked->meshlets(i), baked->lods(i)));
     }
 
-    for(auto [node_index, light_index] : light_nodes) {
-        const auto& gltf_light = gltf.lights[light_index];
-
-        const glm::vec3 color = glm::vec3(float(gltf_light.color[0]), float(gltf_light.color[1]), float(gltf_light.color[2])) * float(gltf_light.intensity);;
-
-        PointLight light;
-        light.set_position(node_transforms[node_index][3]);
-        light.set_color(color);
-        if(gltf_light.range > 0.0) {
-            light.set_radius(float(gltf_light.range));
-        } else {
-            const float intensity = glm::dot(color, glm::vec3(1.0f));
-            light.set_radius(std::sqrt(intensity * 100.0f)); // Put radius where lum < 1%
-        }
-        scene->add_light(light);
+    std::vector<TextureSource> textures;
+    for(u32 i = 0; i != baked->texture_count(); ++i) {
+        textures.push_back(TextureSource{
+            std::shared_ptr<const u8>(baked, baked->texels(i).data()),
+            baked->texture_size(i),
+            baked->texture_format(i)
+        });
     }
 
-
-    return {true, std::move(scene)};
+    return {true, create_scene(meshes, textures, baked->materials(), baked->objects(), baked->point_lights())};
 }
 
 }
-
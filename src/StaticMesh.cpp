@@ -1,42 +1,224 @@
 #include "StaticMesh.h"
+#include "GeometryPool.h"
 
 #include <glad/gl.h>
 
+#include <glm/packing.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 namespace OM3D {
 
 extern bool audit_bindings_before_draw;
 
-StaticMesh::StaticMesh(const MeshData& data) :
-    _vertex_buffer(data.vertices),
-    _index_buffer(data.indices) {
+bool compact_vertex_format = true;
+
+static glm::vec2 oct_encode(const glm::vec3& v) {
+    const float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+    if(!(l1 > 0.0f)) {
+        return glm::vec2(0.0f);
+    }
+
+    const glm::vec3 n = v / l1;
+    if(n.z >= 0.0f) {
+        return glm::vec2(n);
+    }
+
+    return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                     (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
 }
 
-void StaticMesh::draw() const {
-    _vertex_buffer.bind(BufferUsage::Attribute);
-    _index_buffer.bind(BufferUsage::Index);
+static i16 to_snorm16(float x) {
+    return i16(std::round(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+}
+
+static u16 to_unorm16(float x) {
+    return u16(std::round(std::clamp(x, 0.0f, 1.0f) * 65535.0f));
+}
+
+StaticMesh::StaticMesh(const MeshData& data) : StaticMesh(data.vertices, data.indices, data.meshlets, data.lods) {
+}
+
+StaticMesh::StaticMesh(Span<const Vertex> vertices, Span<const u32> indices, Span<const shader::Meshlet> meshlets, Span<const MeshLod> lods) :
+        _lods(lods.begin(), lods.end()),
+        _meshlet_count(u32(meshlets.size())) {
+
+    if(_lods.empty()) {
+        _lods.push_back({0, u32(indices.size()), 0.0f});
+    }
+
+    if(!meshlets.is_empty()) {
+        _meshlet_buffer = ByteBuffer(meshlets.data(), meshlets.size() * sizeof(shader::Meshlet));
+    }
+
+    glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 max = glm::vec3(std::numeric_limits<float>::lowest());
+    bool has_colors = false;
+    for(const Vertex& vert : vertices) {
+        min = glm::min(min, vert.position);
+        max = glm::max(max, vert.position);
+        has_colors |= vert.color != glm::vec3(1.0f);
+    }
+
+    if(!vertices.is_empty()) {
+        _position_min = min;
+        _position_extent = max - min;
+
+        _bounding_sphere.center = (min + max) * 0.5f;
+        for(const Vertex& vert : vertices) {
+            _bounding_sphere.radius = std::max(_bounding_sphere.radius, glm::length(vert.position - _bounding_sphere.center));
+        }
+    }
+
+    GeometryPool& pool = geometry_pool();
+    if(!pool.has_compact_vertices()) {
+        _geometry = pool.allocate(vertices.data(), nullptr, u32(vertices.size()), indices);
+        return;
+    }
+
+    const glm::vec3 inv_extent = glm::vec3(
+        _position_extent.x > 0.0f ? 1.0f / _position_extent.x : 0.0f,
+        _position_extent.y > 0.0f ? 1.0f / _position_extent.y : 0.0f,
+        _position_extent.z > 0.0f ? 1.0f / _position_extent.z : 0.0f
+    );
+
+    std::vector<CompactVertex> compact(vertices.size());
+    for(size_t i = 0; i != vertices.size(); ++i) {
+        const Vertex& vert = vertices[i];
+        CompactVertex& out = compact[i];
+
+        const glm::vec3 pos = (vert.position - _position_min) * inv_extent;
+        out.position[0] = to_unorm16(pos.x);
+        out.position[1] = to_unorm16(pos.y);
+        out.position[2] = to_unorm16(pos.z);
+        out.position[3] = vert.tangent_bitangent_sign.w > 0.0f ? u16(65535) : u16(0);
 
-    // Vertex position
-    glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex), nullptr);
-    // Vertex normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, false, sizeof(Vertex), reinterpret_cast<void*>(3 * sizeof(float)));
-    // Vertex uv
-    glVertexAttribPointer(2, 2, GL_FLOAT, false, sizeof(Vertex), reinterpret_cast<void*>(6 * sizeof(float)));
-    // Tangent / bitangent sign
-    glVertexAttribPointer(3, 4, GL_FLOAT, false, sizeof(Vertex), reinterpret_cast<void*>(8 * sizeof(float)));
-    // Vertex color
-    glVertexAttribPointer(4, 3, GL_FLOAT, false, sizeof(Vertex), reinterpret_cast<void*>(12 * sizeof(float)));
+        const glm::vec2 normal = oct_encode(vert.normal);
+        out.normal[0] = to_snorm16(normal.x);
+        out.normal[1] = to_snorm16(normal.y);
 
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
-    glEnableVertexAttribArray(4);
+        const glm::vec2 tangent = oct_encode(glm::vec3(vert.tangent_bitangent_sign));
+        out.tangent[0] = to_snorm16(tangent.x);
+        out.tangent[1] = to_snorm16(tangent.y);
+
+        out.uv = glm::packHalf2x16(vert.uv);
+    }
+
+    std::vector<u32> colors;
+    if(has_colors) {
+        colors.resize(vertices.size());
+        for(size_t i = 0; i != vertices.size(); ++i) {
+            colors[i] = glm::packUnorm4x8(glm::vec4(vertices[i].color, 1.0f));
+        }
+    }
+
+    _geometry = pool.allocate(compact.data(), has_colors ? colors.data() : nullptr, u32(vertices.size()), indices);
+}
+
+void StaticMesh::draw(u32 lod, u32 instance_count) const {
+    DEBUG_ASSERT(lod < _lods.size());
+
+    geometry_pool().bind_vertex_attribs();
+    geometry_pool().bind_index_buffer(has_short_indices());
 
     if(audit_bindings_before_draw) {
         audit_bindings();
     }
 
-    glDrawElements(GL_TRIANGLES, int(_index_buffer.element_count()), GL_UNSIGNED_INT, nullptr);
+    const shader::DrawElementsIndirectCommand command = draw_command(lod, instance_count);
+    const size_t index_size = has_short_indices() ? sizeof(u16) : sizeof(u32);
+    const void* offset = reinterpret_cast<const void*>(command.first_index * index_size);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, int(command.count), index_type(), offset, int(command.instance_count), command.base_vertex);
+}
+
+void StaticMesh::draw_indirect(const ByteBuffer& indices, const ByteBuffer& commands, size_t command_index) const {
+    geometry_pool().bind_vertex_attribs();
+    indices.bind(BufferUsage::Index);
+    commands.bind(BufferUsage::Indirect);
+
+    if(audit_bindings_before_draw) {
+        audit_bindings();
+    }
+
+    glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<void*>(command_index * sizeof(shader::DrawElementsIndirectCommand)));
+}
+
+shader::DrawElementsIndirectCommand StaticMesh::draw_command(u32 lod, u32 instance_count) const {
+    DEBUG_ASSERT(lod < _lods.size());
+
+    shader::DrawElementsIndirectCommand command = {};
+    command.count = _lods[lod].index_count;
+    command.instance_count = instance_count;
+    command.first_index = first_index() + _lods[lod].first_index;
+    command.base_vertex = i32(base_vertex());
+    return command;
+}
+
+u32 StaticMesh::index_count(u32 lod) const {
+    return _lods[lod].index_count;
+}
+
+u32 StaticMesh::meshlet_count() const {
+    return _meshlet_count;
+}
+
+u32 StaticMesh::lod_count() const {
+    return u32(_lods.size());
+}
+
+const MeshLod& StaticMesh::lod(u32 index) const {
+    DEBUG_ASSERT(index < _lods.size());
+    return _lods[index];
+}
+
+const BoundingSphere& StaticMesh::bounding_sphere() const {
+    return _bounding_sphere;
+}
+
+void StaticMesh::bind_meshlets(u32 meshlet_binding, u32 index_binding) const {
+    DEBUG_ASSERT(_meshlet_count);
+    _meshlet_buffer.bind(BufferUsage::Storage, meshlet_binding);
+    geometry_pool().bind_index_storage(has_short_indices(), index_binding);
+}
+
+bool StaticMesh::has_short_indices() const {
+    return _geometry.has_short_indices();
+}
+
+u32 StaticMesh::index_type() const {
+    return has_short_indices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+u32 StaticMesh::base_vertex() const {
+    return _geometry.vertices().first;
+}
+
+u32 StaticMesh::first_index() const {
+    return _geometry.indices().first;
+}
+
+const glm::vec3& StaticMesh::position_min() const {
+    return _position_min;
+}
+
+const glm::vec3& StaticMesh::position_extent() const {
+    return _position_extent;
+}
+
+bool StaticMesh::has_colors() const {
+    return _geometry.colors().count != 0;
+}
+
+i32 StaticMesh::color_offset() const {
+    return i32(_geometry.colors().first) - i32(_geometry.vertices().first);
+}
+
+size_t StaticMesh::gpu_byte_size() const {
+    const size_t index_size = has_short_indices() ? sizeof(u16) : sizeof(u32);
+    return _geometry.vertices().count * geometry_pool().vertex_byte_size() + _geometry.colors().count * sizeof(u32) + _geometry.indices().count * index_size;
 }
 
 }
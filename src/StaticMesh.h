@@ -2,16 +2,36 @@
 #define STATICMESH_H
 
 #include <graphics.h>
-#include <TypedBuffer.h>
+#include <GeometryPool.h>
 #include <Vertex.h>
+#include <shader_structs.h>
 
 #include <vector>
 
 namespace OM3D {
 
+static constexpr u32 max_lod_count = 5;
+
+// Range of the index buffer drawn at a given level of detail
+struct MeshLod {
+    u32 first_index = 0;
+    u32 index_count = 0;
+    // Estimated distance to the full resolution surface, in mesh units (see build_lods)
+    float error = 0.0f;
+    u32 padding = 0;
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
 struct MeshData {
     std::vector<Vertex> vertices;
     std::vector<u32> indices;
+    std::vector<shader::Meshlet> meshlets;
+    // Empty if the mesh has a single level covering every index
+    std::vector<MeshLod> lods;
 };
 
 class StaticMesh : NonCopyable {
@@ -22,14 +42,58 @@ class StaticMesh : NonCopyable {
         StaticMesh& operator=(StaticMesh&&) = default;
 
         StaticMesh(const MeshData& data);
+        StaticMesh(Span<const Vertex> vertices, Span<const u32> indices, Span<const shader::Meshlet> meshlets = {}, Span<const MeshLod> lods = {});
+
+        void draw(u32 lod = 0, u32 instance_count = 1) const;
+
+        // Draws using an index buffer and indirect command written by MeshletCuller
+        void draw_indirect(const ByteBuffer& indices, const ByteBuffer& commands, size_t command_index) const;
+
+        // Indirect command drawing the given level of detail from the geometry pool's buffers
+        shader::DrawElementsIndirectCommand draw_command(u32 lod, u32 instance_count) const;
+
+        u32 index_count(u32 lod = 0) const;
+        u32 meshlet_count() const;
 
-        void draw() const;
+        // Level 0 is the full resolution mesh, meshlets only cover it
+        u32 lod_count() const;
+        const MeshLod& lod(u32 index) const;
+
+        const BoundingSphere& bounding_sphere() const;
+
+        // Binds the meshlets and the pool's index buffer as storage buffers, for culling
+        void bind_meshlets(u32 meshlet_binding, u32 index_binding) const;
+        bool has_short_indices() const;
+        u32 index_type() const;
+
+        // Location of the mesh in the geometry pool, indices are relative to the base vertex
+        u32 base_vertex() const;
+        u32 first_index() const;
+
+        // Vertex colors are at gl_VertexID + color_offset() in the pool's color stream, only for compact meshes that have some
+        bool has_colors() const;
+        i32 color_offset() const;
+
+        // Compact vertex positions are quantized within [position_min; position_min + position_extent]
+        const glm::vec3& position_min() const;
+        const glm::vec3& position_extent() const;
+
+        size_t gpu_byte_size() const;
 
     private:
-        TypedBuffer<Vertex> _vertex_buffer;
-        TypedBuffer<u32> _index_buffer;
+        GeometryAllocation _geometry;
+        ByteBuffer _meshlet_buffer;
+        std::vector<MeshLod> _lods;
+        u32 _meshlet_count = 0;
+
+        glm::vec3 _position_min = glm::vec3(0.0f);
+        glm::vec3 _position_extent = glm::vec3(1.0f);
+        BoundingSphere _bounding_sphere;
 };
 
+// The geometry pool stores CompactVertex if this is set when graphics are initialized, must match Material::textured_pbr_material
+extern bool compact_vertex_format;
+
 }
 
 #endif // STATICMESH_H
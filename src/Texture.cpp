@@ -1,5 +1,6 @@
 #include "Texture.h"
 #include "Program.h"
+#include "GLState.h"
 
 #include <glad/gl.h>
 
@@ -15,19 +16,15 @@ Result<TextureData> TextureData::from_file(const std::string& file) {
     int width = 0;
     int height = 0;
     int channels = 0;
-    u8* img = stbi_load(file.c_str(), &width, &height, &channels, 4);
-    DEFER(stbi_image_free(img));
+    TexelBuffer img(stbi_load(file.c_str(), &width, &height, &channels, 4));
     if(!img || width <= 0 || height <= 0 || channels <= 0) {
         return {false, {}};
     }
 
-    const size_t bytes = width * height * 4;
-
     TextureData data;
     data.size = glm::uvec2(width, height);
     data.format = ImageFormat::RGBA8_UNORM;
-    data.data = std::make_unique<u8[]>(bytes);
-    std::copy_n(img, bytes, data.data.get());
+    data.data = std::move(img);
 
     return {true, std::move(data)};
 }
@@ -39,15 +36,18 @@ static GLuint create_texture_handle(GLenum type) {
     return handle;
 }
 
-Texture::Texture(const TextureData& data) :
+Texture::Texture(const TextureData& data) : Texture(data.data.get(), data.size, data.format) {
+}
+
+Texture::Texture(const void* texels, const glm::uvec2& size, ImageFormat format) :
     _handle(create_texture_handle(GL_TEXTURE_2D)),
-    _size(data.size),
-    _format(data.format),
+    _size(size),
+    _format(format),
     _texture_type(GL_TEXTURE_2D) {
 
     const ImageFormatGL gl_format = image_format_to_gl(_format);
     glTextureStorage2D(_handle.get(), mip_levels(_size), gl_format.internal_format, _size.x, _size.y);
-    glTextureSubImage2D(_handle.get(), 0, 0, 0, _size.x, _size.y, gl_format.format, gl_format.component_type, data.data.get());
+    glTextureSubImage2D(_handle.get(), 0, 0, 0, _size.x, _size.y, gl_format.format, gl_format.component_type, texels);
 
     glGenerateTextureMipmap(_handle.get());
 
@@ -71,6 +71,12 @@ Texture::Texture(const glm::uvec2 &size, ImageFormat format, WrapMode wrap) :
     glTextureParameteri(_handle.get(), GL_TEXTURE_WRAP_S, gl_wrap);
     glTextureParameteri(_handle.get(), GL_TEXTURE_WRAP_T, gl_wrap);
 
+    // Integer textures are incomplete with linear filtering
+    if(is_integer_format(_format)) {
+        glTextureParameteri(_handle.get(), GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTextureParameteri(_handle.get(), GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+
     if(bindless_enabled()) {
         _bindless = glGetTextureHandleARB(_handle.get());
         glMakeTextureHandleResidentARB(_bindless);
@@ -78,6 +84,26 @@ Texture::Texture(const glm::uvec2 &size, ImageFormat format, WrapMode wrap) :
 }
 
 
+Texture Texture::empty(const glm::uvec2& size, ImageFormat format, u32 mipmaps) {
+    Texture tex;
+    {
+        tex._handle = GLHandle(create_texture_handle(GL_TEXTURE_2D));
+        tex._texture_type = GL_TEXTURE_2D;
+        tex._size = size;
+        tex._format = format;
+    }
+
+    const ImageFormatGL gl_format = image_format_to_gl(tex._format);
+    glTextureStorage2D(tex._handle.get(), std::min(mipmaps, mip_levels(tex._size)), gl_format.internal_format, tex._size.x, tex._size.y);
+
+    if(bindless_enabled()) {
+        tex._bindless = glGetTextureHandleARB(tex._handle.get());
+        glMakeTextureHandleResidentARB(tex._bindless);
+    }
+
+    return tex;
+}
+
 Texture Texture::empty_cubemap(u32 size, ImageFormat format, u32 mipmaps) {
     Texture cube;
     {
@@ -123,8 +149,31 @@ Texture Texture::cubemap_from_equirec(const Texture& equirec) {
 }
 
 
+Texture Texture::empty_array(const glm::uvec2& size, u32 layers, ImageFormat format) {
+    Texture array;
+    {
+        array._handle = GLHandle(create_texture_handle(GL_TEXTURE_2D_ARRAY));
+        array._texture_type = GL_TEXTURE_2D_ARRAY;
+        array._size = size;
+        array._format = format;
+        array._layers = layers;
+    }
+
+    const ImageFormatGL gl_format = image_format_to_gl(array._format);
+    glTextureStorage3D(array._handle.get(), mip_levels(array._size), gl_format.internal_format, array._size.x, array._size.y, array._layers);
+
+    if(bindless_enabled()) {
+        array._bindless = glGetTextureHandleARB(array._handle.get());
+        glMakeTextureHandleResidentARB(array._bindless);
+    }
+
+    return array;
+}
+
+
 Texture::~Texture() {
     if(auto handle = _handle.get()) {
+        gl_state().forget_texture(handle);
         glDeleteTextures(1, &handle);
     }
 }
@@ -134,11 +183,38 @@ bool Texture::is_null() const {
 }
 
 void Texture::bind(u32 index) const {
-    glBindTextureUnit(index, _handle.get());
+    gl_state().bind_texture(index, _handle.get());
 }
 
-void Texture::bind_as_image(u32 index, AccessType access) {
-    glBindImageTexture(index, _handle.get(), 0, texture_type() != GL_TEXTURE_2D, 0, access_type_to_gl(access), image_format_to_gl(_format).internal_format);
+void Texture::set_layer(u32 layer, const void* texels) {
+    DEBUG_ASSERT(layer < _layers);
+
+    const ImageFormatGL gl_format = image_format_to_gl(_format);
+    if(_texture_type == GL_TEXTURE_2D_ARRAY) {
+        glTextureSubImage3D(_handle.get(), 0, 0, 0, layer, _size.x, _size.y, 1, gl_format.format, gl_format.component_type, texels);
+    } else {
+        glTextureSubImage2D(_handle.get(), 0, 0, 0, _size.x, _size.y, gl_format.format, gl_format.component_type, texels);
+    }
+
+    generate_mipmaps(layer);
+}
+
+// Mipmaps of a single array layer are generated through a view, so other layers aren't touched
+void Texture::generate_mipmaps(u32 layer) {
+    if(_texture_type != GL_TEXTURE_2D_ARRAY) {
+        glGenerateTextureMipmap(_handle.get());
+        return;
+    }
+
+    GLuint view = 0;
+    glGenTextures(1, &view);
+    glTextureView(view, GL_TEXTURE_2D, _handle.get(), image_format_to_gl(_format).internal_format, 0, mip_levels(_size), layer, 1);
+    glGenerateTextureMipmap(view);
+    glDeleteTextures(1, &view);
+}
+
+void Texture::bind_as_image(u32 index, AccessType access, u32 level) {
+    glBindImageTexture(index, _handle.get(), level, texture_type() != GL_TEXTURE_2D, 0, access_type_to_gl(access), image_format_to_gl(_format).internal_format);
 }
 
 u64 Texture::bindless_handle() const {
@@ -153,6 +229,10 @@ glm::uvec2 Texture::size() const {
     return _size;
 }
 
+u32 Texture::layer_count() const {
+    return _layers;
+}
+
 // Return number of mip levels needed
 u32 Texture::mip_levels(glm::uvec2 size) {
     const float side = float(std::max(size.x, size.y));
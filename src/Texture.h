@@ -8,16 +8,30 @@
 
 #include <vector>
 #include <memory>
+#include <cstdlib>
 
 
 namespace OM3D {
 
 struct TextureData {
-    std::unique_ptr<u8[]> data;
+    struct TexelDeleter {
+        void operator()(u8* texels) const {
+            std::free(texels);
+        }
+    };
+
+    using TexelBuffer = std::unique_ptr<u8[], TexelDeleter>;
+
+    // Texels are allocated with malloc (like stb_image does) so decoded images can be adopted without a copy
+    TexelBuffer data;
     glm::uvec2 size = {};
     ImageFormat format;
 
     static Result<TextureData> from_file(const std::string& file_name);
+
+    static TexelBuffer allocate(size_t bytes) {
+        return TexelBuffer(static_cast<u8*>(std::malloc(bytes)));
+    }
 };
 
 
@@ -38,33 +52,46 @@ class Texture {
         ~Texture();
 
         Texture(const TextureData& data);
+        Texture(const void* texels, const glm::uvec2& size, ImageFormat format);
 
         Texture(const glm::uvec2 &size, ImageFormat format, WrapMode wrap);
 
+        static Texture empty(const glm::uvec2& size, ImageFormat format, u32 mipmaps = 9999);
         static Texture empty_cubemap(u32 size, ImageFormat format, u32 mipmaps = 1);
         static Texture cubemap_from_equirec(const Texture& equirec);
 
+        // Layers have a full mip chain, generated by set_layer
+        static Texture empty_array(const glm::uvec2& size, u32 layers, ImageFormat format);
+
         bool is_null() const;
 
+        // Replaces the texels of one layer of an array (or of a 2D texture for layer 0) and regenerates its mipmaps
+        void set_layer(u32 layer, const void* texels);
+
         void bind(u32 index) const;
-        void bind_as_image(u32 index, AccessType access);
+        void bind_as_image(u32 index, AccessType access, u32 level = 0);
 
         u64 bindless_handle() const;
 
         u32 texture_type() const;
 
         glm::uvec2 size() const;
+        u32 layer_count() const;
 
         static u32 mip_levels(glm::uvec2 size);
 
     private:
         friend class Framebuffer;
         friend class Program;
+        friend class TextureUploader;
+
+        void generate_mipmaps(u32 layer);
 
         GLHandle _handle;
         glm::uvec2 _size = {};
         u64 _bindless = {};
         ImageFormat _format;
+        u32 _layers = 1;
 
         u32 _texture_type = {};
 };
@@ -0,0 +1,174 @@
+#include "TextureUploader.h"
+#include "GLState.h"
+
+#include <glad/gl.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace OM3D {
+
+bool stream_texture_uploads = true;
+
+static GLuint create_buffer_handle() {
+    GLuint handle = 0;
+    glCreateBuffers(1, &handle);
+    return handle;
+}
+
+TextureUploader::TextureUploader(size_t ring_size, size_t frame_budget) :
+    _buffer(create_buffer_handle()),
+    _ring_size(ring_size),
+    _frame_budget(frame_budget) {
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glNamedBufferStorage(_buffer.get(), _ring_size, nullptr, flags);
+    _mapping = static_cast<u8*>(glMapNamedBufferRange(_buffer.get(), 0, _ring_size, flags));
+    ALWAYS_ASSERT(_mapping, "Unable to map texture upload buffer");
+}
+
+TextureUploader::~TextureUploader() {
+    for(const InFlight& in_flight : _in_flight) {
+        glDeleteSync(static_cast<GLsync>(in_flight.fence));
+    }
+
+    if(auto handle = _buffer.get()) {
+        gl_state().forget_buffer(handle);
+        glUnmapNamedBuffer(handle);
+        glDeleteBuffers(1, &handle);
+    }
+}
+
+void TextureUploader::upload(std::shared_ptr<const u8> texels, const glm::uvec2& size, ImageFormat format, ReadyCallback on_ready) {
+    if(!stream_texture_uploads) {
+        on_ready(std::make_shared<Texture>(texels.get(), size, format));
+        return;
+    }
+
+    Upload& upload = _pending.emplace_back();
+    upload.texture = std::make_shared<Texture>(Texture::empty(size, format));
+    upload.texels = std::move(texels);
+    upload.on_ready = std::move(on_ready);
+}
+
+void TextureUploader::upload_layer(std::shared_ptr<Texture> array, u32 layer, std::shared_ptr<const u8> texels, ReadyCallback on_ready) {
+    DEBUG_ASSERT(layer < array->layer_count());
+
+    if(!stream_texture_uploads) {
+        array->set_layer(layer, texels.get());
+        on_ready(std::move(array));
+        return;
+    }
+
+    Upload& upload = _pending.emplace_back();
+    upload.texture = std::move(array);
+    upload.texels = std::move(texels);
+    upload.on_ready = std::move(on_ready);
+    upload.layer = layer;
+}
+
+size_t TextureUploader::pending_count() const {
+    return _pending.size();
+}
+
+void TextureUploader::retire() {
+    while(!_in_flight.empty()) {
+        const GLsync fence = static_cast<GLsync>(_in_flight.front().fence);
+        if(glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            break;
+        }
+        glDeleteSync(fence);
+        _in_flight.pop_front();
+    }
+
+    if(_in_flight.empty() && _frame_begin == _end) {
+        _frame_begin = _end = 0;
+    }
+}
+
+// Allocates contiguous ring space, _end never catches up with the oldest in-flight byte
+Result<size_t> TextureUploader::allocate(size_t size) {
+    const bool empty = _in_flight.empty() && _frame_begin == _end;
+    const size_t oldest = _in_flight.empty() ? _frame_begin : _in_flight.front().begin;
+
+    size_t offset = 0;
+    if(empty) {
+        if(size > _ring_size) {
+            return {false, {}};
+        }
+        _frame_begin = 0;
+    } else if(_end >= oldest) {
+        if(_ring_size - _end >= size) {
+            offset = _end;
+        } else if(size >= oldest) {
+            return {false, {}};
+        }
+    } else {
+        if(oldest - _end <= size) {
+            return {false, {}};
+        }
+        offset = _end;
+    }
+
+    _end = offset + size;
+    return {true, offset};
+}
+
+void TextureUploader::process() {
+    retire();
+
+    if(_pending.empty()) {
+        return;
+    }
+
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, _buffer.get());
+
+    size_t budget = _frame_budget;
+    while(!_pending.empty()) {
+        Upload& upload = _pending.front();
+
+        const glm::uvec2 size = upload.texture->size();
+        const ImageFormatGL gl_format = image_format_to_gl(upload.texture->_format);
+        const size_t row_bytes = size_t(size.x) * bytes_per_pixel(upload.texture->_format);
+
+        // Upload as many rows as the budget and the free ring space allow
+        u32 rows = u32(std::min(size_t(size.y - upload.uploaded_rows), std::min(budget, _ring_size) / row_bytes));
+        Result<size_t> offset = {false, {}};
+        for(; rows; rows /= 2) {
+            if(offset = allocate(rows * row_bytes); offset.is_ok) {
+                break;
+            }
+        }
+
+        if(!rows) {
+            break;
+        }
+
+        const size_t bytes = rows * row_bytes;
+        std::memcpy(_mapping + offset.value, upload.texels.get() + upload.uploaded_rows * row_bytes, bytes);
+        const void* pixels = reinterpret_cast<void*>(offset.value);
+        if(upload.texture->texture_type() == GL_TEXTURE_2D_ARRAY) {
+            glTextureSubImage3D(upload.texture->_handle.get(), 0, 0, upload.uploaded_rows, upload.layer, size.x, rows, 1, gl_format.format, gl_format.component_type, pixels);
+        } else {
+            glTextureSubImage2D(upload.texture->_handle.get(), 0, 0, upload.uploaded_rows, size.x, rows, gl_format.format, gl_format.component_type, pixels);
+        }
+
+        upload.uploaded_rows += rows;
+        budget -= bytes;
+
+        if(upload.uploaded_rows == size.y) {
+            upload.texture->generate_mipmaps(upload.layer);
+            upload.on_ready(std::move(upload.texture));
+            _pending.pop_front();
+        }
+    }
+
+    gl_state().bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if(_end != _frame_begin) {
+        _in_flight.push_back(InFlight{glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), _frame_begin});
+        _frame_begin = _end;
+    }
+}
+
+}
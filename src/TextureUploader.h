@@ -0,0 +1,63 @@
+#ifndef TEXTUREUPLOADER_H
+#define TEXTUREUPLOADER_H
+
+#include <Texture.h>
+
+#include <deque>
+#include <functional>
+
+namespace OM3D {
+
+// Streams texels to the GPU through a persistently mapped GL_PIXEL_UNPACK_BUFFER ring.
+// At most frame_budget bytes are uploaded every time process() is called (once per frame).
+// Ring space is recycled once the fence of the frame that used it has been signaled.
+class TextureUploader : NonMovable {
+    public:
+        using ReadyCallback = std::function<void(std::shared_ptr<Texture>)>;
+
+        TextureUploader(size_t ring_size, size_t frame_budget);
+        ~TextureUploader();
+
+        // Storage is created immediately but on_ready will only be called, from process(), once all texels have landed.
+        // texels must stay valid until then.
+        void upload(std::shared_ptr<const u8> texels, const glm::uvec2& size, ImageFormat format, ReadyCallback on_ready);
+
+        // Same as upload, but fills one layer of an existing texture array, which is what on_ready receives
+        void upload_layer(std::shared_ptr<Texture> array, u32 layer, std::shared_ptr<const u8> texels, ReadyCallback on_ready);
+
+        void process();
+
+        size_t pending_count() const;
+
+    private:
+        struct Upload {
+            std::shared_ptr<Texture> texture;
+            std::shared_ptr<const u8> texels;
+            ReadyCallback on_ready;
+            u32 layer = 0;
+            u32 uploaded_rows = 0;
+        };
+
+        struct InFlight {
+            void* fence = nullptr;
+            size_t begin = 0;
+        };
+
+        void retire();
+        Result<size_t> allocate(size_t size);
+
+        GLHandle _buffer;
+        u8* _mapping = nullptr;
+        size_t _ring_size = 0;
+        size_t _frame_budget = 0;
+
+        size_t _frame_begin = 0;
+        size_t _end = 0;
+        std::deque<InFlight> _in_flight;
+
+        std::deque<Upload> _pending;
+};
+
+}
+
+#endif // TEXTUREUPLOADER_H
@@ -5,6 +5,8 @@
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 
+#include <utils.h>
+
 namespace OM3D {
 
 struct Vertex {
@@ -15,6 +17,16 @@ struct Vertex {
     glm::vec3 color = glm::vec3(1.0f, 1.0f, 1.0f); // to avoid completly black meshes if no color is present
 };
 
+// Quantized GPU layout of Vertex, built by StaticMesh. Colors are stored in a separate UNORM8 stream
+struct CompactVertex {
+    u16 position[4] = {};   // UNORM16 within the mesh bounds, w is the bitangent sign (0 for negative)
+    i16 normal[2] = {};     // SNORM16 octahedral encoding
+    i16 tangent[2] = {};    // SNORM16 octahedral encoding
+    u32 uv = 0;             // 2 half floats
+};
+
+static_assert(sizeof(CompactVertex) == 20);
+
 }
 
 #endif // VERTEX_H
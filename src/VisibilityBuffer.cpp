@@ -0,0 +1,31 @@
+#include "VisibilityBuffer.h"
+
+namespace OM3D {
+
+VisibilityBuffer::VisibilityBuffer() {
+}
+
+VisibilityBuffer::VisibilityBuffer(Texture* depth, Texture* lit_hdr) :
+        _visibility(depth->size(), ImageFormat::RG32_UINT, WrapMode::Clamp),
+        _geometry_framebuffer(depth, std::array{&_visibility}),
+        _shading_framebuffer(nullptr, std::array{lit_hdr}),
+        _forward_framebuffer(depth, std::array{lit_hdr}) {
+}
+
+void VisibilityBuffer::bind_geometry() const {
+    // Pixels left uncovered keep their depth cleared to 0 and are never read, no need to clear
+    _geometry_framebuffer.bind(false, false);
+}
+
+void VisibilityBuffer::bind_shading(const Texture& depth) const {
+    // Depth is sampled, it can't be attached
+    _shading_framebuffer.bind(false, false);
+    _visibility.bind(0);
+    depth.bind(1);
+}
+
+void VisibilityBuffer::bind_forward() const {
+    _forward_framebuffer.bind(false, false);
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef VISIBILITYBUFFER_H
+#define VISIBILITYBUFFER_H
+
+#include <Framebuffer.h>
+
+namespace OM3D {
+
+// Instance slot (with the culling phase in the top bit) and triangle covering every pixel (RG32UI).
+// Opaque objects only write those in the geometry pass, their attributes are fetched and shaded once per pixel afterwards
+class VisibilityBuffer : NonCopyable {
+    public:
+        VisibilityBuffer();
+        // Textures are only attached, they must outlive the visibility buffer but can be moved
+        VisibilityBuffer(Texture* depth, Texture* lit_hdr);
+
+        VisibilityBuffer(VisibilityBuffer&&) = default;
+        VisibilityBuffer& operator=(VisibilityBuffer&&) = default;
+
+        // Visibility and depth targets, for the geometry pass
+        void bind_geometry() const;
+        // Lit HDR target only, with the visibility buffer at texture unit 0 and depth at 1, for the shading pass
+        void bind_shading(const Texture& depth) const;
+        // Lit HDR and depth targets, for objects drawn after the shading pass
+        void bind_forward() const;
+
+    private:
+        Texture _visibility;
+
+        Framebuffer _geometry_framebuffer;
+        Framebuffer _shading_framebuffer;
+        Framebuffer _forward_framebuffer;
+};
+
+}
+
+#endif // VISIBILITYBUFFER_H
@@ -4,6 +4,11 @@
 #include "Texture.h"
 #include "Program.h"
 #include "TimestampQuery.h"
+#include "TextureUploader.h"
+#include "FrameAllocator.h"
+#include "GeometryPool.h"
+#include "StaticMesh.h"
+#include "GLState.h"
 
 #include <glad/gl.h>
 
@@ -15,16 +20,28 @@
 
 namespace OM3D {
 
+// Plain global: GL objects released by other globals at exit still report to it
+GLState shadowed_state;
+
 Texture brdf_lut_texture;
+std::unique_ptr<TextureUploader> uploader;
+std::unique_ptr<FrameAllocator> frame_allocations;
+std::unique_ptr<GeometryPool> geometry;
+bool draw_parameters = false;
+bool nonuniform_handles = false;
+bool subgroup_ballot = false;
+bool visibility_buffer = false;
 
 struct {
     std::shared_ptr<Texture> black;
     std::shared_ptr<Texture> white;
     std::shared_ptr<Texture> normal;
     std::shared_ptr<Texture> metal_rough;
+    std::shared_ptr<Texture> array;
 } default_textures;
 
 bool audit_bindings_before_draw = false;
+bool texture_array_materials = true;
 
 void debug_out(GLenum, GLenum type, GLuint, GLenum sev, GLsizei, const char* msg, const void*) {
     if(sev == GL_DEBUG_SEVERITY_NOTIFICATION) {
@@ -52,6 +69,12 @@ u32 buffer_usage_to_gl(BufferUsage usage) {
 
         case BufferUsage::Storage:
             return GL_SHADER_STORAGE_BUFFER;
+
+        case BufferUsage::Indirect:
+            return GL_DRAW_INDIRECT_BUFFER;
+
+        case BufferUsage::DispatchIndirect:
+            return GL_DISPATCH_INDIRECT_BUFFER;
     }
 
     FATAL("Unknown usage value");
@@ -83,7 +106,34 @@ u32 align_up_to(u32 val, u32 up_to) {
 
 
 bool bindless_enabled() {
-    return GLAD_GL_ARB_bindless_texture != 0;
+    return GLAD_GL_ARB_bindless_texture != 0 && (nonuniform_handles || subgroup_ballot);
+}
+
+bool draw_parameters_enabled() {
+    return draw_parameters;
+}
+
+bool nonuniform_bindless_handles() {
+    return nonuniform_handles;
+}
+
+bool texture_arrays_enabled() {
+    return texture_array_materials && !bindless_enabled();
+}
+
+bool visibility_buffer_supported() {
+    return visibility_buffer;
+}
+
+static bool has_extension(std::string_view name) {
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for(int i = 0; i != count; ++i) {
+        if(name == reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i))) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void init_graphics() {
@@ -111,6 +161,9 @@ void init_graphics() {
         glClearDepthf(0.0f);
     }
 
+    // Texel rows are always tightly packed
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
     glActiveTexture(GL_TEXTURE0);
     glEnable(GL_FRAMEBUFFER_SRGB);
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
@@ -119,6 +172,34 @@ void init_graphics() {
     glGenVertexArrays(1, &global_vao);
     glBindVertexArray(global_vao);
 
+    draw_parameters = has_extension("GL_ARB_shader_draw_parameters");
+
+    // Sampling through a bindless handle that isn't dynamically uniform is only defined with GL_NV_gpu_shader5,
+    // otherwise shaders loop over the distinct handles of the subgroup (see material.glsl)
+    nonuniform_handles = has_extension("GL_NV_gpu_shader5");
+    if(has_extension("GL_KHR_shader_subgroup")) {
+        // From GL_KHR_shader_subgroup, not in the loader
+        const GLenum subgroup_supported_stages = 0x9533;
+        const GLenum subgroup_supported_features = 0x9534;
+        const int subgroup_feature_ballot = 0x8;
+
+        int stages = 0;
+        int features = 0;
+        glGetIntegerv(subgroup_supported_stages, &stages);
+        glGetIntegerv(subgroup_supported_features, &features);
+        subgroup_ballot = (stages & GL_FRAGMENT_SHADER_BIT) && (features & subgroup_feature_ballot);
+    }
+
+    {
+        int fragment_storage_blocks = 0;
+        glGetIntegerv(GL_MAX_FRAGMENT_SHADER_STORAGE_BLOCKS, &fragment_storage_blocks);
+        visibility_buffer = bindless_enabled() && fragment_storage_blocks >= 12;
+    }
+
+    uploader = std::make_unique<TextureUploader>(64 * 1024 * 1024, 16 * 1024 * 1024);
+    frame_allocations = std::make_unique<FrameAllocator>(4 * 1024 * 1024);
+    geometry = std::make_unique<GeometryPool>(compact_vertex_format);
+
     {
         brdf_lut_texture = Texture(glm::uvec2(256), ImageFormat::RG16_UNORM, WrapMode::Clamp);
 
@@ -134,7 +215,9 @@ void init_graphics() {
         TextureData data;
         data.format = ImageFormat::RGBA8_UNORM;
         data.size = glm::uvec2(2, 2);
-        data.data = std::make_unique<u8[]>(16);
+        data.data = TextureData::allocate(16);
+
+        default_textures.array = std::make_shared<Texture>(Texture::empty_array(data.size, 3, data.format));
 
         {
             std::memset(data.data.get(), 0, 16);
@@ -143,6 +226,7 @@ void init_graphics() {
         {
             std::memset(data.data.get(), 255, 16);
             default_textures.white = std::make_shared<Texture>(data);
+            default_textures.array->set_layer(0, data.data.get());
         }
         {
             std::memset(data.data.get(), 0, 16);
@@ -152,6 +236,7 @@ void init_graphics() {
                 data.data[i * 4 + 2] = 255;
             }
             default_textures.normal = std::make_shared<Texture>(data);
+            default_textures.array->set_layer(1, data.data.get());
         }
         {
             std::memset(data.data.get(), 0, 16);
@@ -160,11 +245,15 @@ void init_graphics() {
                 data.data[i * 4 + 2] = 0;
             }
             default_textures.metal_rough = std::make_shared<Texture>(data);
+            default_textures.array->set_layer(2, data.data.get());
         }
     }
 }
 
 void destroy_graphics() {
+    uploader = nullptr;
+    frame_allocations = nullptr;
+    geometry = nullptr;
     brdf_lut_texture = {};
     default_textures = {};
     profile::destroy_profile();
@@ -174,17 +263,34 @@ const Texture& brdf_lut() {
     return brdf_lut_texture;
 }
 
+TextureUploader& texture_uploader() {
+    DEBUG_ASSERT(uploader);
+    return *uploader;
+}
+
+FrameAllocator& frame_allocator() {
+    DEBUG_ASSERT(frame_allocations);
+    return *frame_allocations;
+}
+
+GeometryPool& geometry_pool() {
+    DEBUG_ASSERT(geometry);
+    return *geometry;
+}
+
+GLState& gl_state() {
+    return shadowed_state;
+}
+
 
 void draw_full_screen_triangle() {
     if(audit_bindings_before_draw) {
         audit_bindings();
     }
 
-    glDisableVertexAttribArray(0);
-    glDisableVertexAttribArray(1);
-    glDisableVertexAttribArray(2);
-    glDisableVertexAttribArray(3);
-    glDisableVertexAttribArray(4);
+    for(u32 i = 0; i != 5; ++i) {
+        shadowed_state.enable_vertex_attrib(i, false);
+    }
 
     glDrawArrays(GL_TRIANGLES, 0, 3);
 }
@@ -192,11 +298,8 @@ void draw_full_screen_triangle() {
 void blit_to_screen(const Texture& tex) {
     const std::shared_ptr<Program> blit_program = Program::from_files("passthrough.frag", "screen.vert");
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDisable(GL_DEPTH_TEST); // In case glfw gives us a depth buffer
-
-    int viewport[4] = {};
-    glGetIntegerv(GL_VIEWPORT, viewport);
+    shadowed_state.bind_framebuffer(0);
+    shadowed_state.set_depth_test(false); // In case glfw gives us a depth buffer
 
     blit_program->bind();
     tex.bind(0);
@@ -219,6 +322,10 @@ std::shared_ptr<Texture> default_metal_rough_texture() {
     return default_textures.metal_rough;
 }
 
+std::shared_ptr<Texture> default_texture_array() {
+    return default_textures.array;
+}
+
 
 
 
@@ -310,19 +417,38 @@ static bool is_image_type(GLenum type) {
 }
 
 
+// Persistent mappings are allowed to stay alive while the GPU reads the buffer
+static bool is_mapped_for_cpu(u32 buffer) {
+    void* mapping = nullptr;
+    glGetNamedBufferPointerv(buffer, GL_BUFFER_MAP_POINTER, &mapping);
+    if(!mapping) {
+        return false;
+    }
+
+    int flags = 0;
+    glGetNamedBufferParameteriv(buffer, GL_BUFFER_ACCESS_FLAGS, &flags);
+    return !(flags & GL_MAP_PERSISTENT_BIT);
+}
+
 [[maybe_unused]]
-static bool is_cube_type(GLenum type) {
+static GLenum texture_binding(GLenum type) {
     switch(type) {
         case GL_IMAGE_CUBE:
         case GL_SAMPLER_CUBE:
-            return true;
+            return GL_TEXTURE_BINDING_CUBE_MAP;
+
+        case GL_IMAGE_2D_ARRAY:
+        case GL_SAMPLER_2D_ARRAY:
+            return GL_TEXTURE_BINDING_2D_ARRAY;
 
         default:
-            return false;
+            return GL_TEXTURE_BINDING_2D;
     }
 }
 
 void audit_bindings() {
+    shadowed_state.validate();
+
     auto get = [](GLenum e) {
         int v = 0;
         glGetIntegerv(e , &v);
@@ -358,10 +484,13 @@ void audit_bindings() {
 
             if(is_sampler_type(type) || is_image_type(type)) {
                 const int location = get_resource_property(GL_UNIFORM, GL_LOCATION, i);
+                const int array_size = get_resource_property(GL_UNIFORM, GL_ARRAY_SIZE, i);
 
-                unsigned index = 0;
-                glGetUniformuiv(current_program, location, &index);
-                ALWAYS_ASSERT(glIsTexture(get_at(is_cube_type(type) ? GL_TEXTURE_BINDING_CUBE_MAP : GL_TEXTURE_BINDING_2D, index)), "Bound texture is destroyed or invalid");
+                for(int j = 0; j != array_size; ++j) {
+                    unsigned index = 0;
+                    glGetUniformuiv(current_program, location + j, &index);
+                    ALWAYS_ASSERT(glIsTexture(get_at(texture_binding(type), index)), "Bound texture is destroyed or invalid");
+                }
             }
         }
     }
@@ -374,9 +503,7 @@ void audit_bindings() {
             const int buffer = get_at(GL_UNIFORM_BUFFER_BINDING, binding);
             ALWAYS_ASSERT(buffer && glIsBuffer(buffer), "Bound uniform buffer is destroyed or invalid");
 
-            void* mapping = nullptr;
-            glGetNamedBufferPointerv(buffer, GL_BUFFER_MAP_POINTER, &mapping);
-            ALWAYS_ASSERT(!mapping, "Uniform buffer is still mapped");
+            ALWAYS_ASSERT(!is_mapped_for_cpu(buffer), "Uniform buffer is still mapped");
         }
     }
 
@@ -388,9 +515,7 @@ void audit_bindings() {
             const int buffer = get_at(GL_SHADER_STORAGE_BUFFER_BINDING, binding);
             ALWAYS_ASSERT(buffer && glIsBuffer(buffer), "Bound storage buffer is destroyed or invalid");
 
-            void* mapping = nullptr;
-            glGetNamedBufferPointerv(buffer, GL_BUFFER_MAP_POINTER, &mapping);
-            ALWAYS_ASSERT(!mapping, "Storage buffer is still mapped");
+            ALWAYS_ASSERT(!is_mapped_for_cpu(buffer), "Storage buffer is still mapped");
         }
     }
 }
@@ -9,6 +9,10 @@
 namespace OM3D {
 
 class Texture;
+class TextureUploader;
+class FrameAllocator;
+class GeometryPool;
+class GLState;
 
 static constexpr std::string_view shader_path = "../../shaders/";
 static constexpr std::string_view data_path = "../../data/";
@@ -50,6 +54,8 @@ enum class BufferUsage {
     Index,
     Uniform,
     Storage,
+    Indirect,
+    DispatchIndirect,
 };
 
 enum class AccessType {
@@ -66,12 +72,28 @@ u32 align_up_to(u32 val, u32 up_to);
 void init_graphics();
 void destroy_graphics();
 
+// Bindless material textures, only used if handles can differ between invocations (GL_NV_gpu_shader5) or be made uniform
+// with subgroup ballots. Otherwise materials fall back to texture arrays
 bool bindless_enabled();
+// Bindless handles can differ between the invocations of a draw (GL_NV_gpu_shader5)
+bool nonuniform_bindless_handles();
+// gl_DrawIDARB is available to shaders (GL_ARB_shader_draw_parameters)
+bool draw_parameters_enabled();
+// Without bindless textures, materials sample layers of texture arrays so draws using different textures can be batched
+bool texture_arrays_enabled();
+// The visibility buffer is shaded in a single pass that samples every material and reads geometry from storage buffers,
+// which needs bindless textures and enough storage blocks in fragment shaders
+bool visibility_buffer_supported();
 
 void audit_bindings();
 
 const Texture& brdf_lut();
 
+TextureUploader& texture_uploader();
+FrameAllocator& frame_allocator();
+GeometryPool& geometry_pool();
+GLState& gl_state();
+
 void draw_full_screen_triangle();
 void blit_to_screen(const Texture& tex);
 
@@ -79,6 +101,8 @@ std::shared_ptr<Texture> default_black_texture();
 std::shared_ptr<Texture> default_white_texture();
 std::shared_ptr<Texture> default_normal_texture();
 std::shared_ptr<Texture> default_metal_rough_texture();
+// Layers are the white, normal and metal rough default textures
+std::shared_ptr<Texture> default_texture_array();
 
 }
 
@@ -8,6 +8,11 @@
 #include <Scene.h>
 #include <Texture.h>
 #include <Framebuffer.h>
+#include <GBuffer.h>
+#include <VisibilityBuffer.h>
+#include <TextureUploader.h>
+#include <FrameAllocator.h>
+#include <GLState.h>
 #include <TimestampQuery.h>
 #include <ImGuiRenderer.h>
 
@@ -15,6 +20,7 @@
 
 #include <iostream>
 #include <vector>
+#include <random>
 #include <filesystem>
 
 using namespace OM3D;
@@ -26,12 +32,34 @@ static float sun_azimuth = 45.0f;
 static float sun_intensity = 7.0f;
 static float ibl_intensity = 1.0f;
 static float exposure = 0.33f;
+static bool meshlet_culling = false;
+static bool lod_selection = true;
+static float lod_max_pixel_error = 1.0f;
+static bool draw_sorting = true;
+static bool instancing = true;
+static bool depth_prepass = false;
+static bool deferred_shading = false;
+static bool visibility_buffer_rendering = false;
+static bool frustum_culling = true;
+static bool gpu_culling = false;
+static bool occlusion_culling = false;
+static bool small_object_culling = false;
+static float small_object_pixel_size = 2.0f;
+static u32 picked_object = u32(-1);
+static bool clustered_lighting = true;
+static bool light_heatmap = false;
 
 static std::unique_ptr<Scene> scene;
 static std::shared_ptr<Texture> envmap;
 
 namespace OM3D {
 extern bool audit_bindings_before_draw;
+extern bool parallel_gltf_loading;
+extern bool stream_texture_uploads;
+extern bool optimize_gltf_meshes;
+extern bool display_mesh_optimization_stats;
+extern bool generate_gltf_lods;
+extern bool texture_array_materials;
 }
 
 void parse_args(int argc, char** argv) {
@@ -40,6 +68,20 @@ void parse_args(int argc, char** argv) {
 
         if(arg == "--validate") {
             OM3D::audit_bindings_before_draw = true;
+        } else if(arg == "--serial-load") {
+            OM3D::parallel_gltf_loading = false;
+        } else if(arg == "--sync-texture-upload") {
+            OM3D::stream_texture_uploads = false;
+        } else if(arg == "--float-vertices") {
+            OM3D::compact_vertex_format = false;
+        } else if(arg == "--no-mesh-opt") {
+            OM3D::optimize_gltf_meshes = false;
+        } else if(arg == "--mesh-opt-stats") {
+            OM3D::display_mesh_optimization_stats = true;
+        } else if(arg == "--no-lods") {
+            OM3D::generate_gltf_lods = false;
+        } else if(arg == "--no-texture-arrays") {
+            OM3D::texture_array_materials = false;
         } else {
             std::cerr << "Unknown argument \"" << arg << "\"" << std::endl;
         }
@@ -114,6 +156,21 @@ void process_inputs(GLFWwindow* window, Camera& camera) {
         int height = 0;
         glfwGetWindowSize(window, &width, &height);
         camera.set_ratio(float(width) / float(height));
+
+        // Pick the object under the cursor
+        if(glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS && width && height) {
+            const glm::vec2 ndc = glm::vec2(new_mouse_pos / glm::dvec2(width, height)) * glm::vec2(2.0f, -2.0f) + glm::vec2(-1.0f, 1.0f);
+            const glm::mat4 inv_view_proj = glm::inverse(camera.view_proj_matrix());
+            auto unproject = [&](float depth) {
+                const glm::vec4 p = inv_view_proj * glm::vec4(ndc, depth, 1.0f);
+                return glm::vec3(p) / p.w;
+            };
+
+            // Reverse-Z: 1 is the near plane
+            const glm::vec3 origin = unproject(1.0f);
+            RayHit hit;
+            picked_object = scene->bvh().raycast(origin, glm::normalize(unproject(0.5f) - origin), std::numeric_limits<float>::max(), hit) ? hit.object : u32(-1);
+        }
     }
 
     mouse_pos = new_mouse_pos;
@@ -129,11 +186,12 @@ void load_envmap(const std::string& filename) {
 }
 
 void load_scene(const std::string& filename) {
-    if(auto res = Scene::from_gltf(filename); res.is_ok) {
+    if(auto res = ends_with(filename, ".om3d") ? Scene::from_baked(filename) : Scene::from_gltf(filename); res.is_ok) {
         scene = std::move(res.value);
         scene->set_envmap(envmap);
         scene->set_ibl_intensity(ibl_intensity);
         scene->set_sun(sun_altitude, sun_azimuth, glm::vec3(sun_intensity));
+        picked_object = u32(-1);
     } else {
         std::cerr << "Unable to load scene (" << filename << ")" << std::endl;
     }
@@ -179,6 +237,29 @@ bool load_file_window(Span<std::string> files, F&& load_func) {
     return false;
 }
 
+// Scatters lights in the bounds of the scene, for stress testing
+void add_random_lights(u32 count) {
+    AABB bounds;
+    for(const SceneObject& object : scene->objects()) {
+        const BoundingSphere sphere = object.world_bounding_sphere();
+        bounds.extend(AABB::from_sphere(sphere.center, sphere.radius));
+    }
+    if(bounds.is_empty()) {
+        return;
+    }
+
+    static std::mt19937 rng;
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float radius = glm::length(bounds.max - bounds.min) * 0.05f;
+    for(u32 i = 0; i != count; ++i) {
+        PointLight light;
+        light.set_position(glm::mix(bounds.min, bounds.max, glm::vec3(unit(rng), unit(rng), unit(rng))));
+        light.set_color(glm::vec3(unit(rng), unit(rng), unit(rng)) * 10.0f);
+        light.set_radius(radius);
+        scene->add_light(std::move(light));
+    }
+}
+
 void gui(ImGuiRenderer& imgui) {
     const ImVec4 error_text_color = ImVec4(1.0f, 0.3f, 0.3f, 1.0f);
     const ImVec4 warning_text_color = ImVec4(1.0f, 0.8f, 0.4f, 1.0f);
@@ -223,12 +304,121 @@ void gui(ImGuiRenderer& imgui) {
             ImGui::DragFloat("Sun Intensity", &sun_intensity, 0.05f, 0.0f, 100.0f, "%.1f");
             scene->set_sun(sun_altitude, sun_azimuth, glm::vec3(sun_intensity));
 
+            ImGui::Separator();
+
+            ImGui::Checkbox("Clustered lighting", &clustered_lighting);
+            ImGui::Checkbox("Light heatmap", &light_heatmap);
+            scene->set_clustered_lighting(clustered_lighting, light_heatmap);
+
+            if(ImGui::Button("Add 1000 lights")) {
+                add_random_lights(1000);
+            }
+            ImGui::SameLine();
+            ImGui::Text("%u point lights", u32(scene->point_lights().size()));
+
+            ImGui::EndMenu();
+        }
+
+        if(ImGui::BeginMenu("Rendering")) {
+            ImGui::Checkbox("Sort draws", &draw_sorting);
+            scene->set_draw_sorting(draw_sorting);
+            ImGui::Checkbox("Instancing", &instancing);
+            scene->set_instancing(instancing);
+            ImGui::Checkbox("Deferred shading", &deferred_shading);
+            if(visibility_buffer_supported()) {
+                ImGui::Checkbox("Visibility buffer", &visibility_buffer_rendering);
+            }
+            if(!deferred_shading && !visibility_buffer_rendering) {
+                ImGui::Checkbox("Depth prepass", &depth_prepass);
+            }
+            scene->set_depth_prepass(depth_prepass);
+            {
+                const StateChangeStats& stats = scene->draw_stats();
+                ImGui::Text("%u draws in %u calls for %u objects", stats.draws, stats.draw_calls, stats.instances);
+                ImGui::Text("%u material changes", stats.material_changes);
+                ImGui::Text("%u program binds, %u texture binds", stats.program_binds, stats.texture_binds);
+                ImGui::Text("Material textures: %s", bindless_enabled() ? "bindless" : texture_arrays_enabled() ? "texture arrays" : "bound");
+                ImGui::Text("%u render state changes", stats.render_state_changes);
+            }
+            {
+                const GLState::Stats& stats = gl_state().frame_stats();
+                ImGui::Text("GL state: %u calls, %u redundant skipped", stats.calls, stats.skipped);
+            }
+
+            ImGui::Separator();
+
+            ImGui::Checkbox("Frustum culling", &frustum_culling);
+            if(frustum_culling) {
+                ImGui::Checkbox("Cull on GPU", &gpu_culling);
+                if(gpu_culling) {
+                    ImGui::Checkbox("Occlusion culling", &occlusion_culling);
+                }
+                ImGui::Checkbox("Small object culling", &small_object_culling);
+                if(small_object_culling) {
+                    ImGui::DragFloat("Min size (pixels)", &small_object_pixel_size, 0.05f, 0.1f, 50.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+                }
+
+                const ObjectCullingStats& stats = scene->object_culling_stats();
+                ImGui::Text("%u of %u objects visible", stats.visible, stats.objects);
+                ImGui::Text("%u frustum culled, %u too small", stats.frustum_culled, stats.small_culled);
+                if(gpu_culling && occlusion_culling) {
+                    ImGui::Text("%u occluded", stats.occluded);
+                }
+            }
+
+            ImGui::Separator();
+
+            ImGui::Checkbox("Meshlet culling", &meshlet_culling);
+            scene->set_meshlet_culling(meshlet_culling);
+
+            if(meshlet_culling) {
+                const MeshletCullingStats& stats = scene->meshlet_culling_stats();
+                const auto percent = [](u32 count, u32 total) { return total ? 100.0f * float(count) / float(total) : 0.0f; };
+
+                ImGui::Separator();
+                ImGui::Text("%u meshlets in %u objects", stats.meshlets, stats.objects);
+                ImGui::Text("%u frustum culled (%.1f%%)", stats.frustum_culled, percent(stats.frustum_culled, stats.meshlets));
+                ImGui::Text("%u backface culled (%.1f%%)", stats.backface_culled, percent(stats.backface_culled, stats.meshlets));
+                ImGui::Text("%u visible (%.1f%%)", stats.visible_meshlets, percent(stats.visible_meshlets, stats.meshlets));
+                ImGui::Text("%u of %u triangles drawn", stats.visible_triangles, stats.triangles);
+            }
+
+            ImGui::Separator();
+
+            ImGui::Checkbox("LOD selection", &lod_selection);
+            if(lod_selection) {
+                ImGui::DragFloat("Max error (pixels)", &lod_max_pixel_error, 0.05f, 0.1f, 50.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+
+                const LodStats& stats = scene->lod_stats();
+                ImGui::Text("%u of %u triangles submitted", stats.submitted_triangles, stats.loaded_triangles);
+                for(u32 i = 0; i != max_lod_count; ++i) {
+                    ImGui::Text("LOD %u: %u objects", i, stats.objects_per_lod[i]);
+                }
+            }
+
             ImGui::EndMenu();
         }
 
         if(scene && ImGui::BeginMenu("Scene Info")) {
             ImGui::Text("%u objects", u32(scene->objects().size()));
             ImGui::Text("%u point lights", u32(scene->point_lights().size()));
+            ImGui::Text("BVH: %u nodes", u32(scene->bvh().node_count()));
+            if(picked_object < scene->objects().size()) {
+                // Lights whose radius touches the picked object
+                u32 lights = 0;
+                std::vector<u32> objects;
+                for(const PointLight& light : scene->point_lights()) {
+                    objects.clear();
+                    scene->bvh().query_sphere(light.position(), light.radius(), objects);
+                    lights += u32(std::find(objects.begin(), objects.end(), picked_object) != objects.end());
+                }
+                ImGui::Text("Picked object %u, reached by %u point lights", picked_object, lights);
+            } else {
+                ImGui::TextUnformatted("Right click to pick an object");
+            }
+            if(const size_t pending = texture_uploader().pending_count()) {
+                ImGui::Text("%u textures streaming", u32(pending));
+            }
             ImGui::EndMenu();
         }
 
@@ -257,7 +447,7 @@ void gui(ImGuiRenderer& imgui) {
     if(open_scene_popup) {
         ImGui::OpenPopup("###openscenepopup");
 
-        const std::array<std::string, 2> extensions = {".gltf", ".glb"};
+        const std::array<std::string, 3> extensions = {".gltf", ".glb", ".om3d"};
         load_files = list_data_files(extensions);
     }
 
@@ -378,6 +568,8 @@ struct RendererState {
             state.tone_mapped_texture = Texture(size, ImageFormat::RGBA8_UNORM, WrapMode::Clamp);
             state.main_framebuffer = Framebuffer(&state.depth_texture, std::array{&state.lit_hdr_texture});
             state.tone_map_framebuffer = Framebuffer(nullptr, std::array{&state.tone_mapped_texture});
+            state.gbuffer = GBuffer(&state.depth_texture, &state.lit_hdr_texture);
+            state.visibility_buffer = VisibilityBuffer(&state.depth_texture, &state.lit_hdr_texture);
         }
 
         return state;
@@ -391,6 +583,9 @@ struct RendererState {
 
     Framebuffer main_framebuffer;
     Framebuffer tone_map_framebuffer;
+
+    GBuffer gbuffer;
+    VisibilityBuffer visibility_buffer;
 };
 
 
@@ -432,6 +627,7 @@ int main(int argc, char** argv) {
         }
 
         process_profile_markers();
+        texture_uploader().process();
 
         {
             int width = 0;
@@ -458,6 +654,11 @@ int main(int argc, char** argv) {
                 PROFILE_GPU("Main pass");
 
                 renderer.main_framebuffer.bind(true, true);
+                scene->set_lod_max_error(lod_selection ? lod_max_pixel_error / float(std::max(renderer.size.y, 1u)) : 0.0f);
+                scene->set_frustum_culling(frustum_culling, small_object_culling ? small_object_pixel_size / float(std::max(renderer.size.y, 1u)) : 0.0f, gpu_culling);
+                scene->set_occlusion_culling(occlusion_culling ? &renderer.depth_texture : nullptr);
+                scene->set_deferred_shading(deferred_shading ? &renderer.gbuffer : nullptr, &renderer.depth_texture);
+                scene->set_visibility_buffer(visibility_buffer_rendering ? &renderer.visibility_buffer : nullptr, &renderer.depth_texture);
                 scene->render();
             }
 
@@ -483,6 +684,8 @@ int main(int argc, char** argv) {
         }
 
         glfwSwapBuffers(window);
+        frame_allocator().end_frame();
+        gl_state().end_frame();
     }
 
 
@@ -5,7 +5,11 @@
 #include <cstdlib>
 
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
 
 #ifdef OS_WIN
 #include <windows.h>
@@ -92,4 +96,36 @@ bool ends_with(std::string_view str, std::string_view suffix) {
     return str.substr(str.size() - suffix.size()) == suffix;
 }
 
+
+u32 worker_thread_count() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallel_for(size_t count, const std::function<void(size_t)>& func) {
+    const size_t thread_count = std::min(size_t(worker_thread_count()), count);
+    if(thread_count <= 1) {
+        for(size_t i = 0; i != count; ++i) {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next = 0;
+    auto work = [&] {
+        for(size_t i = next++; i < count; i = next++) {
+            func(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(size_t i = 1; i != thread_count; ++i) {
+        threads.emplace_back(work);
+    }
+    work();
+
+    for(std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
 }
@@ -7,6 +7,7 @@
 #include <utility>
 #include <string>
 #include <array>
+#include <functional>
 
 #define FWD(var) std::forward<decltype(var)>(var)
 #define HASH(str) ([] { static constexpr u32 result = ::OM3D::str_hash(str); return result; }())
@@ -210,6 +211,11 @@ Result<std::string> read_text_file(const std::string& file_name);
 
 bool ends_with(std::string_view str, std::string_view suffix);
 
+u32 worker_thread_count();
+// Call func(i) for every i in [0; count), spread across worker_thread_count() threads
+// func must be thread safe. Returns once every call has completed
+void parallel_for(size_t count, const std::function<void(size_t)>& func);
+
 }
 
 #endif // UTILS_H
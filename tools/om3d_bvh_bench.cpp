@@ -0,0 +1,199 @@
+#include <BVH.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <functional>
+
+using namespace OM3D;
+
+// Measures build, refit and query times of the object BVH, and checks queries against brute force
+// Usage: om3d_bvh_bench [object_count...]
+
+static constexpr u32 repetitions = 5;
+static constexpr u32 query_count = 1000;
+
+static double best_time(const std::function<void()>& func) {
+    double best = 1e30;
+    for(u32 i = 0; i != repetitions; ++i) {
+        const double begin = program_time();
+        func();
+        best = std::min(best, program_time() - begin);
+    }
+    return best;
+}
+
+static void report(const char* name, double time, size_t count = 1) {
+    std::cout << "  " << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(12) << time * 1e3 << " ms";
+    if(count > 1) {
+        std::cout << std::setw(12) << time / double(count) * 1e6 << " us each";
+    }
+    std::cout << std::endl;
+}
+
+static bool outside_plane(const AABB& box, const glm::vec3& position, const glm::vec3& normal) {
+    return glm::dot(box.center() - position, normal) <= -glm::dot(box.extent(), glm::abs(normal));
+}
+
+static void bench(size_t object_count) {
+    std::mt19937 rng(42);
+
+    // Objects spread in a cube, about one per 10 units cubed
+    const float size = std::cbrt(float(object_count)) * 10.0f;
+    std::uniform_real_distribution<float> position_dist(-size * 0.5f, size * 0.5f);
+    std::uniform_real_distribution<float> radius_dist(0.5f, 4.0f);
+    std::uniform_real_distribution<float> unit_dist(-1.0f, 1.0f);
+
+    std::vector<AABB> bounds(object_count);
+    for(AABB& b : bounds) {
+        b = AABB::from_sphere(glm::vec3(position_dist(rng), position_dist(rng), position_dist(rng)), radius_dist(rng));
+    }
+
+    std::cout << object_count << " objects" << std::endl;
+
+    BVH bvh;
+    report("build", best_time([&] { bvh.build(bounds); }));
+    std::cout << "  " << bvh.node_count() << " nodes" << std::endl;
+
+    // Every object moves a little
+    std::vector<AABB> moved(object_count);
+    for(size_t i = 0; i != object_count; ++i) {
+        const glm::vec3 offset = glm::vec3(unit_dist(rng), unit_dist(rng), unit_dist(rng));
+        moved[i] = AABB{bounds[i].min + offset, bounds[i].max + offset};
+    }
+    report("refit (all moved)", best_time([&] {
+        for(size_t i = 0; i != object_count; ++i) {
+            bvh.update(u32(i), moved[i]);
+        }
+    }), object_count);
+    report("refit (full pass)", best_time([&] { bvh.refit(); }));
+
+    // 1% of the objects move
+    report("refit (1% moved)", best_time([&] {
+        for(size_t i = 0; i < object_count; i += 100) {
+            bvh.update(u32(i), bounds[i]);
+        }
+    }), object_count / 100);
+    for(size_t i = 0; i != object_count; ++i) {
+        bvh.update(u32(i), bounds[i]);
+    }
+
+    {
+        Camera camera;
+        camera.set_view(glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.2f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        const Frustum frustum = camera.build_frustum();
+        const glm::vec3 position = camera.position();
+
+        std::vector<u32> objects;
+        report("frustum query", best_time([&] {
+            objects.clear();
+            bvh.query_frustum(frustum, position, objects);
+        }));
+
+        // Must return at least every object a linear scan finds
+        std::vector<u8> found(object_count, 0);
+        for(const u32 object : objects) {
+            found[object] = 1;
+        }
+        size_t inside = 0;
+        for(size_t i = 0; i != object_count; ++i) {
+            const bool outside =
+                outside_plane(bounds[i], position, frustum._near_normal) ||
+                outside_plane(bounds[i], position, frustum._top_normal) ||
+                outside_plane(bounds[i], position, frustum._bottom_normal) ||
+                outside_plane(bounds[i], position, frustum._right_normal) ||
+                outside_plane(bounds[i], position, frustum._left_normal);
+            ALWAYS_ASSERT(outside || found[i], "Frustum query missed an object");
+            inside += !outside;
+        }
+        std::cout << "  " << inside << " objects in frustum, " << objects.size() << " returned" << std::endl;
+    }
+
+    {
+        std::vector<glm::vec3> origins(query_count);
+        std::vector<glm::vec3> directions(query_count);
+        for(u32 i = 0; i != query_count; ++i) {
+            origins[i] = glm::vec3(position_dist(rng), position_dist(rng), position_dist(rng));
+            directions[i] = glm::normalize(glm::vec3(unit_dist(rng), unit_dist(rng), unit_dist(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f));
+        }
+
+        std::vector<RayHit> hits(query_count);
+        std::vector<u8> has_hit(query_count);
+        report("ray queries", best_time([&] {
+            for(u32 i = 0; i != query_count; ++i) {
+                has_hit[i] = bvh.raycast(origins[i], directions[i], size, hits[i]);
+            }
+        }), query_count);
+
+        // Same closest distance as testing every object
+        for(u32 i = 0; i != query_count; i += 10) {
+            const glm::vec3 inv_dir = 1.0f / directions[i];
+            float closest = std::numeric_limits<float>::infinity();
+            for(size_t j = 0; j != object_count; ++j) {
+                const glm::vec3 t0 = (bounds[j].min - origins[i]) * inv_dir;
+                const glm::vec3 t1 = (bounds[j].max - origins[i]) * inv_dir;
+                const glm::vec3 near = glm::min(t0, t1);
+                const glm::vec3 far = glm::max(t0, t1);
+                const float entry = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+                const float exit = std::min(std::min(far.x, far.y), std::min(far.z, size));
+                if(entry <= exit) {
+                    closest = std::min(closest, entry);
+                }
+            }
+            ALWAYS_ASSERT(has_hit[i] ? hits[i].distance == closest : closest == std::numeric_limits<float>::infinity(), "Ray query doesn't match brute force");
+        }
+    }
+
+    {
+        std::vector<glm::vec4> lights(query_count);
+        for(glm::vec4& light : lights) {
+            light = glm::vec4(position_dist(rng), position_dist(rng), position_dist(rng), radius_dist(rng) * 5.0f);
+        }
+
+        std::vector<u32> objects;
+        size_t touched = 0;
+        report("sphere queries", best_time([&] {
+            touched = 0;
+            for(const glm::vec4& light : lights) {
+                objects.clear();
+                bvh.query_sphere(glm::vec3(light), light.w, objects);
+                touched += objects.size();
+            }
+        }), query_count);
+        std::cout << "  " << std::setprecision(1) << double(touched) / query_count << " objects per light" << std::endl;
+
+        // Same objects as testing every object
+        for(u32 i = 0; i != query_count; i += 10) {
+            objects.clear();
+            bvh.query_sphere(glm::vec3(lights[i]), lights[i].w, objects);
+            std::sort(objects.begin(), objects.end());
+            std::vector<u32> expected;
+            for(size_t j = 0; j != object_count; ++j) {
+                const glm::vec3 closest = glm::clamp(glm::vec3(lights[i]), bounds[j].min, bounds[j].max);
+                if(glm::dot(closest - glm::vec3(lights[i]), closest - glm::vec3(lights[i])) <= lights[i].w * lights[i].w) {
+                    expected.push_back(u32(j));
+                }
+            }
+            ALWAYS_ASSERT(objects == expected, "Sphere query doesn't match brute force");
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> counts;
+    for(int i = 1; i < argc; ++i) {
+        counts.push_back(std::stoul(argv[i]));
+    }
+    if(counts.empty()) {
+        counts = {10000, 100000, 1000000};
+    }
+
+    for(const size_t count : counts) {
+        bench(count);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+#include <SceneData.h>
+#include <BakedScene.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <iostream>
+#include <cmath>
+
+using namespace OM3D;
+
+// Converts a .gltf/.glb file into a baked .om3d scene that can be loaded with Scene::from_baked
+// Usage: om3d_cook input.glb [output.om3d]
+
+int main(int argc, char** argv) {
+    if(argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " input.gltf|input.glb [output.om3d]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string input = argv[1];
+    std::string output = argc == 3 ? argv[2] : input.substr(0, input.find_last_of('.')) + ".om3d";
+
+    const double time = program_time();
+
+    const auto scene = SceneData::from_gltf(input);
+    if(!scene.is_ok) {
+        std::cerr << "Unable to load \"" << input << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(!BakedScene::write(output, scene.value).is_ok) {
+        return EXIT_FAILURE;
+    }
+
+    size_t vertex_count = 0;
+    size_t index_count = 0;
+    size_t meshlet_count = 0;
+    size_t lod_count = 0;
+    for(const MeshData& mesh : scene.value.meshes) {
+        vertex_count += mesh.vertices.size();
+        index_count += mesh.indices.size();
+        meshlet_count += mesh.meshlets.size();
+        lod_count += mesh.lods.size();
+    }
+
+    std::cout << output << " cooked in " << std::round((program_time() - time) * 100.0) / 100.0 << "s: "
+              << scene.value.meshes.size() << " meshes (" << vertex_count << " vertices, " << index_count << " indices, " << meshlet_count << " meshlets, " << lod_count << " LODs), "
+              << scene.value.textures.size() << " textures, "
+              << scene.value.materials.size() << " materials, "
+              << scene.value.objects.size() << " objects, "
+              << scene.value.point_lights.size() << " point lights" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+#include <AttribDecoder.h>
+#include <Vertex.h>
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <functional>
+
+using namespace OM3D;
+
+// Measures the throughput of the glTF attribute and index decoding kernels, with and without SIMD
+// Usage: om3d_decode_bench [vertex_count]
+
+static constexpr u32 repetitions = 16;
+
+static double best_time(const std::function<void()>& func) {
+    double best = 1e30;
+    for(u32 i = 0; i != repetitions; ++i) {
+        const double begin = program_time();
+        func();
+        best = std::min(best, program_time() - begin);
+    }
+    return best;
+}
+
+static void report(const char* name, size_t count, const std::function<void()>& func) {
+    simd_attrib_decoding = false;
+    const double scalar = best_time(func);
+    simd_attrib_decoding = true;
+    const double simd = best_time(func);
+
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << count / scalar * 1e-6 << " Mv/s"
+              << std::setw(10) << count / simd * 1e-6 << " Mv/s"
+              << std::setw(8) << scalar / simd << "x" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+
+    // Large enough for 4 floats per element with some padding for the interleaved cases
+    std::vector<u8> input(count * 32);
+    {
+        std::mt19937 rng(42);
+        for(u8& b : input) {
+            b = u8(rng());
+        }
+        // Keep float inputs finite
+        float* floats = reinterpret_cast<float*>(input.data());
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        for(size_t i = 0; i != count * 4; ++i) {
+            floats[i] = dist(rng);
+        }
+    }
+
+    std::vector<Vertex> vertices(count);
+    std::vector<u32> indices(count);
+
+    auto attribs = [&](const char* name, ComponentType type, u32 components, bool normalized, size_t in_stride, float* out, u32 out_components) {
+        report(name, count, [&] {
+            ALWAYS_ASSERT(decode_attribs(input.data(), in_stride, count, type, components, normalized, out, sizeof(Vertex), out_components), "Unsupported format");
+        });
+    };
+
+    std::cout << std::left << std::setw(28) << "path" << std::right << std::setw(15) << "scalar" << std::setw(15) << "simd" << std::endl;
+
+    attribs("float3 position", ComponentType::Float, 3, false, 0, &vertices[0].position.x, 3);
+    attribs("float3 position (stride 32)", ComponentType::Float, 3, false, 32, &vertices[0].position.x, 3);
+    attribs("float2 uv", ComponentType::Float, 2, false, 0, &vertices[0].uv.x, 2);
+    attribs("float4 tangent", ComponentType::Float, 4, false, 0, &vertices[0].tangent_bitangent_sign.x, 4);
+    attribs("u16x3 norm position", ComponentType::UnsignedShort, 3, true, 0, &vertices[0].position.x, 3);
+    attribs("u16x4 norm (stride 8)", ComponentType::UnsignedShort, 4, true, 8, &vertices[0].position.x, 3);
+    attribs("i16x3 norm normal", ComponentType::Short, 3, true, 0, &vertices[0].normal.x, 3);
+    attribs("i8x3 norm normal", ComponentType::Byte, 3, true, 0, &vertices[0].normal.x, 3);
+    attribs("i8x4 norm tangent", ComponentType::Byte, 4, true, 0, &vertices[0].tangent_bitangent_sign.x, 4);
+    attribs("u16x2 norm uv", ComponentType::UnsignedShort, 2, true, 0, &vertices[0].uv.x, 2);
+    attribs("u8x4 norm color", ComponentType::UnsignedByte, 4, true, 0, &vertices[0].color.x, 3);
+
+    report("u8 indices", count, [&] { decode_indices(input.data(), 0, count, ComponentType::UnsignedByte, indices.data()); });
+    report("u16 indices", count, [&] { decode_indices(input.data(), 0, count, ComponentType::UnsignedShort, indices.data()); });
+    report("u32 indices", count, [&] { decode_indices(input.data(), 0, count, ComponentType::UnsignedInt, indices.data()); });
+
+    // Both paths must agree exactly
+    std::vector<Vertex> reference(count);
+    for(const ComponentType type : {ComponentType::Byte, ComponentType::UnsignedByte, ComponentType::Short, ComponentType::UnsignedShort}) {
+        for(u32 components = 1; components <= 4; ++components) {
+            for(const size_t stride : {size_t(0), size_t(12)}) {
+                simd_attrib_decoding = false;
+                decode_attribs(input.data(), stride, count, type, components, true, &reference[0].tangent_bitangent_sign.x, sizeof(Vertex), 4);
+                simd_attrib_decoding = true;
+                decode_attribs(input.data(), stride, count, type, components, true, &vertices[0].tangent_bitangent_sign.x, sizeof(Vertex), 4);
+                for(size_t i = 0; i != count; ++i) {
+                    ALWAYS_ASSERT(std::memcmp(&reference[i].tangent_bitangent_sign, &vertices[i].tangent_bitangent_sign, components * sizeof(float)) == 0, "SIMD and scalar decoding differ");
+                }
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}